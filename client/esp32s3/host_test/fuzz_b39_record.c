@@ -0,0 +1,180 @@
+/*
+ * B39 数据行解析的模糊测试与基准
+ *
+ * 以 libFuzzer 构建时（B39_LIBFUZZER）只提供 LLVMFuzzerTestOneInput；
+ * 否则 main 对若干合法数据行做固定种子的随机变异（逐字节替换、插入、截断），
+ * 检查解析结果的不变量，再测量合法数据行的解析速度。
+ *
+ *   fuzz_b39_record [变异次数]
+ */
+
+#include "b39_record.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief 独立于解析器的参考实现：取第 index 个字段的值（×100，多余小数位截断）
+ *
+ * 只在解析成功后调用，字段格式已合法；整数部分超过 12 位有效数字时按溢出处理
+ * @return false 值超出 int32
+ */
+static bool reference_value(const uint8_t *data, size_t size, int index, int64_t *out)
+{
+    size_t p = 0;
+    for (int field = 0; field < index; p++) {
+        if (data[p] == ',') {
+            field++;
+        }
+    }
+    while (data[p] == ' ') {
+        p++;
+    }
+    bool negative = data[p] == '-';
+    if (data[p] == '-' || data[p] == '+') {
+        p++;
+    }
+    int64_t value = 0;
+    int digits = 0;
+    for (; p < size && data[p] >= '0' && data[p] <= '9'; p++) {
+        if (value > 0 || data[p] != '0') {
+            digits++;
+        }
+        if (digits > 12) {
+            return false;
+        }
+        value = value * 10 + (data[p] - '0');
+    }
+    int64_t frac = 0;
+    int frac_digits = 0;
+    if (p < size && data[p] == '.') {
+        for (p++; p < size && data[p] >= '0' && data[p] <= '9' && frac_digits < 2; p++, frac_digits++) {
+            frac = frac * 10 + (data[p] - '0');
+        }
+    }
+    for (; frac_digits < 2; frac_digits++) {
+        frac *= 10;
+    }
+    value = value * B39_VALUE_SCALE + frac;
+    *out = negative ? -value : value;
+    return *out >= -INT32_MAX && *out <= INT32_MAX;
+}
+
+// 解析结果必须满足的条件，违反时直接终止（便于 libFuzzer 保存输入）
+static void check_record(const uint8_t *data, size_t size)
+{
+    b39_record_t record;
+    memset(&record, 0xA5, sizeof(record));
+    b39_parse_result_t result = b39_record_parse((const char *)data, size, &record);
+    if (result > B39_PARSE_ERR_SEQUENCE) {
+        fprintf(stderr, "未知的解析结果 %d\n", result);
+        abort();
+    }
+    if (result != B39_PARSE_OK) {
+        return;
+    }
+    if (record.flags != 0) {
+        fprintf(stderr, "解析结果带有标志: %.*s\n", (int)size, (const char *)data);
+        abort();
+    }
+    for (int i = 0; i < B39_VALUE_COUNT; i++) {
+        int64_t expected;
+        if (!reference_value(data, size, i, &expected) || record.values[i] != expected) {
+            fprintf(stderr, "V%d 解析错误: %" PRId32 ": %.*s\n", i + 1, record.values[i], (int)size, (const char *)data);
+            abort();
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    check_record(data, size);
+    return 0;
+}
+
+#ifndef B39_LIBFUZZER
+
+static const char *s_seeds[] = {
+    "1234,35.5,12.25,600,-5.5,45.678,300,42",
+    "0,0,0,0,0,0,0,0",
+    "21474836.47,1000,5000,10000,125,100,60000,4294967",
+    " 1 , 2 ,3,4,5,6,7, 8 ",
+};
+
+static const char s_alphabet[] = "0123456789.,-+ \r\nx";
+
+// 线性同余随机数（固定种子，结果可复现）
+static uint32_t s_rand = 12345;
+static uint32_t next_rand(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? strtol(argv[1], NULL, 10) : 1000000;
+    uint8_t buf[128];
+
+    for (long n = 0; n < iterations; n++) {
+        const char *seed = s_seeds[next_rand() % (sizeof(s_seeds) / sizeof(s_seeds[0]))];
+        size_t len = strlen(seed);
+        memcpy(buf, seed, len);
+
+        int edits = 1 + next_rand() % 4;
+        for (int e = 0; e < edits && len > 0; e++) {
+            size_t pos = next_rand() % len;
+            switch (next_rand() % 3) {
+            case 0:     // 替换
+                buf[pos] = (next_rand() % 4 == 0) ? (uint8_t)next_rand() : (uint8_t)s_alphabet[next_rand() % (sizeof(s_alphabet) - 1)];
+                break;
+            case 1:     // 插入数字（制造超长数字）
+                if (len < sizeof(buf)) {
+                    memmove(buf + pos + 1, buf + pos, len - pos);
+                    buf[pos] = (uint8_t)('0' + next_rand() % 10);
+                    len++;
+                }
+                break;
+            default:    // 截断
+                len = pos;
+                break;
+            }
+        }
+
+        // 复制到刚好够用的堆内存，越界读取可由 AddressSanitizer 发现
+        uint8_t *input = malloc(len ? len : 1);
+        memcpy(input, buf, len);
+        check_record(input, len);
+        free(input);
+    }
+    printf("模糊测试: %ld 次变异, 未发现问题\n", iterations);
+
+    // 解析基准：合法数据行
+    const char *line = s_seeds[0];
+    size_t line_len = strlen(line);
+    const long rounds = 2000000;
+    b39_record_t record;
+    uint32_t checksum = 0;
+    double start = now_s();
+    for (long n = 0; n < rounds; n++) {
+        b39_record_parse(line, line_len, &record);
+        checksum += record.sequence;
+    }
+    double elapsed = now_s() - start;
+    printf("解析基准: %.1f ns/行, %.2f MB/s (校验 %" PRIu32 ")\n",
+           elapsed / rounds * 1e9, rounds * line_len / elapsed / 1e6, checksum);
+    return 0;
+}
+
+#endif // B39_LIBFUZZER
@@ -0,0 +1,24 @@
+/*
+ * 主机端测试的检查宏
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+static int s_failures = 0;
+
+// 检查失败时打印位置并计数，继续执行后续检查
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            fprintf(stderr, "%s:%d: 检查失败: %s\n", __FILE__, __LINE__, #cond); \
+            s_failures++;                                                        \
+        }                                                                        \
+    } while (0)
+
+// main 的返回值：有失败的检查时为 1
+#define TEST_RESULT() (s_failures == 0 ? 0 : 1)
+
+#endif // HOST_TEST_H
@@ -0,0 +1,19 @@
+/*
+ * 主机端测试用的 ESP-IDF esp_err.h 替身
+ */
+
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+typedef int esp_err_t;
+
+#define ESP_OK               0
+#define ESP_FAIL             -1
+#define ESP_ERR_INVALID_ARG  0x102
+
+static inline const char *esp_err_to_name(esp_err_t err)
+{
+    return err == ESP_OK ? "ESP_OK" : "ESP_ERR";
+}
+
+#endif // ESP_ERR_H
@@ -0,0 +1,18 @@
+/*
+ * 主机端测试用的 ESP-IDF esp_log.h 替身（日志不输出，参数仍参与编译检查）
+ */
+
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+static inline void esp_log_stub(const char *tag, const char *format, ...)
+{
+    (void)tag;
+    (void)format;
+}
+
+#define ESP_LOGE(tag, format, ...) esp_log_stub(tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_stub(tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_stub(tag, format, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,24 @@
+/*
+ * 主机端测试用的 ESP-IDF esp_netif_sntp.h 替身，仅保留时间同步模块用到的部分
+ */
+
+#ifndef ESP_NETIF_SNTP_H
+#define ESP_NETIF_SNTP_H
+
+#include <sys/time.h>
+#include "esp_err.h"
+
+typedef void (*esp_sntp_time_cb_t)(struct timeval *tv);
+
+typedef struct {
+    const char *servers[1];
+    esp_sntp_time_cb_t sync_cb;
+} esp_sntp_config_t;
+
+#define ESP_NETIF_SNTP_DEFAULT_CONFIG(server) { .servers = { server }, .sync_cb = NULL }
+
+// 由测试实现：记录服务器名与同步回调
+esp_err_t esp_netif_sntp_init(const esp_sntp_config_t *config);
+void esp_netif_sntp_deinit(void);
+
+#endif // ESP_NETIF_SNTP_H
@@ -0,0 +1,13 @@
+/*
+ * 主机端测试用的 ESP-IDF esp_timer.h 替身，时间由测试代码控制
+ */
+
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdint.h>
+
+// 开机以来的单调时间（微秒），由测试实现
+int64_t esp_timer_get_time(void);
+
+#endif // ESP_TIMER_H
@@ -0,0 +1,14 @@
+/*
+ * 主机端测试用的 FreeRTOS.h 替身（测试为单线程，临界区为空操作）
+ */
+
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+typedef int portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux)  ((void)(mux))
+
+#endif // FREERTOS_H
@@ -0,0 +1,92 @@
+/*
+ * B39 数据行解析的主机端单元测试
+ */
+
+#include "b39_record.h"
+#include "host_test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static b39_parse_result_t parse(const char *line, b39_record_t *record)
+{
+    return b39_record_parse(line, strlen(line), record);
+}
+
+static void test_valid_line(void)
+{
+    b39_record_t record;
+    CHECK(parse("1234,35.5,12.25,600,-5.5,45.678,300,42", &record) == B39_PARSE_OK);
+    CHECK(record.values[0] == 123400);
+    CHECK(record.values[1] == 3550);
+    CHECK(record.values[2] == 1225);
+    CHECK(record.values[3] == 60000);
+    CHECK(record.values[4] == -550);
+    CHECK(record.values[5] == 4567);    // 多余的小数位截断
+    CHECK(record.values[6] == 30000);
+    CHECK(record.sequence == 42);
+    CHECK(record.flags == 0);
+
+    // 字段两侧允许空格
+    CHECK(parse(" 1 , 2 ,3,4,5,6,7, 8 ", &record) == B39_PARSE_OK);
+    CHECK(record.values[1] == 200 && record.sequence == 8);
+}
+
+static void test_field_count(void)
+{
+    b39_record_t record;
+    CHECK(parse("1,2,3,4,5,6,7", &record) == B39_PARSE_ERR_FIELD_COUNT);
+    CHECK(parse("1,2,3,4,5,6,7,", &record) == B39_PARSE_ERR_FIELD_COUNT);
+    CHECK(parse("1,2,3,4,5,6,7,8,9", &record) == B39_PARSE_ERR_FIELD_COUNT);
+    CHECK(parse("", &record) == B39_PARSE_ERR_FIELD_COUNT);
+}
+
+static void test_bad_number(void)
+{
+    b39_record_t record;
+    CHECK(parse("1,x,3,4,5,6,7,8", &record) == B39_PARSE_ERR_NUMBER);
+    CHECK(parse("1,2;3,4,5,6,7,8", &record) == B39_PARSE_ERR_NUMBER);
+    CHECK(parse("1,-,3,4,5,6,7,8", &record) == B39_PARSE_ERR_NUMBER);
+    CHECK(parse("1,2,3,4,5,6,7,8x", &record) == B39_PARSE_ERR_NUMBER);
+    CHECK(parse("1,2,3,4,5,6,7,-8", &record) == B39_PARSE_ERR_SEQUENCE);
+}
+
+static void test_overflow(void)
+{
+    b39_record_t record;
+    // ×100 后恰好为 INT32_MAX
+    CHECK(parse("21474836.47,0,0,0,0,0,0,1", &record) == B39_PARSE_OK);
+    CHECK(record.values[0] == INT32_MAX);
+    CHECK(parse("-21474836.47,0,0,0,0,0,0,1", &record) == B39_PARSE_OK);
+    CHECK(record.values[0] == -INT32_MAX);
+
+    // 整数部分未超出 int32，但 ×100 后超出
+    CHECK(parse("21474836.48,0,0,0,0,0,0,1", &record) == B39_PARSE_ERR_NUMBER);
+    CHECK(parse("0,0,0,0,0,0,2147483647,1", &record) == B39_PARSE_ERR_NUMBER);
+    CHECK(parse("0,0,0,0,-99999999,0,0,1", &record) == B39_PARSE_ERR_NUMBER);
+    // 整数部分超出 int32
+    CHECK(parse("99999999999,0,0,0,0,0,0,1", &record) == B39_PARSE_ERR_NUMBER);
+
+    // 序号只取整数部分，不受 ×100 限制
+    CHECK(parse("0,0,0,0,0,0,0,2147483647", &record) == B39_PARSE_OK);
+    CHECK(record.sequence == INT32_MAX);
+}
+
+static void test_range(void)
+{
+    b39_record_t record;
+    CHECK(parse("100,35,10,600,25,50,300,1", &record) == B39_PARSE_OK);
+    CHECK(b39_record_in_range(&record));
+    CHECK(parse("100,35,10,600,130,50,300,1", &record) == B39_PARSE_OK);
+    CHECK(!b39_record_in_range(&record));
+}
+
+int main(void)
+{
+    test_valid_line();
+    test_field_count();
+    test_bad_number();
+    test_overflow();
+    test_range();
+    return TEST_RESULT();
+}
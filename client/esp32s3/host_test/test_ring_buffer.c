@@ -0,0 +1,224 @@
+/*
+ * 单生产者/单消费者环形缓冲区的主机端单元测试
+ */
+
+#include "ring_buffer.h"
+#include "host_test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+
+// 写入一条内容为 len 个 fill 字节的记录
+static bool put(ring_buffer_t *rb, size_t len, uint8_t fill)
+{
+    uint8_t *p = ring_buffer_reserve(rb, len);
+    if (p == NULL) {
+        return false;
+    }
+    memset(p, fill, len);
+    ring_buffer_commit(rb, len);
+    return true;
+}
+
+// 读取并移除一条记录，检查长度与内容
+static bool take(ring_buffer_t *rb, size_t len, uint8_t fill)
+{
+    ring_slice_t slice;
+    if (!ring_buffer_peek(rb, &slice) || slice.len != len) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (slice.data[i] != fill) {
+            return false;
+        }
+    }
+    ring_buffer_release(rb);
+    return true;
+}
+
+static void test_init(void)
+{
+    ring_buffer_t rb;
+    uint8_t storage[64];
+    CHECK(!ring_buffer_init(&rb, storage, 48));     // 不是 2 的幂
+    CHECK(!ring_buffer_init(&rb, storage, 8));      // 太小
+    CHECK(!ring_buffer_init(&rb, NULL, 64));
+    CHECK(ring_buffer_init(&rb, storage, 64));
+}
+
+static void test_empty_full(void)
+{
+    ring_buffer_t rb;
+    _Alignas(4) uint8_t storage[64];
+    ring_buffer_init(&rb, storage, sizeof(storage));
+
+    ring_slice_t slice;
+    CHECK(!ring_buffer_peek(&rb, &slice));
+    CHECK(ring_buffer_reserve(&rb, 0) == NULL);
+    CHECK(ring_buffer_reserve(&rb, 61) == NULL);    // 加上 4 字节长度后超过容量
+
+    // 每条 12 + 4 = 16 字节，正好写满 4 条
+    for (int i = 0; i < 4; i++) {
+        CHECK(put(&rb, 12, (uint8_t)i));
+    }
+    CHECK(!put(&rb, 1, 0xFF));
+
+    ring_slice_t batch[8];
+    CHECK(ring_buffer_peek_batch(&rb, batch, 8) == 4);
+    CHECK(batch[3].len == 12 && batch[3].data[0] == 3);
+
+    for (int i = 0; i < 4; i++) {
+        CHECK(take(&rb, 12, (uint8_t)i));
+    }
+    CHECK(!ring_buffer_peek(&rb, &slice));
+    CHECK(put(&rb, 12, 9));
+    CHECK(take(&rb, 12, 9));
+}
+
+static void test_reserve_commit_cancel(void)
+{
+    ring_buffer_t rb;
+    _Alignas(4) uint8_t storage[64];
+    ring_buffer_init(&rb, storage, sizeof(storage));
+
+    // 同时只能有一个预留
+    uint8_t *p = ring_buffer_reserve(&rb, 20);
+    CHECK(p != NULL);
+    CHECK(ring_buffer_reserve(&rb, 4) == NULL);
+
+    // 放弃预留后不发布任何数据，空间可以再次预留
+    ring_buffer_cancel(&rb);
+    ring_slice_t slice;
+    CHECK(!ring_buffer_peek(&rb, &slice));
+    CHECK(ring_buffer_reserve(&rb, 4) == p);
+
+    // 提交长度小于预留长度时只占用实际长度
+    memcpy(p, "abc", 3);
+    ring_buffer_commit(&rb, 3);
+    CHECK(ring_buffer_peek(&rb, &slice) && slice.len == 3 && memcmp(slice.data, "abc", 3) == 0);
+    ring_buffer_release(&rb);
+}
+
+static void test_wrap(void)
+{
+    ring_buffer_t rb;
+    _Alignas(4) uint8_t storage[64];
+    ring_buffer_init(&rb, storage, sizeof(storage));
+
+    // 写入 24 + 24 字节后读走第一条，尾部只剩 16 字节，放不下 20 字节的记录，需回绕到起始位置
+    CHECK(put(&rb, 20, 1));
+    CHECK(put(&rb, 20, 2));
+    CHECK(take(&rb, 20, 1));
+    uint8_t *p = ring_buffer_reserve(&rb, 20);
+    CHECK(p == storage + 4);
+    memset(p, 3, 20);
+    ring_buffer_commit(&rb, 20);
+
+    // 回绕标记对消费者不可见，记录在内存中连续
+    ring_slice_t batch[4];
+    CHECK(ring_buffer_peek_batch(&rb, batch, 4) == 2);
+    CHECK(batch[0].data[0] == 2 && batch[1].data == storage + 4);
+    CHECK(take(&rb, 20, 2));
+    CHECK(take(&rb, 20, 3));
+
+    // 尾部放不下、回绕后起始位置的空间也不够时拒绝预留，不写入回绕标记
+    ring_buffer_init(&rb, storage, sizeof(storage));
+    CHECK(put(&rb, 16, 4));     // [0, 20)
+    CHECK(put(&rb, 20, 5));     // [20, 44)
+    CHECK(put(&rb, 8, 6));      // [44, 56)
+    CHECK(take(&rb, 16, 4));    // 尾部剩余 8 字节，起始位置空闲 20 字节
+    CHECK(ring_buffer_reserve(&rb, 20) == NULL);
+    CHECK(ring_buffer_peek_batch(&rb, batch, 4) == 2);
+    CHECK(take(&rb, 20, 5));
+    CHECK(take(&rb, 8, 6));
+    CHECK(put(&rb, 20, 7));
+    CHECK(take(&rb, 20, 7));
+
+    // 反复回绕
+    for (int i = 0; i < 1000; i++) {
+        size_t len = 1 + (size_t)(i * 7) % 27;
+        CHECK(put(&rb, len, (uint8_t)i));
+        CHECK(take(&rb, len, (uint8_t)i));
+    }
+}
+
+// 生产者与消费者线程交替运行：记录内容为递增序号，消费者检查顺序与完整性
+#define INTERLEAVE_RECORDS 200000
+
+typedef struct {
+    ring_buffer_t rb;
+    _Alignas(4) uint8_t storage[256];
+    int errors;
+} interleave_t;
+
+static void *producer(void *arg)
+{
+    interleave_t *t = arg;
+    for (uint32_t seq = 0; seq < INTERLEAVE_RECORDS;) {
+        size_t len = sizeof(seq) + seq % 29;
+        uint8_t *p = ring_buffer_reserve(&t->rb, len);
+        if (p == NULL) {
+            // 缓冲区已满，让出处理器（单核主机上消费者才能运行）
+            sched_yield();
+            continue;
+        }
+        memcpy(p, &seq, sizeof(seq));
+        memset(p + sizeof(seq), (uint8_t)seq, len - sizeof(seq));
+        ring_buffer_commit(&t->rb, len);
+        seq++;
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    interleave_t *t = arg;
+    ring_slice_t batch[8];
+    for (uint32_t expected = 0; expected < INTERLEAVE_RECORDS;) {
+        size_t count = ring_buffer_peek_batch(&t->rb, batch, 8);
+        if (count == 0) {
+            sched_yield();
+            continue;
+        }
+        for (size_t i = 0; i < count; i++, expected++) {
+            uint32_t seq;
+            memcpy(&seq, batch[i].data, sizeof(seq));
+            if (seq != expected || batch[i].len != sizeof(seq) + seq % 29 ||
+                (batch[i].len > sizeof(seq) && batch[i].data[batch[i].len - 1] != (uint8_t)seq)) {
+                t->errors++;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            ring_buffer_release(&t->rb);
+        }
+    }
+    return NULL;
+}
+
+static void test_interleave(void)
+{
+    static interleave_t t;
+    ring_buffer_init(&t.rb, t.storage, sizeof(t.storage));
+
+    pthread_t threads[2];
+    pthread_create(&threads[0], NULL, producer, &t);
+    pthread_create(&threads[1], NULL, consumer, &t);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    CHECK(t.errors == 0);
+    ring_slice_t slice;
+    CHECK(!ring_buffer_peek(&t.rb, &slice));
+}
+
+int main(void)
+{
+    test_init();
+    test_empty_full();
+    test_reserve_commit_cancel();
+    test_wrap();
+    test_interleave();
+    return TEST_RESULT();
+}
@@ -0,0 +1,167 @@
+/*
+ * 时间同步模块（单调时钟 + UTC 偏移量）的主机端单元测试
+ *
+ * esp_timer_get_time 与 SNTP 接口由本文件实现：测试直接设置单调时间，
+ * 并通过 SNTP 初始化时记录的回调模拟同步与重新校准。
+ */
+
+#include "time_sync.h"
+#include "config.h"
+#include "host_test.h"
+
+#include <string.h>
+#include "esp_timer.h"
+#include "esp_netif_sntp.h"
+
+#define SEC_US 1000000LL
+#define BASE_UTC_S 1700000000LL
+
+static int64_t s_fake_time_us = 0;
+static esp_sntp_time_cb_t s_sync_cb = NULL;
+static const char *s_sntp_server = NULL;
+static int s_sntp_inits = 0;
+static int s_sntp_deinits = 0;
+
+int64_t esp_timer_get_time(void)
+{
+    return s_fake_time_us;
+}
+
+esp_err_t esp_netif_sntp_init(const esp_sntp_config_t *config)
+{
+    s_sync_cb = config->sync_cb;
+    s_sntp_server = config->servers[0];
+    s_sntp_inits++;
+    return ESP_OK;
+}
+
+void esp_netif_sntp_deinit(void)
+{
+    s_sync_cb = NULL;
+    s_sntp_deinits++;
+}
+
+// 在单调时间 mono_us 时收到 SNTP 结果 utc_us
+static void sync_at(int64_t mono_us, int64_t utc_us)
+{
+    s_fake_time_us = mono_us;
+    struct timeval tv = {
+        .tv_sec = utc_us / SEC_US,
+        .tv_usec = utc_us % SEC_US,
+    };
+    s_sync_cb(&tv);
+}
+
+static int64_t now_at(int64_t mono_us, bool *synced)
+{
+    s_fake_time_us = mono_us;
+    return time_sync_now_ms(synced);
+}
+
+static void test_unsynced(void)
+{
+    bool synced = true;
+    int64_t utc_ms = -1;
+
+    // 同步前返回开机以来的单调毫秒，并标记未同步
+    CHECK(!time_sync_is_synced());
+    CHECK(now_at(2 * SEC_US + 345678, &synced) == 2345);
+    CHECK(!synced);
+    CHECK(!time_sync_to_utc(2345, &utc_ms));
+    CHECK(utc_ms == -1);
+}
+
+static void test_init(void)
+{
+    time_sync_init(SNTP_SERVER);
+    CHECK(s_sntp_inits == 1);
+    CHECK(s_sync_cb != NULL);
+    CHECK(s_sntp_server != NULL && strcmp(s_sntp_server, SNTP_SERVER) == 0);
+}
+
+static void test_offset(void)
+{
+    bool synced = false;
+    int64_t utc_ms = 0;
+
+    // 开机 5 秒时同步到 BASE_UTC_S + 0.25 秒
+    sync_at(5 * SEC_US, BASE_UTC_S * SEC_US + 250000);
+    CHECK(time_sync_is_synced());
+    CHECK(now_at(5 * SEC_US, &synced) == BASE_UTC_S * 1000 + 250);
+    CHECK(synced);
+    CHECK(now_at(6 * SEC_US + 500000, &synced) == BASE_UTC_S * 1000 + 1750);
+    CHECK(synced);
+
+    // 同步前（开机 2 秒）记录的单调时间换算为 UTC
+    CHECK(time_sync_to_utc(2000, &utc_ms));
+    CHECK(utc_ms == BASE_UTC_S * 1000 - 2750);
+}
+
+static void test_backwards_resync(void)
+{
+    bool synced = false;
+    int64_t utc_ms = 0;
+
+    int64_t before = now_at(7 * SEC_US, &synced);
+    CHECK(before == BASE_UTC_S * 1000 + 2250);
+
+    // 开机 7 秒时重新校准，UTC 比当前偏移量推算的早 2 秒
+    sync_at(7 * SEC_US, BASE_UTC_S * SEC_US + 250000);
+
+    // 采集时间保持不倒退，直到新的偏移量追上最近一次返回值
+    CHECK(now_at(7 * SEC_US, &synced) == before);
+    CHECK(synced);
+    CHECK(now_at(8 * SEC_US, &synced) == before);
+    CHECK(now_at(9 * SEC_US + 500000, &synced) == BASE_UTC_S * 1000 + 2750);
+
+    // 单调时间换算按新的偏移量计算，不受保持值影响
+    CHECK(time_sync_to_utc(7000, &utc_ms));
+    CHECK(utc_ms == BASE_UTC_S * 1000 + 250);
+}
+
+static void test_forward_resync(void)
+{
+    bool synced = false;
+
+    // 向前校准直接生效
+    sync_at(10 * SEC_US, (BASE_UTC_S + 10) * SEC_US);
+    CHECK(now_at(10 * SEC_US, &synced) == (BASE_UTC_S + 10) * 1000);
+    CHECK(now_at(10 * SEC_US + 999, &synced) == (BASE_UTC_S + 10) * 1000);
+    CHECK(now_at(10 * SEC_US + 1000, &synced) == (BASE_UTC_S + 10) * 1000 + 1);
+}
+
+static void test_set_server(void)
+{
+    char too_long[SNTP_SERVER_MAX_LEN + 1];
+    memset(too_long, 'a', sizeof(too_long) - 1);
+    too_long[sizeof(too_long) - 1] = '\0';
+
+    CHECK(time_sync_set_server("") == ESP_ERR_INVALID_ARG);
+    CHECK(time_sync_set_server(too_long) == ESP_ERR_INVALID_ARG);
+    CHECK(s_sntp_deinits == 0);
+    CHECK(s_sntp_inits == 1);
+
+    // 更换服务器时先停止再以新地址启动，已同步的偏移量保留
+    CHECK(time_sync_set_server("192.168.1.10") == ESP_OK);
+    CHECK(s_sntp_deinits == 1);
+    CHECK(s_sntp_inits == 2);
+    CHECK(s_sync_cb != NULL);
+    CHECK(s_sntp_server != NULL && strcmp(s_sntp_server, "192.168.1.10") == 0);
+    CHECK(time_sync_is_synced());
+
+    bool synced = false;
+    CHECK(now_at(11 * SEC_US, &synced) == (BASE_UTC_S + 11) * 1000);
+    CHECK(synced);
+}
+
+int main(void)
+{
+    // 各用例依次推进同一个模块状态，顺序不可调换
+    test_unsynced();
+    test_init();
+    test_offset();
+    test_backwards_resync();
+    test_forward_resync();
+    test_set_server();
+    return TEST_RESULT();
+}
@@ -0,0 +1,297 @@
+/*
+ * B39 数据记录模块实现
+ */
+
+#include "b39_record.h"
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+// 各测量值的传感器量程（×100）
+static const struct {
+    int32_t min;
+    int32_t max;
+} s_value_range[B39_VALUE_COUNT] = {
+    { 0, 100000000 },       // V1: >0.3um颗粒数 0~1000000 pcs/0.1L
+    { 0, 100000 },          // V2: PM2.5 0~1000 μg/m³
+    { 0, 500000 },          // V3: 甲醛 0~5000 μg/m³
+    { 0, 1000000 },         // V4: CO2 0~10000 PPM
+    { -4000, 12500 },       // V5: 温度 -40~125 ℃
+    { 0, 10000 },           // V6: 湿度 0~100 %
+    { 0, 6000000 },         // V7: VOC 0~60000 ppb
+};
+
+/**
+ * @brief 解析一个定点数字段（结果 ×100，多余的小数位截断）
+ * @return true 成功，*pos 指向字段之后的位置
+ */
+static bool parse_fixed(const char **pos, const char *end, int64_t *out)
+{
+    const char *p = *pos;
+
+    while (p < end && *p == ' ') {
+        p++;
+    }
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    int64_t value = 0;
+    int digits = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        if (value > INT32_MAX) {
+            return false;
+        }
+        p++;
+        digits++;
+    }
+
+    int64_t frac = 0;
+    int frac_digits = 0;
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (frac_digits < 2) {
+                frac = frac * 10 + (*p - '0');
+                frac_digits++;
+            }
+            p++;
+            digits++;
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+    for (; frac_digits < 2; frac_digits++) {
+        frac *= 10;
+    }
+
+    while (p < end && *p == ' ') {
+        p++;
+    }
+
+    value = value * B39_VALUE_SCALE + frac;
+    *out = negative ? -value : value;
+    *pos = p;
+    return true;
+}
+
+b39_parse_result_t b39_record_parse(const char *line, size_t len, b39_record_t *record)
+{
+    const char *p = line;
+    const char *end = line + len;
+
+    for (int i = 0; i <= B39_VALUE_COUNT; i++) {
+        int64_t value;
+        if (!parse_fixed(&p, end, &value)) {
+            // 行尾出现空字段说明数据行被截断
+            return p >= end ? B39_PARSE_ERR_FIELD_COUNT : B39_PARSE_ERR_NUMBER;
+        }
+
+        if (i < B39_VALUE_COUNT) {
+            // parse_fixed 只限制整数部分，×100 后仍可能超出 int32
+            if (value > INT32_MAX || value < -INT32_MAX) {
+                return B39_PARSE_ERR_NUMBER;
+            }
+            record->values[i] = (int32_t)value;
+            if (p >= end) {
+                return B39_PARSE_ERR_FIELD_COUNT;
+            }
+            if (*p != ',') {
+                return B39_PARSE_ERR_NUMBER;
+            }
+            p++;
+        } else {
+            // V8 设备序号，取整数部分
+            if (p != end) {
+                return *p == ',' ? B39_PARSE_ERR_FIELD_COUNT : B39_PARSE_ERR_NUMBER;
+            }
+            if (value < 0) {
+                return B39_PARSE_ERR_SEQUENCE;
+            }
+            record->sequence = (uint32_t)(value / B39_VALUE_SCALE);
+        }
+    }
+
+    record->flags = 0;
+    return B39_PARSE_OK;
+}
+
+bool b39_record_in_range(const b39_record_t *record)
+{
+    for (int i = 0; i < B39_VALUE_COUNT; i++) {
+        if (record->values[i] < s_value_range[i].min || record->values[i] > s_value_range[i].max) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint8_t b39_seq_track(b39_seq_tracker_t *tracker, uint32_t sequence)
+{
+    uint8_t flags = B39_FLAG_SEQ_TRACKED;
+
+    if (tracker->started) {
+        if (sequence == tracker->last) {
+            tracker->duplicates++;
+            flags |= B39_FLAG_SEQ_DUPLICATE;
+        } else if (sequence < tracker->last) {
+            tracker->resets++;
+            flags |= B39_FLAG_SEQ_RESET;
+        } else if (sequence - tracker->last > 1) {
+            tracker->gaps++;
+            tracker->lost += sequence - tracker->last - 1;
+            flags |= B39_FLAG_SEQ_GAP;
+        }
+    }
+
+    tracker->started = true;
+    tracker->last = sequence;
+    return flags;
+}
+
+bool b39_deadband_check(b39_deadband_t *deadband, const b39_record_t *record,
+                        const int32_t thresholds[B39_VALUE_COUNT], uint32_t heartbeat_ms, int64_t now_ms)
+{
+    bool report = !deadband->started ||
+                  (record->flags & B39_DEADBAND_ALWAYS_REPORT) != 0 ||
+                  now_ms - deadband->last_ms >= heartbeat_ms;
+    for (int i = 0; i < B39_VALUE_COUNT && !report; i++) {
+        int64_t diff = (int64_t)record->values[i] - deadband->last[i];
+        report = (diff < 0 ? -diff : diff) > thresholds[i];
+    }
+
+    if (!report) {
+        return false;
+    }
+    deadband->started = true;
+    memcpy(deadband->last, record->values, sizeof(deadband->last));
+    deadband->last_ms = now_ms;
+    return true;
+}
+
+static inline void put_le32(uint8_t *buf, uint32_t v)
+{
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+    buf[2] = (uint8_t)(v >> 16);
+    buf[3] = (uint8_t)(v >> 24);
+}
+
+void b39_record_encode(const b39_record_t *record, uint8_t *buf)
+{
+    buf[0] = B39_WIRE_VERSION;
+    buf[1] = record->flags;
+    buf[2] = 0;
+    buf[3] = 0;
+    put_le32(buf + 4, record->sequence);
+    put_le32(buf + 8, (uint32_t)((uint64_t)record->captured_at_ms & 0xFFFFFFFF));
+    put_le32(buf + 12, (uint32_t)((uint64_t)record->captured_at_ms >> 32));
+    for (int i = 0; i < B39_VALUE_COUNT; i++) {
+        put_le32(buf + 16 + i * 4, (uint32_t)record->values[i]);
+    }
+}
+
+void b39_summary_add(b39_summary_t *summary, const b39_record_t *record, int64_t start_ms)
+{
+    if (summary->count == 0) {
+        memset(summary, 0, sizeof(*summary));
+        memcpy(summary->min, record->values, sizeof(summary->min));
+        memcpy(summary->max, record->values, sizeof(summary->max));
+        summary->seq_first = record->sequence;
+    }
+    summary->count++;
+    summary->duration_ms = (uint32_t)(record->captured_at_ms - start_ms);
+    summary->seq_last = record->sequence;
+    memcpy(summary->last, record->values, sizeof(summary->last));
+
+    // 单遍更新均值、离差平方和与协离差和（与服务器聚合表的计算方式一致，可无损合并）
+    double n = (double)summary->count;
+    double before[B39_VALUE_COUNT];
+    double after[B39_VALUE_COUNT];
+    for (int i = 0; i < B39_VALUE_COUNT; i++) {
+        int32_t v = record->values[i];
+        before[i] = v - summary->mean[i];
+        summary->mean[i] += before[i] / n;
+        after[i] = v - summary->mean[i];
+        summary->m2[i] += before[i] * after[i];
+        if (v < summary->min[i]) {
+            summary->min[i] = v;
+        }
+        if (v > summary->max[i]) {
+            summary->max[i] = v;
+        }
+    }
+
+    int p = 0;
+    for (int i = 0; i < B39_VALUE_COUNT; i++) {
+        for (int j = i + 1; j < B39_VALUE_COUNT; j++) {
+            summary->c2[p++] += before[i] * after[j];
+        }
+    }
+}
+
+// JSON 输出缓冲区，写满后不再写入
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} json_out_t;
+
+static void json_printf(json_out_t *out, const char *fmt, ...)
+{
+    if (out->overflow) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= out->size - out->len) {
+        out->overflow = true;
+        return;
+    }
+    out->len += (size_t)n;
+}
+
+static void json_int_array(json_out_t *out, const char *key, const int32_t *values, int count)
+{
+    json_printf(out, ",\"%s\":[", key);
+    for (int i = 0; i < count; i++) {
+        json_printf(out, i == 0 ? "%" PRId32 : ",%" PRId32, values[i]);
+    }
+    json_printf(out, "]");
+}
+
+static void json_double_array(json_out_t *out, const char *key, const double *values, int count)
+{
+    json_printf(out, ",\"%s\":[", key);
+    for (int i = 0; i < count; i++) {
+        json_printf(out, i == 0 ? "%.10g" : ",%.10g", values[i]);
+    }
+    json_printf(out, "]");
+}
+
+size_t b39_summary_to_json(const b39_record_t *head, const b39_summary_t *summary, char *buf, size_t size)
+{
+    json_out_t out = { .buf = buf, .size = size };
+    json_printf(&out, "{\"ts\":%" PRId64 ",\"flags\":%u,\"duration_ms\":%" PRIu32 ",\"count\":%" PRIu32
+                ",\"seq_first\":%" PRIu32 ",\"seq_last\":%" PRIu32,
+                head->captured_at_ms, head->flags, summary->duration_ms, summary->count,
+                summary->seq_first, summary->seq_last);
+    json_int_array(&out, "min", summary->min, B39_VALUE_COUNT);
+    json_int_array(&out, "max", summary->max, B39_VALUE_COUNT);
+    json_int_array(&out, "last", summary->last, B39_VALUE_COUNT);
+    json_double_array(&out, "mean", summary->mean, B39_VALUE_COUNT);
+    json_double_array(&out, "m2", summary->m2, B39_VALUE_COUNT);
+    json_double_array(&out, "c2", summary->c2, B39_PAIR_COUNT);
+    json_printf(&out, "}");
+    return out.overflow ? 0 : out.len;
+}
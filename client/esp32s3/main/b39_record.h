@@ -0,0 +1,214 @@
+/*
+ * B39 数据记录模块头文件
+ *
+ * 将 B39 串口上报的逗号分隔数据行解析为定点数记录，并编码为紧凑的二进制上报格式。
+ * 该模块不依赖 FreeRTOS/ESP-IDF，可在主机上单独编译。
+ */
+
+#ifndef B39_RECORD_H
+#define B39_RECORD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// 测量值个数（V1~V7），V8 为设备序号
+#define B39_VALUE_COUNT 7
+// 测量值定点数倍数（保留两位小数）
+#define B39_VALUE_SCALE 100
+
+// 二进制上报格式
+#define B39_WIRE_CONTENT_TYPE "application/vnd.b39.record"
+#define B39_WIRE_VERSION 1
+#define B39_WIRE_SIZE 44
+
+// 记录标志
+#define B39_FLAG_OUT_OF_RANGE   (1 << 0)    // 测量值超出传感器量程
+#define B39_FLAG_SEQ_GAP        (1 << 1)    // 序号跳号（中间有数据丢失）
+#define B39_FLAG_SEQ_DUPLICATE  (1 << 2)    // 序号与上一帧相同（重复数据）
+#define B39_FLAG_SEQ_RESET      (1 << 3)    // 序号回退（传感器重启）
+#define B39_FLAG_TIME_UNSYNCED  (1 << 4)    // 尚未完成时间同步，采集时间为开机以来的单调时间
+#define B39_FLAG_SUMMARY        (1 << 5)    // 汇总帧：帧体为 b39_summary_t，而不是原始数据行
+#define B39_FLAG_SEQ_TRACKED    (1 << 7)    // 序号已由设备检查，以上序号标志有效
+
+// 数据行解析结果
+typedef enum {
+    B39_PARSE_OK = 0,
+    B39_PARSE_ERR_FIELD_COUNT,              // 字段数不为 8（数据行截断或粘连）
+    B39_PARSE_ERR_NUMBER,                   // 字段不是合法数值
+    B39_PARSE_ERR_SEQUENCE,                 // 设备序号为负数
+} b39_parse_result_t;
+
+// B39 数据记录
+typedef struct {
+    int64_t captured_at_ms;                 // 采集时间（UTC 毫秒，未同步时见 B39_FLAG_TIME_UNSYNCED）
+    int32_t values[B39_VALUE_COUNT];        // V1~V7 测量值 ×100
+    uint32_t sequence;                      // V8 设备递增序号
+    uint8_t flags;                          // 记录标志
+} b39_record_t;
+
+// 测量值两两组合数（协离差个数）
+#define B39_PAIR_COUNT (B39_VALUE_COUNT * (B39_VALUE_COUNT - 1) / 2)
+
+// 汇总上报 JSON 的最大长度
+#define B39_SUMMARY_JSON_MAX 1280
+
+// 汇总模式下一个时间窗口内各帧的统计（测量值单位均为 ×100 定点数）
+typedef struct {
+    uint32_t count;                         // 帧数
+    uint32_t duration_ms;                   // 最后一帧与第一帧的采集时间差
+    uint32_t seq_first;                     // 第一帧序号
+    uint32_t seq_last;                      // 最后一帧序号
+    int32_t min[B39_VALUE_COUNT];
+    int32_t max[B39_VALUE_COUNT];
+    int32_t last[B39_VALUE_COUNT];          // 最后一帧的测量值
+    double mean[B39_VALUE_COUNT];           // 均值
+    double m2[B39_VALUE_COUNT];             // 离差平方和（Welford 单遍更新）
+    double c2[B39_PAIR_COUNT];              // 两两协离差和（按 (0,1),(0,2)...(5,6) 排列，用于相关系数）
+} b39_summary_t;
+
+// 设备序号跟踪状态
+typedef struct {
+    bool started;                           // 已收到第一帧
+    uint32_t last;                          // 上一帧序号
+    uint32_t gaps;                          // 跳号次数
+    uint32_t lost;                          // 跳过的序号总数
+    uint32_t duplicates;                    // 重复次数
+    uint32_t resets;                        // 回退（重启）次数
+} b39_seq_tracker_t;
+
+/*
+ * 上传帧布局: [b39_record_t][原始数据行]
+ * 帧在环形缓冲区和离线缓存中不保证按 8 字节对齐，记录部分需通过 memcpy 访问。
+ */
+#define B39_FRAME_HEADER_SIZE sizeof(b39_record_t)
+
+static inline void b39_frame_get_record(const uint8_t *frame, b39_record_t *record)
+{
+    memcpy(record, frame, sizeof(*record));
+}
+
+static inline void b39_frame_set_record(uint8_t *frame, const b39_record_t *record)
+{
+    memcpy(frame, record, sizeof(*record));
+}
+
+static inline const char *b39_frame_line(const uint8_t *frame)
+{
+    return (const char *)frame + B39_FRAME_HEADER_SIZE;
+}
+
+/*
+ * 汇总帧布局: [b39_record_t][b39_summary_t]，帧头带有 B39_FLAG_SUMMARY，
+ * 其采集时间为窗口内第一帧的采集时间，标志为窗口内各帧标志的并集
+ */
+#define B39_SUMMARY_FRAME_SIZE (B39_FRAME_HEADER_SIZE + sizeof(b39_summary_t))
+
+static inline bool b39_frame_is_summary(const uint8_t *frame)
+{
+    b39_record_t record;
+    b39_frame_get_record(frame, &record);
+    return (record.flags & B39_FLAG_SUMMARY) != 0;
+}
+
+static inline void b39_frame_get_summary(const uint8_t *frame, b39_summary_t *summary)
+{
+    memcpy(summary, frame + B39_FRAME_HEADER_SIZE, sizeof(*summary));
+}
+
+static inline void b39_frame_set_summary(uint8_t *frame, const b39_summary_t *summary)
+{
+    memcpy(frame + B39_FRAME_HEADER_SIZE, summary, sizeof(*summary));
+}
+
+// 变化上报（死区过滤）状态：与最后一次上报的帧比较
+typedef struct {
+    bool started;                           // 已上报过帧
+    int32_t last[B39_VALUE_COUNT];          // 最后一次上报的测量值
+    int64_t last_ms;                        // 最后一次上报的时间（单调时间）
+} b39_deadband_t;
+
+// 带有以下标志的帧总是上报（量程或序号异常需要服务器记录）
+#define B39_DEADBAND_ALWAYS_REPORT \
+    (B39_FLAG_OUT_OF_RANGE | B39_FLAG_SEQ_GAP | B39_FLAG_SEQ_DUPLICATE | B39_FLAG_SEQ_RESET)
+
+/**
+ * @brief 解析一行 B39 数据（8 个逗号分隔字段，不含 \r\n），不分配内存
+ * @param line 数据行（无需以 \0 结尾）
+ * @param len 数据行长度
+ * @param record 输出记录（采集时间字段不修改，标志清零）
+ * @return B39_PARSE_OK 成功，其他值为格式错误的原因
+ */
+b39_parse_result_t b39_record_parse(const char *line, size_t len, b39_record_t *record);
+
+/**
+ * @brief 检查测量值是否在传感器量程内
+ * @return true 全部在量程内
+ */
+bool b39_record_in_range(const b39_record_t *record);
+
+/**
+ * @brief 跟踪设备序号，统计跳号、重复和回退
+ * @param tracker 跟踪状态
+ * @param sequence 当前帧序号
+ * @return 记录标志（B39_FLAG_SEQ_*，总是包含 B39_FLAG_SEQ_TRACKED）
+ */
+uint8_t b39_seq_track(b39_seq_tracker_t *tracker, uint32_t sequence);
+
+/**
+ * @brief 将记录编码为二进制上报格式（小端序，固定 B39_WIRE_SIZE 字节）
+ *
+ *   偏移  长度  字段
+ *   0     1     版本号
+ *   1     1     记录标志
+ *   2     2     保留
+ *   4     4     设备序号
+ *   8     8     采集时间（UTC 毫秒）
+ *   16    28    V1~V7 测量值 ×100（int32）
+ *
+ * @param record 记录
+ * @param buf 输出缓冲区，至少 B39_WIRE_SIZE 字节
+ */
+void b39_record_encode(const b39_record_t *record, uint8_t *buf);
+
+/**
+ * @brief 变化上报：判断一帧是否需要上报，需要时更新最后一次上报的值
+ *
+ * 任一测量值与最后一次上报的值相差超过其阈值、距最后一次上报已达心跳间隔，
+ * 或帧带有 B39_DEADBAND_ALWAYS_REPORT 标志时上报。与最后一次上报的值而不是上一帧比较，
+ * 缓慢漂移累计超过阈值后同样会上报。
+ *
+ * @param deadband 过滤状态
+ * @param record 记录
+ * @param thresholds 各测量值的阈值（×100）
+ * @param heartbeat_ms 无变化时的最长上报间隔
+ * @param now_ms 当前单调时间
+ * @return true 上报，false 过滤
+ */
+bool b39_deadband_check(b39_deadband_t *deadband, const b39_record_t *record,
+                        const int32_t thresholds[B39_VALUE_COUNT], uint32_t heartbeat_ms, int64_t now_ms);
+
+/**
+ * @brief 将一帧计入汇总（count 为 0 时开始新的窗口）
+ * @param summary 汇总统计
+ * @param record 记录
+ * @param start_ms 窗口内第一帧的采集时间
+ */
+void b39_summary_add(b39_summary_t *summary, const b39_record_t *record, int64_t start_ms);
+
+/**
+ * @brief 将汇总编码为 JSON 对象
+ *
+ * {"ts":<窗口第一帧采集时间>,"flags":N,"duration_ms":D,"count":C,"seq_first":F,"seq_last":L,
+ *  "min":[...],"max":[...],"last":[...],"mean":[...],"m2":[...],"c2":[...]}
+ *
+ * @param head 汇总帧的帧头
+ * @param summary 汇总统计
+ * @param buf 输出缓冲区，至少 B39_SUMMARY_JSON_MAX 字节
+ * @param size 缓冲区大小
+ * @return JSON 长度，缓冲区不足时返回 0
+ */
+size_t b39_summary_to_json(const b39_record_t *head, const b39_summary_t *summary, char *buf, size_t size);
+
+#endif // B39_RECORD_H
@@ -9,7 +9,7 @@
 #define EXAMPLE_USB_HOST_PRIORITY (10)
 #define EXAMPLE_USB_DEVICE_VID (0x303A)
 #define EXAMPLE_USB_DEVICE_PID (0x1001)
-#define RX_BUFFER_SIZE (2048)
+#define RX_FRAME_MAX_LEN (256)  // 单行串口数据最大长度
 
 // SmartConfig 配网配置
 #define SMARTCONFIG_TIMEOUT_MS 120000  // 配网超时时间 2 分钟
@@ -17,6 +17,7 @@
 
 // HTTP 服务器配置
 #define HTTP_SERVER_PORT 80
+#define HTTP_URI_MAX_LEN 256  // 上报地址最大长度
 
 // WiFi 重连延迟（毫秒）
 #define WIFI_RECONNECT_DELAY_MS 3000
@@ -25,10 +26,44 @@
 #define WIFI_RECONNECT_TASK_PRIORITY 3
 #define WIFI_RECONNECT_TASK_STACK_SIZE 4096
 
-#define HTTP_QUEUE_SIZE 5
+#define HTTP_RING_SIZE 8192  // 上传环形缓冲区大小（必须为 2 的幂）
 #define HTTP_TASK_PRIORITY 5
 #define HTTP_TASK_STACK_SIZE 8192
 
+// 批量上报配置（HTTP_BATCH_MAX_FRAMES 为 1 时关闭批量模式）
+#define HTTP_BATCH_MAX_FRAMES 20      // 每批最多帧数
+#define HTTP_BATCH_WINDOW_MS 2000     // 从第一帧到达起最长等待时间
+#define HTTP_BATCH_PATH "/batch"      // 批量接口路径（追加在上报地址之后）
+#define HTTP_SUMMARY_PATH "/summary"  // 汇总接口路径（追加在上报地址之后）
+
+// 汇总模式（可通过 /api/config 的 summary_window_s 修改，保存在 NVS 中）
+#define SUMMARY_WINDOW_S 0            // 0: 逐行上报原始数据；>0: 每个窗口只上报一条汇总（秒）
+#define SUMMARY_WINDOW_MAX_S 3600     // 汇总窗口上限
+
+// 变化上报（逐条上报时生效，可通过 /api/config 的 deadband 与 heartbeat_s 修改，保存在 NVS 中）
+// 各测量值（V1~V7）的变化阈值 ×100，未超过阈值的帧不上报；全为 0 时每帧都上报
+#define DEADBAND_DEFAULT { 0, 0, 0, 0, 0, 0, 0 }
+#define HEARTBEAT_S 300               // 无变化时的最长上报间隔（秒）
+#define HEARTBEAT_MAX_S 3600          // 最长上报间隔上限
+
+// 本地历史数据（GET /api/history），每帧 37 字节
+#define HISTORY_CAPACITY_PSRAM 16384  // 有 PSRAM 时保存的帧数（约 600KB）
+#define HISTORY_CAPACITY_INTERNAL 1024 // 没有 PSRAM 时保存的帧数（约 37KB）
+#define HISTORY_DEFAULT_LIMIT 100     // 未指定 limit 时返回的帧数
+
+// 二进制上报格式（服务器不支持时自动回退为 JSON）
+#define HTTP_UPLOAD_BINARY 0          // 1: 以 application/vnd.b39.record 格式上报
+
+// 离线缓存配置
+#define OFFLINE_LOG_PARTITION "offline"       // 离线缓存分区名
+#define OFFLINE_DRAIN_MAX_FRAMES 64           // 每次补传的最大帧数
+#define OFFLINE_DRAIN_BUF_SIZE 8192           // 补传读取缓冲区大小
+#define OFFLINE_RETRY_INTERVAL_MS 10000       // 补传失败后的重试间隔
+
+// 时间同步配置（服务器可在 Web 页面或 /api/config 修改并保存在 NVS 中，例如局域网内的 NTP 服务器）
+#define SNTP_SERVER "pool.ntp.org"            // 默认 SNTP 服务器
+#define SNTP_SERVER_MAX_LEN 64                // SNTP 服务器地址最大长度
+
 // GPIO 按键配置
 #define GPIO_BUTTON_PIN 14                    // GPIO14 按键引脚
 #define GPIO_BUTTON_TASK_PRIORITY 4           // 按键任务优先级
@@ -0,0 +1,137 @@
+/*
+ * 本地历史数据模块实现
+ */
+
+#include "history.h"
+#include "time_sync.h"
+#include "config.h"
+
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "HISTORY";
+
+// 按列存放，每帧 37 字节；下标为写入序号对容量取模
+static struct {
+    uint32_t *time_s;                       // 采集时间（秒，未同步时为开机以来的秒数）
+    uint32_t *sequence;
+    int32_t *values[B39_VALUE_COUNT];       // 测量值 ×100
+    uint8_t *flags;
+    uint32_t capacity;
+    uint32_t next;                          // 下一帧的写入序号
+    bool psram;
+} s_history;
+
+// 写入在 USB 接收回调中、读取在 HTTP 服务器任务中，每次只在锁内复制少量数据
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 每帧占用的字节数
+#define HISTORY_ENTRY_SIZE (sizeof(uint32_t) * 2 + sizeof(int32_t) * B39_VALUE_COUNT + sizeof(uint8_t))
+
+void history_init(void)
+{
+    uint32_t capacity = HISTORY_CAPACITY_PSRAM;
+    uint8_t *block = heap_caps_malloc(capacity * HISTORY_ENTRY_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_history.psram = (block != NULL);
+    if (block == NULL) {
+        capacity = HISTORY_CAPACITY_INTERNAL;
+        block = heap_caps_malloc(capacity * HISTORY_ENTRY_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (block == NULL) {
+        ESP_LOGE(TAG, "无法分配历史数据存储区, 本地历史不可用");
+        return;
+    }
+
+    // 4 字节的列在前，1 字节的标志列在最后，各列均保持对齐
+    s_history.time_s = (uint32_t *)block;
+    s_history.sequence = s_history.time_s + capacity;
+    int32_t *column = (int32_t *)(s_history.sequence + capacity);
+    for (int i = 0; i < B39_VALUE_COUNT; i++) {
+        s_history.values[i] = column;
+        column += capacity;
+    }
+    s_history.flags = (uint8_t *)column;
+    s_history.capacity = capacity;
+
+    ESP_LOGI(TAG, "本地历史: %" PRIu32 " 帧, %u 字节 (%s)", capacity,
+             (unsigned)(capacity * HISTORY_ENTRY_SIZE), s_history.psram ? "PSRAM" : "内部RAM");
+}
+
+void history_append(const b39_record_t *record)
+{
+    if (s_history.capacity == 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    uint32_t idx = s_history.next % s_history.capacity;
+    s_history.time_s[idx] = (uint32_t)(record->captured_at_ms / 1000);
+    s_history.sequence[idx] = record->sequence;
+    for (int i = 0; i < B39_VALUE_COUNT; i++) {
+        s_history.values[i][idx] = record->values[i];
+    }
+    s_history.flags[idx] = record->flags;
+    s_history.next++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/**
+ * @brief 最旧一帧的写入序号（需持有锁）
+ */
+static uint32_t history_oldest_locked(void)
+{
+    return s_history.next > s_history.capacity ? s_history.next - s_history.capacity : 0;
+}
+
+size_t history_read(uint32_t *cursor, b39_record_t *out, size_t max)
+{
+    size_t count = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    uint32_t pos = *cursor;
+    uint32_t oldest = history_oldest_locked();
+    if (pos < oldest) {
+        pos = oldest;
+    }
+    for (; pos < s_history.next && count < max; pos++, count++) {
+        uint32_t idx = pos % s_history.capacity;
+        b39_record_t *record = &out[count];
+        record->captured_at_ms = (int64_t)s_history.time_s[idx] * 1000;
+        record->sequence = s_history.sequence[idx];
+        for (int i = 0; i < B39_VALUE_COUNT; i++) {
+            record->values[i] = s_history.values[i][idx];
+        }
+        record->flags = s_history.flags[idx];
+    }
+    portEXIT_CRITICAL(&s_lock);
+    *cursor = pos;
+
+    for (size_t i = 0; i < count; i++) {
+        int64_t utc_ms;
+        if ((out[i].flags & B39_FLAG_TIME_UNSYNCED) && time_sync_to_utc(out[i].captured_at_ms, &utc_ms)) {
+            out[i].captured_at_ms = utc_ms;
+            out[i].flags &= ~B39_FLAG_TIME_UNSYNCED;
+        }
+    }
+    return count;
+}
+
+void history_range(uint32_t *oldest, uint32_t *next)
+{
+    portENTER_CRITICAL(&s_lock);
+    *oldest = history_oldest_locked();
+    *next = s_history.next;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t history_capacity(void)
+{
+    return s_history.capacity;
+}
+
+bool history_in_psram(void)
+{
+    return s_history.psram;
+}
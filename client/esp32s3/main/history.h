@@ -0,0 +1,58 @@
+/*
+ * 本地历史数据模块头文件
+ *
+ * 在内存中按列保存最近若干帧解析后的数据（时间精确到秒，测量值为 ×100 定点整数），
+ * 写满后覆盖最旧的数据，供设备 HTTP 接口在服务器不可用时直接查询。
+ * 优先分配在 PSRAM 中，没有 PSRAM 时使用较小的内部 RAM 容量。
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "b39_record.h"
+
+/**
+ * @brief 分配历史数据存储区
+ */
+void history_init(void);
+
+/**
+ * @brief 追加一帧（在 USB 接收回调中调用，每帧解析成功后）
+ * @param record 记录
+ */
+void history_append(const b39_record_t *record);
+
+/**
+ * @brief 按顺序读取若干帧
+ *
+ * cursor 为帧的写入序号（从 0 开始累计），指向的帧已被覆盖时跳到最旧的一帧；
+ * 本次开机未同步时记录的时间在读取时尽量换算为 UTC（并清除未同步标志）。
+ *
+ * @param cursor 输入起始序号，输出下一次读取的序号
+ * @param out 输出记录
+ * @param max 最多读取的帧数
+ * @return 实际读取的帧数
+ */
+size_t history_read(uint32_t *cursor, b39_record_t *out, size_t max);
+
+/**
+ * @brief 获取写入序号范围
+ * @param oldest 输出最旧一帧的写入序号
+ * @param next 输出下一帧的写入序号（oldest == next 时为空）
+ */
+void history_range(uint32_t *oldest, uint32_t *next);
+
+/**
+ * @brief 获取容量（帧数），未分配成功时为 0
+ */
+uint32_t history_capacity(void);
+
+/**
+ * @brief 存储区是否在 PSRAM 中
+ */
+bool history_in_psram(void);
+
+#endif // HISTORY_H
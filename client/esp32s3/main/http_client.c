@@ -6,103 +6,565 @@
 #include "http_server.h"
 #include "wifi_manager.h"
 #include "led_status.h"
+#include "ring_buffer.h"
+#include "offline_log.h"
+#include "b39_record.h"
+#include "time_sync.h"
 #include "config.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
 #include "esp_log.h"
+#include "esp_mac.h"
 #include "esp_http_client.h"
+#include "freertos/task.h"
 
 static const char *TAG = "HTTP";
 
-QueueHandle_t http_request_queue = NULL;
+// JSON 请求体的固定前缀，数据部分直接从环形缓冲区写出
+static const char JSON_PREFIX[] = "{\"data\":\"";
 
-void http_request_task(void *arg)
+// 上传环形缓冲区（USB 接收回调为生产者，HTTP 任务为消费者）
+static uint8_t s_ring_storage[HTTP_RING_SIZE] __attribute__((aligned(4)));
+static ring_buffer_t s_ring;
+
+static TaskHandle_t s_http_task = NULL;
+
+// 长连接 HTTP 客户端（仅在 HTTP 任务中访问）及其对应的上报地址版本
+static esp_http_client_handle_t s_client = NULL;
+static uint32_t s_client_uri_version = 0;
+
+// 设备ID（WiFi STA MAC 地址的十六进制字符串），通过 X-Device-ID 请求头上报
+static char s_device_id[13] = "";
+
+// 是否使用二进制格式上报（服务器返回 415 时回退为 JSON，上报地址变更后重新尝试）
+static bool s_binary_enabled = HTTP_UPLOAD_BINARY;
+
+// 一次上报请求
+typedef struct {
+    const ring_slice_t *frames;     // 上传帧: [b39_record_t][原始数据行]
+    size_t count;                   // 帧数
+    bool batch;                     // 发送到批量接口
+    bool summary;                   // 汇总帧（以 JSON 数组发送到汇总接口）
+    bool binary;                    // 使用二进制格式
+    bool live;                      // 帧来自本次开机的环形缓冲区（未同步的采集时间可换算为 UTC）
+} http_upload_t;
+
+/**
+ * @brief 写出请求体的一段
+ */
+static bool http_write_all(esp_http_client_handle_t client, const char *buf, size_t len)
 {
-    http_request_t req;
-    char post_data[RX_BUFFER_SIZE + 100];
+    return esp_http_client_write(client, buf, (int)len) == (int)len;
+}
 
-    while (1) {
-        if (xQueueReceive(http_request_queue, &req, portMAX_DELAY) == pdTRUE) {
-            ESP_LOGI(TAG, "接收到数据: %.*s", req.len, req.data);
+/**
+ * @brief 获取长连接 HTTP 客户端，上报地址变更后重建
+ */
+static esp_http_client_handle_t http_get_client(const char *uri)
+{
+    uint32_t uri_version = http_server_get_uri_version();
+    if (s_client != NULL && s_client_uri_version != uri_version) {
+        ESP_LOGI(TAG, "上报地址已变更, 重建HTTP客户端");
+        esp_http_client_cleanup(s_client);
+        s_client = NULL;
+    }
 
-            // 检查WiFi是否已连接
-            if (!wifi_connected) {
-                ESP_LOGW(TAG, "WiFi未连接, 跳过HTTP请求");
-                continue;
-            }
+    if (s_client == NULL) {
+        esp_http_client_config_t config = {
+            .url = uri,
+            .method = HTTP_METHOD_POST,
+            .timeout_ms = 5000,
+            .keep_alive_enable = true,
+        };
 
-            // 获取当前配置的 HTTP URI
-            const char *current_uri = http_server_get_uri();
-            ESP_LOGI(TAG, "HTTP任务处理数据: %.*s, 目标URI: %s", req.len, req.data, current_uri);
+        s_client = esp_http_client_init(&config);
+        if (s_client == NULL) {
+            ESP_LOGE(TAG, "HTTP客户端初始化失败");
+            return NULL;
+        }
+        s_client_uri_version = uri_version;
 
-            // 检查是否已配置目标URI
-            if (current_uri == NULL || strlen(current_uri) == 0) {
-                ESP_LOGW(TAG, "HTTP URI 未配置, 跳过HTTP请求");
-                continue;
-            }
+        // 设置请求头
+        esp_http_client_set_header(s_client, "X-Device-ID", s_device_id);
+
+        // 新的服务器可能支持二进制格式，重新尝试
+        s_binary_enabled = HTTP_UPLOAD_BINARY;
+    }
+
+    return s_client;
+}
+
+/**
+ * @brief 获取帧中原始数据行的长度
+ */
+static size_t http_frame_line_len(const ring_slice_t *frame)
+{
+    return frame->len - B39_FRAME_HEADER_SIZE;
+}
+
+/**
+ * @brief 将未同步时记录的单调采集时间换算为 UTC
+ *
+ * 只对本次开机采集的帧有效；之前开机时写入离线缓存的帧保留 B39_FLAG_TIME_UNSYNCED，
+ * 由服务器以接收时间代替
+ */
+static void http_fix_capture_time(b39_record_t *record)
+{
+    int64_t utc_ms;
+    if ((record->flags & B39_FLAG_TIME_UNSYNCED) && time_sync_to_utc(record->captured_at_ms, &utc_ms)) {
+        record->captured_at_ms = utc_ms;
+        record->flags &= ~B39_FLAG_TIME_UNSYNCED;
+    }
+}
+
+/**
+ * @brief 读取帧中的记录，本次开机的帧同时换算采集时间
+ */
+static void http_frame_record(const ring_slice_t *frame, bool live, b39_record_t *record)
+{
+    b39_frame_get_record(frame->data, record);
+    if (live) {
+        http_fix_capture_time(record);
+    }
+}
+
+/**
+ * @brief 生成单帧 JSON 后缀: ","flags":<标志>,"ts":<采集时间毫秒>}
+ * @return 后缀长度
+ */
+static size_t http_frame_suffix(char *buf, size_t size, const ring_slice_t *frame, bool live)
+{
+    b39_record_t record;
+    http_frame_record(frame, live, &record);
+    return (size_t)snprintf(buf, size, "\",\"flags\":%u,\"ts\":%" PRId64 "}", record.flags, record.captured_at_ms);
+}
+
+/**
+ * @brief 生成汇总帧的 JSON 对象（写入静态缓冲区，仅在 HTTP 任务中使用）
+ * @return JSON 长度
+ */
+static size_t http_summary_json(const ring_slice_t *frame, bool live, const char **json)
+{
+    static char buf[B39_SUMMARY_JSON_MAX];
 
-            // 构建POST数据
-            snprintf(post_data, sizeof(post_data), "{\"data\":\"%.*s\"}", (int)req.len, req.data);
-
-            // 配置HTTP客户端
-            esp_http_client_config_t config = {
-                .url = current_uri,
-                .method = HTTP_METHOD_POST,
-                .timeout_ms = 5000,
-            };
-
-            esp_http_client_handle_t client = esp_http_client_init(&config);
-            if (client == NULL) {
-                ESP_LOGE(TAG, "HTTP客户端初始化失败");
-                led_set_http_error(true);
-                continue;
+    b39_record_t head;
+    b39_summary_t summary;
+    http_frame_record(frame, live, &head);
+    b39_frame_get_summary(frame->data, &summary);
+    *json = buf;
+    return b39_summary_to_json(&head, &summary, buf, sizeof(buf));
+}
+
+/**
+ * @brief 计算请求体长度
+ */
+static size_t http_body_length(const http_upload_t *up)
+{
+    if (up->binary) {
+        return up->count * B39_WIRE_SIZE;
+    }
+    if (up->summary) {
+        const char *json;
+        size_t len = 2 + (up->count - 1);
+        for (size_t i = 0; i < up->count; i++) {
+            len += http_summary_json(&up->frames[i], up->live, &json);
+        }
+        return len;
+    }
+
+    // 每帧前后缀 + 数组括号与分隔符
+    char suffix[64];
+    size_t len = up->batch ? 2 + (up->count - 1) : 0;
+    for (size_t i = 0; i < up->count; i++) {
+        len += sizeof(JSON_PREFIX) - 1 + http_frame_line_len(&up->frames[i]) +
+               http_frame_suffix(suffix, sizeof(suffix), &up->frames[i], up->live);
+    }
+    return len;
+}
+
+/**
+ * @brief 以流式方式写出请求体（不额外拷贝帧内容）
+ *
+ * JSON 格式下单帧请求体为 {"data":"...","flags":N,"ts":T}，批量请求体为 [{...},...]；
+ * 二进制格式下依次写出每帧的 B39_WIRE_SIZE 字节编码；汇总帧的请求体总是 JSON 数组（见 b39_summary_to_json）
+ */
+static bool http_write_body(esp_http_client_handle_t client, const http_upload_t *up)
+{
+    if (up->summary) {
+        const char *json;
+        bool ok = http_write_all(client, "[", 1);
+        for (size_t i = 0; ok && i < up->count; i++) {
+            size_t len = http_summary_json(&up->frames[i], up->live, &json);
+            ok = (i == 0 || http_write_all(client, ",", 1)) && http_write_all(client, json, len);
+        }
+        return ok && http_write_all(client, "]", 1);
+    }
+
+    if (up->binary) {
+        uint8_t wire[B39_WIRE_SIZE];
+        for (size_t i = 0; i < up->count; i++) {
+            b39_record_t record;
+            http_frame_record(&up->frames[i], up->live, &record);
+            b39_record_encode(&record, wire);
+            if (!http_write_all(client, (const char *)wire, sizeof(wire))) {
+                return false;
             }
+        }
+        return true;
+    }
+
+    char suffix[64];
+    bool ok = !up->batch || http_write_all(client, "[", 1);
+    for (size_t i = 0; ok && i < up->count; i++) {
+        const ring_slice_t *frame = &up->frames[i];
+        if (up->batch && i > 0) {
+            ok = http_write_all(client, ",", 1);
+        }
+        size_t suffix_len = http_frame_suffix(suffix, sizeof(suffix), frame, up->live);
+        ok = ok &&
+             http_write_all(client, JSON_PREFIX, sizeof(JSON_PREFIX) - 1) &&
+             http_write_all(client, b39_frame_line(frame->data), http_frame_line_len(frame)) &&
+             http_write_all(client, suffix, suffix_len);
+    }
+    if (ok && up->batch) {
+        ok = http_write_all(client, "]", 1);
+    }
+    return ok;
+}
+
+/**
+ * @brief 在已有连接上发送一次请求
+ */
+static esp_err_t http_send(esp_http_client_handle_t client, const http_upload_t *up, int *status_code)
+{
+    esp_http_client_set_header(client, "Content-Type",
+                               up->binary ? B39_WIRE_CONTENT_TYPE : "application/json");
+
+    // 连接仍然有效时 open 会直接复用，否则重新建立连接
+    esp_err_t err = esp_http_client_open(client, (int)http_body_length(up));
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!http_write_body(client, up) || esp_http_client_fetch_headers(client) < 0) {
+        return ESP_FAIL;
+    }
+
+    // 读完响应体，连接才能被下一个请求复用
+    *status_code = esp_http_client_get_status_code(client);
+    esp_http_client_flush_response(client, NULL);
+    ESP_LOGI(TAG, "HTTP请求完成, 状态码: %d, 帧数: %u", *status_code, (unsigned)up->count);
+    return ESP_OK;
+}
+
+/**
+ * @brief 发送一次请求，连接失效时自动重连重试一次
+ */
+static esp_err_t http_post(const char *uri, const http_upload_t *up, int *status_code)
+{
+    esp_http_client_handle_t client = http_get_client(uri);
+    if (client == NULL) {
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = esp_http_client_set_url(client, uri);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        err = http_send(client, up, status_code);
+        if (err == ESP_OK) {
+            return ESP_OK;
+        }
+
+        // 服务器可能已关闭空闲连接，断开后重新连接
+        ESP_LOGW(TAG, "HTTP连接失效, 正在重连: %s", esp_err_to_name(err));
+        esp_http_client_close(client);
+    }
+
+    return err;
+}
+
+/**
+ * @brief 上报若干同类型的帧：原始数据行多帧时发送到批量接口，汇总帧发送到汇总接口
+ * @param live 帧来自本次开机的环形缓冲区
+ * @return ESP_OK 服务器已接收（含 4xx 拒绝的数据），其他值表示需要稍后重发
+ */
+static esp_err_t http_upload(const char *uri, const ring_slice_t *frames, size_t count, bool live)
+{
+    static char path_uri[HTTP_URI_MAX_LEN + sizeof(HTTP_SUMMARY_PATH)];
 
-            // 设置请求头
-            esp_http_client_set_header(client, "Content-Type", "application/json");
-            // 设置 POST 数据
-            esp_http_client_set_post_field(client, post_data, strlen(post_data));
-
-            // 执行请求
-            esp_err_t err = esp_http_client_perform(client);
-            if (err == ESP_OK) {
-                int status_code = esp_http_client_get_status_code(client);
-                ESP_LOGI(TAG, "HTTP请求成功, 状态码: %d", status_code);
-                // HTTP 请求成功时清除错误标志
-                led_set_http_error(false);
-            } else {
-                ESP_LOGE(TAG, "HTTP请求失败: %s", esp_err_to_name(err));
-                // HTTP 请求失败时设置 HTTP 错误标志（WiFi正常但HTTP失败会显示黄色）
-                led_set_http_error(true);
+    bool summary = b39_frame_is_summary(frames[0].data);
+    http_upload_t up = {
+        .frames = frames,
+        .count = count,
+        .batch = !summary && count > 1,
+        .summary = summary,
+        .binary = !summary && s_binary_enabled,
+        .live = live,
+    };
+
+    const char *target_uri = uri;
+    if (up.batch || up.summary) {
+        snprintf(path_uri, sizeof(path_uri), "%s%s", uri, up.summary ? HTTP_SUMMARY_PATH : HTTP_BATCH_PATH);
+        target_uri = path_uri;
+    }
+    ESP_LOGI(TAG, "HTTP任务处理 %u 帧, 目标URI: %s", (unsigned)count, target_uri);
+
+    int status_code = 0;
+    esp_err_t err = http_post(target_uri, &up, &status_code);
+    if (err == ESP_OK && status_code == 415 && up.binary) {
+        // 服务器不支持二进制格式，回退为 JSON 后重发
+        ESP_LOGW(TAG, "服务器不支持二进制格式, 改用JSON上报");
+        s_binary_enabled = false;
+        up.binary = false;
+        err = http_post(target_uri, &up, &status_code);
+    }
+    if (err == ESP_OK && status_code >= 500) {
+        // 服务端错误时保留数据稍后重发，格式错误等 4xx 重发也无意义
+        err = ESP_FAIL;
+    }
+
+    if (err == ESP_OK) {
+        // HTTP 请求成功时清除错误标志
+        led_set_http_error(false);
+    } else {
+        ESP_LOGE(TAG, "HTTP请求失败: %s", esp_err_to_name(err));
+        // HTTP 请求失败时设置 HTTP 错误标志（WiFi正常但HTTP失败会显示黄色）
+        led_set_http_error(true);
+    }
+    return err;
+}
+
+/**
+ * @brief 将未能上报的帧写入离线缓存（已同步时先将采集时间换算为 UTC）
+ */
+static void http_store_frames(const ring_slice_t *frames, size_t count)
+{
+    // 仅在 HTTP 任务中使用，放在静态区以节省任务栈
+    static uint8_t frame_buf[HTTP_FRAME_MAX_SIZE];
+
+    for (size_t i = 0; i < count; i++) {
+        b39_record_t record;
+        const uint8_t *data = frames[i].data;
+        b39_frame_get_record(data, &record);
+        if ((record.flags & B39_FLAG_TIME_UNSYNCED) && frames[i].len <= sizeof(frame_buf)) {
+            http_fix_capture_time(&record);
+            if (!(record.flags & B39_FLAG_TIME_UNSYNCED)) {
+                memcpy(frame_buf, data, frames[i].len);
+                b39_frame_set_record(frame_buf, &record);
+                data = frame_buf;
             }
+        }
+        esp_err_t err = offline_log_append(data, frames[i].len, record.captured_at_ms);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "写入离线缓存失败, 丢弃 %u 帧: %s", (unsigned)(count - i), esp_err_to_name(err));
+            return;
+        }
+    }
+    ESP_LOGI(TAG, "已写入离线缓存 %u 帧, 待补传 %u 帧", (unsigned)count, (unsigned)offline_log_pending());
+}
+
+/**
+ * @brief 获取与第一帧类型相同（原始数据行或汇总）的连续帧数，不同类型的帧分开上报
+ */
+static size_t http_same_kind(const ring_slice_t *frames, size_t count)
+{
+    bool summary = b39_frame_is_summary(frames[0].data);
+    size_t n = 1;
+    while (n < count && b39_frame_is_summary(frames[n].data) == summary) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief 从离线缓存按顺序补传一批数据
+ * @return ESP_OK 成功，其他值表示需要稍后重试
+ */
+static esp_err_t http_drain_offline(const char *uri)
+{
+    // 仅在 HTTP 任务中使用，放在静态区以节省任务栈
+    static uint8_t drain_buf[OFFLINE_DRAIN_BUF_SIZE];
+    static offline_record_t records[OFFLINE_DRAIN_MAX_FRAMES];
+    static ring_slice_t frames[OFFLINE_DRAIN_MAX_FRAMES];
+
+    size_t count = offline_log_peek(records, OFFLINE_DRAIN_MAX_FRAMES, drain_buf, sizeof(drain_buf));
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        frames[i].data = records[i].data;
+        frames[i].len = records[i].len;
+    }
+    count = http_same_kind(frames, count);
+
+    esp_err_t err = http_upload(uri, frames, count, false);
+    if (err == ESP_OK) {
+        offline_log_ack(count);
+        ESP_LOGI(TAG, "补传离线数据 %u 帧, 剩余 %u 帧", (unsigned)count, (unsigned)offline_log_pending());
+    }
+    return err;
+}
+
+/**
+ * @brief 获取上报地址，WiFi 未连接或未配置时返回 NULL
+ */
+static const char *http_upload_target(void)
+{
+    if (!wifi_connected) {
+        return NULL;
+    }
 
-            // 清理
-            esp_http_client_cleanup(client);
+    const char *uri = http_server_get_uri();
+    if (uri == NULL || uri[0] == '\0') {
+        return NULL;
+    }
+    return uri;
+}
+
+/**
+ * @brief 收集一批待上传的帧：凑满 HTTP_BATCH_MAX_FRAMES 帧或等待窗口超时即返回
+ * @return 帧数（调用前缓冲区中至少有一帧）
+ */
+static size_t http_collect_batch(ring_slice_t *frames)
+{
+    size_t count = ring_buffer_peek_batch(&s_ring, frames, HTTP_BATCH_MAX_FRAMES);
+    TickType_t window = pdMS_TO_TICKS(HTTP_BATCH_WINDOW_MS);
+    TickType_t start = xTaskGetTickCount();
+
+    while (count < HTTP_BATCH_MAX_FRAMES) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= window) {
+            break;
         }
+        ulTaskNotifyTake(pdTRUE, window - elapsed);
+        count = ring_buffer_peek_batch(&s_ring, frames, HTTP_BATCH_MAX_FRAMES);
+    }
+
+    return count;
+}
+
+/**
+ * @brief 释放已处理的帧
+ */
+static void http_release_frames(size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        ring_buffer_release(&s_ring);
     }
 }
 
-BaseType_t http_client_send(const uint8_t *data, size_t len)
+void http_request_task(void *arg)
 {
-    if (http_request_queue == NULL) {
-        return pdFALSE;
+    ring_slice_t frames[HTTP_BATCH_MAX_FRAMES];
+    TickType_t next_drain = 0;
+
+    while (1) {
+        if (!ring_buffer_peek(&s_ring, &frames[0])) {
+            // 没有新数据时补传离线缓存
+            size_t pending = offline_log_pending();
+            const char *uri = http_upload_target();
+            TickType_t wait = portMAX_DELAY;
+            if (pending > 0 && uri != NULL) {
+                TickType_t now = xTaskGetTickCount();
+                if ((int32_t)(now - next_drain) >= 0) {
+                    if (http_drain_offline(uri) != ESP_OK) {
+                        next_drain = now + pdMS_TO_TICKS(OFFLINE_RETRY_INTERVAL_MS);
+                    }
+                    continue;
+                }
+                wait = next_drain - now;
+            } else if (pending > 0) {
+                // 等待网络恢复
+                wait = pdMS_TO_TICKS(OFFLINE_RETRY_INTERVAL_MS);
+            }
+
+            // 缓冲区为空，等待生产者通知
+            ulTaskNotifyTake(pdTRUE, wait);
+            continue;
+        }
+
+        // 本轮只处理与第一帧同类型的帧，其余留在缓冲区中下一轮处理
+        size_t count = http_same_kind(frames, http_collect_batch(frames));
+        if (b39_frame_is_summary(frames[0].data)) {
+            ESP_LOGI(TAG, "接收到汇总数据 (共 %u 帧)", (unsigned)count);
+        } else {
+            ESP_LOGI(TAG, "接收到数据: %.*s (共 %u 帧)", (int)http_frame_line_len(&frames[0]),
+                     b39_frame_line(frames[0].data), (unsigned)count);
+        }
+
+        // 检查WiFi是否已连接
+        if (!wifi_connected) {
+            ESP_LOGW(TAG, "WiFi未连接, 数据写入离线缓存");
+            http_store_frames(frames, count);
+            http_release_frames(count);
+            continue;
+        }
+
+        // 检查是否已配置目标URI
+        const char *current_uri = http_upload_target();
+        if (current_uri == NULL) {
+            ESP_LOGW(TAG, "HTTP URI 未配置, 跳过HTTP请求");
+            http_release_frames(count);
+            continue;
+        }
+
+        // 离线缓存中仍有数据时新数据排在其后，保证按顺序补传
+        if (offline_log_pending() > 0) {
+            http_store_frames(frames, count);
+            http_release_frames(count);
+            continue;
+        }
+
+        if (http_upload(current_uri, frames, count, true) != ESP_OK) {
+            http_store_frames(frames, count);
+            next_drain = xTaskGetTickCount() + pdMS_TO_TICKS(OFFLINE_RETRY_INTERVAL_MS);
+        }
+
+        // 帧发送完毕后才释放缓冲区空间
+        http_release_frames(count);
     }
+}
 
-    http_request_t req;
-    size_t copy_len = (len < RX_BUFFER_SIZE - 1) ? len : (RX_BUFFER_SIZE - 1);
-    memcpy(req.data, data, copy_len);
-    req.data[copy_len] = '\0';
-    req.len = copy_len;
+uint8_t *http_client_reserve(size_t max_len)
+{
+    return ring_buffer_reserve(&s_ring, max_len);
+}
+
+void http_client_commit(size_t len)
+{
+    ring_buffer_commit(&s_ring, len);
+    if (s_http_task != NULL) {
+        xTaskNotifyGive(s_http_task);
+    }
+}
 
-    return xQueueSend(http_request_queue, &req, 0);
+void http_client_cancel(void)
+{
+    ring_buffer_cancel(&s_ring);
 }
 
 void http_client_init(void)
 {
-    // 创建HTTP请求队列
-    http_request_queue = xQueueCreate(HTTP_QUEUE_SIZE, sizeof(http_request_t));
-    assert(http_request_queue);
+    // 读取设备ID
+    uint8_t mac[6];
+    ESP_ERROR_CHECK(esp_read_mac(mac, ESP_MAC_WIFI_STA));
+    snprintf(s_device_id, sizeof(s_device_id), "%02x%02x%02x%02x%02x%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    ESP_LOGI(TAG, "设备ID: %s", s_device_id);
+
+    // 初始化上传环形缓冲区
+    bool ring_ok = ring_buffer_init(&s_ring, s_ring_storage, sizeof(s_ring_storage));
+    assert(ring_ok);
+
+    // 初始化离线缓存（失败时无法上报的数据将被丢弃）
+    if (offline_log_init() != ESP_OK) {
+        ESP_LOGW(TAG, "离线缓存不可用");
+    }
 
     // 创建HTTP请求任务
     BaseType_t http_task_created = xTaskCreate(
@@ -111,7 +573,7 @@ void http_client_init(void)
         HTTP_TASK_STACK_SIZE,
         NULL,
         HTTP_TASK_PRIORITY,
-        NULL
+        &s_http_task
     );
     assert(http_task_created == pdTRUE);
 }
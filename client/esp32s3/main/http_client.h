@@ -6,18 +6,14 @@
 #define HTTP_CLIENT_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
 #include "config.h"
+#include "b39_record.h"
 
-// HTTP请求数据结构
-typedef struct {
-    char data[RX_BUFFER_SIZE];
-    size_t len;
-} http_request_t;
-
-// HTTP 请求队列（外部访问）
-extern QueueHandle_t http_request_queue;
+// 上传帧的最大长度（原始数据行帧与汇总帧中较长者）
+#define HTTP_FRAME_MAX_SIZE (B39_FRAME_HEADER_SIZE + \
+                             (RX_FRAME_MAX_LEN > sizeof(b39_summary_t) ? RX_FRAME_MAX_LEN : sizeof(b39_summary_t)))
 
 /**
  * @brief 初始化 HTTP 客户端模块
@@ -30,11 +26,21 @@ void http_client_init(void);
 void http_request_task(void *arg);
 
 /**
- * @brief 发送数据到 HTTP 队列
- * @param data 要发送的数据
- * @param len 数据长度
- * @return pdTRUE 成功，pdFALSE 失败
+ * @brief 在上传缓冲区中预留一帧的写入空间（仅供单一生产者调用）
+ * @param max_len 帧最大长度
+ * @return 写入地址，缓冲区已满时返回 NULL
+ */
+uint8_t *http_client_reserve(size_t max_len);
+
+/**
+ * @brief 提交预留的帧并通知上传任务
+ * @param len 帧实际长度
+ */
+void http_client_commit(size_t len);
+
+/**
+ * @brief 放弃预留的帧
  */
-BaseType_t http_client_send(const uint8_t *data, size_t len);
+void http_client_cancel(void);
 
 #endif // HTTP_CLIENT_H
@@ -4,12 +4,20 @@
  */
 
 #include "http_server.h"
+#include "usb_cdc.h"
+#include "offline_log.h"
+#include "history.h"
 #include "config.h"
+#include "b39_record.h"
+#include "time_sync.h"
 
 #include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include "freertos/FreeRTOS.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_vfs.h"
@@ -23,9 +31,10 @@ static const char *TAG = "HTTP_SERVER";
 // NVS 存储配置
 #define NVS_NAMESPACE "http_config"
 #define NVS_KEY_URI   "http_uri"
-
-// HTTP URI 最大长度
-#define HTTP_URI_MAX_LEN 256
+#define NVS_KEY_SUMMARY_WINDOW "summary_win"
+#define NVS_KEY_DEADBAND "deadband"
+#define NVS_KEY_HEARTBEAT "heartbeat_s"
+#define NVS_KEY_SNTP_SERVER "sntp_server"
 
 // 文件路径最大长度
 #define FILE_PATH_MAX (ESP_VFS_PATH_MAX + 128)
@@ -33,12 +42,34 @@ static const char *TAG = "HTTP_SERVER";
 // 读取缓冲区大小
 #define SCRATCH_BUFSIZE (8192)
 
+// 本地历史每次从存储区复制并输出的帧数（每帧 JSON 约 250 字节，需小于 SCRATCH_BUFSIZE）
+#define HISTORY_CHUNK_FRAMES 24
+
+// 本地历史输出的测量值字段名（与服务器一致）
+static const char *const s_value_names[B39_VALUE_COUNT] = {
+    "particle", "pm25", "hcho", "co2", "temperature", "humidity", "voc",
+};
+
 // SPIFFS 挂载点
 #define WEB_MOUNT_POINT "/www"
 
 // 当前 HTTP URI 配置（存储在内存中，启动时从 NVS 加载）
 static char s_http_uri[HTTP_URI_MAX_LEN] = "";
 
+// HTTP URI 配置版本号（URI 变更时递增，供上传任务判断是否需要重建连接）
+static volatile uint32_t s_http_uri_version = 0;
+
+// 汇总窗口（秒），0 表示逐条上报（启动时从 NVS 加载）
+static volatile uint32_t s_summary_window_s = SUMMARY_WINDOW_S;
+
+// 变化上报阈值（×100）与心跳间隔（秒），USB 接收回调读取阈值时加锁复制
+static int32_t s_deadband[B39_VALUE_COUNT] = DEADBAND_DEFAULT;
+static volatile uint32_t s_heartbeat_s = HEARTBEAT_S;
+static portMUX_TYPE s_deadband_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// SNTP 服务器地址（启动时从 NVS 加载，修改后由时间同步模块重新启动 SNTP）
+static char s_sntp_server[SNTP_SERVER_MAX_LEN] = SNTP_SERVER;
+
 // HTTP 服务器句柄
 static httpd_handle_t s_server = NULL;
 
@@ -78,15 +109,15 @@ static esp_err_t load_uri_from_nvs(void)
 }
 
 /**
- * @brief 保存 HTTP URI 配置到 NVS
+ * @brief 保存字符串配置到 NVS
  */
-static esp_err_t save_uri_to_nvs(const char *uri)
+static esp_err_t save_str_to_nvs(const char *key, const char *value)
 {
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
     ESP_RETURN_ON_ERROR(err, TAG, "打开 NVS 失败");
 
-    err = nvs_set_str(nvs_handle, NVS_KEY_URI, uri);
+    err = nvs_set_str(nvs_handle, key, value);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "写入 NVS 失败: %s", esp_err_to_name(err));
         nvs_close(nvs_handle);
@@ -102,6 +133,143 @@ static esp_err_t save_uri_to_nvs(const char *uri)
     return err;
 }
 
+/**
+ * @brief 从 NVS 加载字符串配置，不存在或读取失败时保持默认值
+ */
+static void load_str_from_nvs(const char *key, char *value, size_t size)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;
+    }
+
+    char stored[HTTP_URI_MAX_LEN];
+    size_t length = size < sizeof(stored) ? size : sizeof(stored);
+    esp_err_t err = nvs_get_str(nvs_handle, key, stored, &length);
+    if (err == ESP_OK && stored[0] != '\0') {
+        strlcpy(value, stored, size);
+        ESP_LOGI(TAG, "从 NVS 加载 %s: %s", key, value);
+    } else if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "读取 NVS 失败: %s", esp_err_to_name(err));
+    }
+
+    nvs_close(nvs_handle);
+}
+
+/**
+ * @brief 从 NVS 加载整数配置，不存在时保持默认值
+ */
+static void load_u32_from_nvs(const char *key, volatile uint32_t *value)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;
+    }
+
+    uint32_t stored;
+    esp_err_t err = nvs_get_u32(nvs_handle, key, &stored);
+    if (err == ESP_OK) {
+        *value = stored;
+        ESP_LOGI(TAG, "从 NVS 加载 %s: %" PRIu32, key, stored);
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "读取 NVS 失败: %s", esp_err_to_name(err));
+    }
+
+    nvs_close(nvs_handle);
+}
+
+/**
+ * @brief 保存整数配置到 NVS
+ */
+static esp_err_t save_u32_to_nvs(const char *key, uint32_t value)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    ESP_RETURN_ON_ERROR(err, TAG, "打开 NVS 失败");
+
+    err = nvs_set_u32(nvs_handle, key, value);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "写入 NVS 失败: %s", esp_err_to_name(err));
+    }
+
+    nvs_close(nvs_handle);
+    return err;
+}
+
+/**
+ * @brief 从 NVS 加载二进制配置，不存在或长度不符时保持默认值
+ */
+static void load_blob_from_nvs(const char *key, void *value, size_t size)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;
+    }
+
+    uint8_t stored[64];
+    size_t length = sizeof(stored);
+    esp_err_t err = nvs_get_blob(nvs_handle, key, stored, &length);
+    if (err == ESP_OK && length == size) {
+        memcpy(value, stored, size);
+        ESP_LOGI(TAG, "从 NVS 加载 %s", key);
+    } else if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "读取 NVS 失败: %s", esp_err_to_name(err));
+    }
+
+    nvs_close(nvs_handle);
+}
+
+/**
+ * @brief 保存二进制配置到 NVS
+ */
+static esp_err_t save_blob_to_nvs(const char *key, const void *value, size_t size)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    ESP_RETURN_ON_ERROR(err, TAG, "打开 NVS 失败");
+
+    err = nvs_set_blob(nvs_handle, key, value, size);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "写入 NVS 失败: %s", esp_err_to_name(err));
+    }
+
+    nvs_close(nvs_handle);
+    return err;
+}
+
+/**
+ * @brief 解析变化阈值数组（7 个非负数，单位同测量值）为 ×100 定点数
+ */
+static bool parse_deadband(const cJSON *array, int32_t deadband[B39_VALUE_COUNT])
+{
+    if (cJSON_GetArraySize(array) != B39_VALUE_COUNT) {
+        return false;
+    }
+    for (int i = 0; i < B39_VALUE_COUNT; i++) {
+        const cJSON *item = cJSON_GetArrayItem(array, i);
+        if (!cJSON_IsNumber(item) || item->valuedouble < 0 || item->valuedouble > INT32_MAX / 100) {
+            return false;
+        }
+        deadband[i] = (int32_t)(item->valuedouble * 100 + 0.5);
+    }
+    return true;
+}
+
+/**
+ * @brief 判断数值是否为 [min, max] 内的整数（带小数的值直接拒绝，不截断）
+ */
+static bool json_is_uint_in_range(const cJSON *item, uint32_t min, uint32_t max)
+{
+    double value = item->valuedouble;
+    return value >= min && value <= max && value == (double)(uint32_t)value;
+}
+
 /**
  * @brief 根据文件扩展名设置 Content-Type
  */
@@ -221,6 +389,16 @@ static esp_err_t api_config_get_handler(httpd_req_t *req)
     }
 
     cJSON_AddStringToObject(root, "http_uri", s_http_uri);
+    cJSON_AddNumberToObject(root, "summary_window_s", s_summary_window_s);
+
+    int32_t deadband[B39_VALUE_COUNT];
+    http_server_get_deadband(deadband);
+    cJSON *deadband_array = cJSON_AddArrayToObject(root, "deadband");
+    for (int i = 0; i < B39_VALUE_COUNT; i++) {
+        cJSON_AddItemToArray(deadband_array, cJSON_CreateNumber(deadband[i] / 100.0));
+    }
+    cJSON_AddNumberToObject(root, "heartbeat_s", s_heartbeat_s);
+    cJSON_AddStringToObject(root, "sntp_server", s_sntp_server);
 
     const char *json_str = cJSON_Print(root);
     httpd_resp_sendstr(req, json_str);
@@ -231,9 +409,183 @@ static esp_err_t api_config_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/**
+ * @brief GET /api/stats - 获取数据采集统计（串口接收、序号跟踪、离线缓存）
+ */
+static esp_err_t api_stats_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON 创建失败");
+        return ESP_FAIL;
+    }
+
+    usb_cdc_stats_t stats;
+    usb_cdc_get_stats(&stats);
+
+    cJSON *rx = cJSON_AddObjectToObject(root, "rx");
+    cJSON_AddNumberToObject(rx, "frames", stats.frames);
+    cJSON_AddNumberToObject(rx, "parse_errors", stats.parse_errors);
+    cJSON_AddNumberToObject(rx, "out_of_range", stats.out_of_range);
+    cJSON_AddNumberToObject(rx, "overflows", stats.overflows);
+    cJSON_AddNumberToObject(rx, "dropped_full", stats.dropped_full);
+    cJSON_AddNumberToObject(rx, "summaries", stats.summaries);
+    cJSON_AddNumberToObject(rx, "suppressed", stats.suppressed);
+
+    cJSON *seq = cJSON_AddObjectToObject(root, "sequence");
+    if (stats.seq.started) {
+        cJSON_AddNumberToObject(seq, "last", stats.seq.last);
+    } else {
+        cJSON_AddNullToObject(seq, "last");
+    }
+    cJSON_AddNumberToObject(seq, "gaps", stats.seq.gaps);
+    cJSON_AddNumberToObject(seq, "lost", stats.seq.lost);
+    cJSON_AddNumberToObject(seq, "duplicates", stats.seq.duplicates);
+    cJSON_AddNumberToObject(seq, "resets", stats.seq.resets);
+
+    cJSON *history = cJSON_AddObjectToObject(root, "history");
+    uint32_t history_oldest, history_next;
+    history_range(&history_oldest, &history_next);
+    cJSON_AddNumberToObject(history, "capacity", history_capacity());
+    cJSON_AddNumberToObject(history, "stored", history_next - history_oldest);
+    cJSON_AddBoolToObject(history, "psram", history_in_psram());
+
+    cJSON *offline = cJSON_AddObjectToObject(root, "offline");
+    cJSON_AddNumberToObject(offline, "pending", offline_log_pending());
+    cJSON_AddNumberToObject(offline, "evicted", offline_log_evicted());
+
+    const char *json_str = cJSON_Print(root);
+    httpd_resp_sendstr(req, json_str);
+
+    free((void *)json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief 以两位小数输出 ×100 定点数
+ */
+static int format_fixed(char *buf, size_t size, int32_t value)
+{
+    int64_t v = value;
+    const char *sign = "";
+    if (v < 0) {
+        sign = "-";
+        v = -v;
+    }
+    return snprintf(buf, size, "%s%" PRId64 ".%02d", sign, v / 100, (int)(v % 100));
+}
+
+/**
+ * @brief 将一帧编码为 JSON 对象
+ * @return 写入的长度，缓冲区不足时返回 0
+ */
+static size_t history_entry_json(const b39_record_t *record, bool first, char *buf, size_t size)
+{
+    int len = snprintf(buf, size, "%s{\"captured_at\":%" PRId64 ",\"sequence_num\":%" PRIu32 ",\"flags\":%u",
+                       first ? "" : ",", record->captured_at_ms, record->sequence, record->flags);
+    for (int i = 0; i < B39_VALUE_COUNT && len > 0 && (size_t)len < size; i++) {
+        len += snprintf(buf + len, size - len, ",\"%s\":", s_value_names[i]);
+        if ((size_t)len < size) {
+            len += format_fixed(buf + len, size - len, record->values[i]);
+        }
+    }
+    if (len > 0 && (size_t)len + 1 < size) {
+        buf[len++] = '}';
+        return len;
+    }
+    return 0;
+}
+
+/**
+ * @brief GET /api/history - 分块输出本地历史数据（服务器不可用时也能直接查询设备）
+ *
+ * 参数: since=<UTC 毫秒> 只返回采集时间更晚的数据（从最早的开始）;
+ *       limit=<帧数> 最多返回的帧数（默认 HISTORY_DEFAULT_LIMIT），未指定 since 时返回最新的 limit 帧
+ * 响应: {"capacity":N,"stored":M,"psram":true,"readings":[{"captured_at":T,"sequence_num":S,"flags":F,"particle":...},...]}
+ * 同步时间前记录且无法换算为 UTC 的帧带有未同步标志（16），captured_at 为开机以来的毫秒数
+ */
+static esp_err_t api_history_get_handler(httpd_req_t *req)
+{
+    // 每次请求在 HTTP 服务器任务中串行处理，复制缓冲区不放在栈上
+    static b39_record_t chunk[HISTORY_CHUNK_FRAMES];
+
+    uint32_t limit = HISTORY_DEFAULT_LIMIT;
+    int64_t since = 0;
+    bool has_since = false;
+    char query[64];
+    char param[24];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "limit", param, sizeof(param)) == ESP_OK) {
+            limit = strtoul(param, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "since", param, sizeof(param)) == ESP_OK) {
+            since = strtoll(param, NULL, 10);
+            has_since = true;
+        }
+    }
+    if (limit == 0 || limit > history_capacity()) {
+        limit = history_capacity();
+    }
+
+    uint32_t oldest, next;
+    history_range(&oldest, &next);
+    uint32_t cursor = oldest;
+    if (!has_since && next - oldest > limit) {
+        cursor = next - limit;
+    }
+
+    rest_server_context_t *rest_context = (rest_server_context_t *)req->user_ctx;
+    char *buf = rest_context->scratch;
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    int len = snprintf(buf, SCRATCH_BUFSIZE, "{\"capacity\":%" PRIu32 ",\"stored\":%" PRIu32 ",\"psram\":%s,\"readings\":[",
+                       history_capacity(), next - oldest, history_in_psram() ? "true" : "false");
+    if (httpd_resp_send_chunk(req, buf, len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    // 只输出开始时已有的数据，持续写入时也能结束
+    uint32_t sent = 0;
+    while (sent < limit && cursor < next) {
+        size_t max = next - cursor < HISTORY_CHUNK_FRAMES ? next - cursor : HISTORY_CHUNK_FRAMES;
+        size_t count = history_read(&cursor, chunk, max);
+        if (count == 0) {
+            break;
+        }
+
+        size_t chunk_len = 0;
+        for (size_t i = 0; i < count && sent < limit; i++) {
+            if (has_since && chunk[i].captured_at_ms <= since) {
+                continue;
+            }
+            size_t n = history_entry_json(&chunk[i], sent == 0, buf + chunk_len, SCRATCH_BUFSIZE - chunk_len);
+            if (n == 0) {
+                break;
+            }
+            chunk_len += n;
+            sent++;
+        }
+        if (chunk_len > 0 && httpd_resp_send_chunk(req, buf, chunk_len) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+
+    if (httpd_resp_send_chunk(req, "]}", 2) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
 /**
  * @brief POST /api/config - 设置配置
- * 请求体格式: {"http_uri": "https://example.com/api"}
+ * 请求体格式: {"http_uri": "https://example.com/api", "summary_window_s": 60,
+ *             "deadband": [1000, 5, 5, 20, 0.2, 1, 20], "heartbeat_s": 300,
+ *             "sntp_server": "pool.ntp.org"}，各字段均可省略
  */
 static esp_err_t api_config_post_handler(httpd_req_t *req)
 {
@@ -266,27 +618,92 @@ static esp_err_t api_config_post_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    // 获取 http_uri 字段
+    // 各字段均可单独修改，但至少提供一个
     cJSON *uri_item = cJSON_GetObjectItem(root, "http_uri");
-    if (uri_item == NULL || !cJSON_IsString(uri_item)) {
+    cJSON *window_item = cJSON_GetObjectItem(root, "summary_window_s");
+    cJSON *deadband_item = cJSON_GetObjectItem(root, "deadband");
+    cJSON *heartbeat_item = cJSON_GetObjectItem(root, "heartbeat_s");
+    cJSON *sntp_item = cJSON_GetObjectItem(root, "sntp_server");
+    if ((uri_item != NULL && !cJSON_IsString(uri_item)) ||
+        (window_item != NULL && !cJSON_IsNumber(window_item)) ||
+        (deadband_item != NULL && !cJSON_IsArray(deadband_item)) ||
+        (heartbeat_item != NULL && !cJSON_IsNumber(heartbeat_item)) ||
+        (sntp_item != NULL && !cJSON_IsString(sntp_item))) {
         cJSON_Delete(root);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "缺少 http_uri 字段");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "配置字段类型错误");
+        return ESP_FAIL;
+    }
+    if (uri_item == NULL && window_item == NULL && deadband_item == NULL && heartbeat_item == NULL &&
+        sntp_item == NULL) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "缺少配置字段");
         return ESP_FAIL;
     }
 
-    const char *new_uri = uri_item->valuestring;
-    if (strlen(new_uri) >= HTTP_URI_MAX_LEN) {
+    if (uri_item != NULL && strlen(uri_item->valuestring) >= HTTP_URI_MAX_LEN) {
         cJSON_Delete(root);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "URI 过长");
         return ESP_FAIL;
     }
+    if (window_item != NULL && !json_is_uint_in_range(window_item, 0, SUMMARY_WINDOW_MAX_S)) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "汇总窗口需为 0（关闭）至上限之间的整数秒");
+        return ESP_FAIL;
+    }
+    int32_t deadband[B39_VALUE_COUNT];
+    if (deadband_item != NULL && !parse_deadband(deadband_item, deadband)) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "deadband 需为 7 个非负数");
+        return ESP_FAIL;
+    }
+    if (heartbeat_item != NULL && !json_is_uint_in_range(heartbeat_item, 1, HEARTBEAT_MAX_S)) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "心跳间隔需为 1 至上限之间的整数秒");
+        return ESP_FAIL;
+    }
+    if (sntp_item != NULL &&
+        (sntp_item->valuestring[0] == '\0' || strlen(sntp_item->valuestring) >= SNTP_SERVER_MAX_LEN)) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "SNTP 服务器地址为空或过长");
+        return ESP_FAIL;
+    }
 
-    // 更新配置
-    strncpy(s_http_uri, new_uri, HTTP_URI_MAX_LEN - 1);
-    s_http_uri[HTTP_URI_MAX_LEN - 1] = '\0';
-
-    // 保存到 NVS
-    esp_err_t err = save_uri_to_nvs(s_http_uri);
+    esp_err_t err = ESP_OK;
+    if (uri_item != NULL) {
+        // 更新配置并保存到 NVS
+        strncpy(s_http_uri, uri_item->valuestring, HTTP_URI_MAX_LEN - 1);
+        s_http_uri[HTTP_URI_MAX_LEN - 1] = '\0';
+        s_http_uri_version++;
+        err = save_str_to_nvs(NVS_KEY_URI, s_http_uri);
+        ESP_LOGI(TAG, "HTTP URI 已更新为: %s", s_http_uri);
+    }
+    if (err == ESP_OK && window_item != NULL) {
+        // 新窗口从下一条数据起生效，进行中的窗口按新窗口边界结束
+        s_summary_window_s = (uint32_t)window_item->valuedouble;
+        err = save_u32_to_nvs(NVS_KEY_SUMMARY_WINDOW, s_summary_window_s);
+        ESP_LOGI(TAG, "汇总窗口已更新为: %" PRIu32 " 秒", s_summary_window_s);
+    }
+    if (err == ESP_OK && deadband_item != NULL) {
+        portENTER_CRITICAL(&s_deadband_lock);
+        memcpy(s_deadband, deadband, sizeof(s_deadband));
+        portEXIT_CRITICAL(&s_deadband_lock);
+        err = save_blob_to_nvs(NVS_KEY_DEADBAND, deadband, sizeof(deadband));
+        ESP_LOGI(TAG, "变化阈值已更新");
+    }
+    if (err == ESP_OK && heartbeat_item != NULL) {
+        s_heartbeat_s = (uint32_t)heartbeat_item->valuedouble;
+        err = save_u32_to_nvs(NVS_KEY_HEARTBEAT, s_heartbeat_s);
+        ESP_LOGI(TAG, "心跳间隔已更新为: %" PRIu32 " 秒", s_heartbeat_s);
+    }
+    if (err == ESP_OK && sntp_item != NULL && strcmp(sntp_item->valuestring, s_sntp_server) != 0) {
+        // 立即以新服务器重新启动 SNTP，已同步的偏移量保留到新服务器同步为止
+        strlcpy(s_sntp_server, sntp_item->valuestring, sizeof(s_sntp_server));
+        err = save_str_to_nvs(NVS_KEY_SNTP_SERVER, s_sntp_server);
+        if (err == ESP_OK) {
+            err = time_sync_set_server(s_sntp_server);
+        }
+        ESP_LOGI(TAG, "SNTP 服务器已更新为: %s", s_sntp_server);
+    }
     cJSON_Delete(root);
 
     if (err != ESP_OK) {
@@ -294,8 +711,6 @@ static esp_err_t api_config_post_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "HTTP URI 已更新为: %s", s_http_uri);
-
     // 返回成功响应
     httpd_resp_set_type(req, "application/json");
     httpd_resp_sendstr(req, "{\"code\": 200,\"message\":\"配置已保存\"}");
@@ -314,6 +729,16 @@ esp_err_t http_server_init(void)
 
     // 从 NVS 加载配置
     load_uri_from_nvs();
+    load_u32_from_nvs(NVS_KEY_SUMMARY_WINDOW, &s_summary_window_s);
+    if (s_summary_window_s > SUMMARY_WINDOW_MAX_S) {
+        s_summary_window_s = SUMMARY_WINDOW_S;
+    }
+    load_blob_from_nvs(NVS_KEY_DEADBAND, s_deadband, sizeof(s_deadband));
+    load_u32_from_nvs(NVS_KEY_HEARTBEAT, &s_heartbeat_s);
+    if (s_heartbeat_s == 0 || s_heartbeat_s > HEARTBEAT_MAX_S) {
+        s_heartbeat_s = HEARTBEAT_S;
+    }
+    load_str_from_nvs(NVS_KEY_SNTP_SERVER, s_sntp_server, sizeof(s_sntp_server));
 
     // 分配服务器上下文
     s_rest_context = calloc(1, sizeof(rest_server_context_t));
@@ -358,6 +783,24 @@ esp_err_t http_server_init(void)
     };
     httpd_register_uri_handler(s_server, &api_config_post_uri);
 
+    // API: 获取数据采集统计
+    httpd_uri_t api_stats_get_uri = {
+        .uri = "/api/stats",
+        .method = HTTP_GET,
+        .handler = api_stats_get_handler,
+        .user_ctx = s_rest_context
+    };
+    httpd_register_uri_handler(s_server, &api_stats_get_uri);
+
+    // API: 本地历史数据
+    httpd_uri_t api_history_get_uri = {
+        .uri = "/api/history",
+        .method = HTTP_GET,
+        .handler = api_history_get_handler,
+        .user_ctx = s_rest_context
+    };
+    httpd_register_uri_handler(s_server, &api_history_get_uri);
+
     // 通配符处理器 - 处理所有静态文件请求（放在最后注册）
     httpd_uri_t common_get_uri = {
         .uri = "/*",
@@ -395,6 +838,11 @@ const char* http_server_get_uri(void)
     return s_http_uri;
 }
 
+uint32_t http_server_get_uri_version(void)
+{
+    return s_http_uri_version;
+}
+
 esp_err_t http_server_set_uri(const char *uri)
 {
     if (uri == NULL || strlen(uri) >= HTTP_URI_MAX_LEN) {
@@ -403,6 +851,34 @@ esp_err_t http_server_set_uri(const char *uri)
 
     strncpy(s_http_uri, uri, HTTP_URI_MAX_LEN - 1);
     s_http_uri[HTTP_URI_MAX_LEN - 1] = '\0';
+    s_http_uri_version++;
 
-    return save_uri_to_nvs(s_http_uri);
+    return save_str_to_nvs(NVS_KEY_URI, s_http_uri);
+}
+
+uint32_t http_server_get_summary_window_s(void)
+{
+    return s_summary_window_s;
+}
+
+bool http_server_get_deadband(int32_t thresholds[B39_VALUE_COUNT])
+{
+    bool enabled = false;
+    portENTER_CRITICAL(&s_deadband_lock);
+    for (int i = 0; i < B39_VALUE_COUNT; i++) {
+        thresholds[i] = s_deadband[i];
+        enabled = enabled || s_deadband[i] > 0;
+    }
+    portEXIT_CRITICAL(&s_deadband_lock);
+    return enabled;
+}
+
+uint32_t http_server_get_heartbeat_s(void)
+{
+    return s_heartbeat_s;
+}
+
+const char *http_server_get_sntp_server(void)
+{
+    return s_sntp_server;
 }
@@ -6,8 +6,11 @@
 #ifndef HTTP_SERVER_H
 #define HTTP_SERVER_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "esp_err.h"
 #include "esp_http_server.h"
+#include "b39_record.h"
 
 /**
  * @brief 初始化并启动 HTTP 服务器
@@ -27,6 +30,12 @@ esp_err_t http_server_stop(void);
  */
 const char* http_server_get_uri(void);
 
+/**
+ * @brief 获取 HTTP URI 配置版本号，每次修改 URI 后递增
+ * @return 当前版本号
+ */
+uint32_t http_server_get_uri_version(void);
+
 /**
  * @brief 设置 HTTP URI 配置
  * @param uri 新的 HTTP URI
@@ -34,4 +43,29 @@ const char* http_server_get_uri(void);
  */
 esp_err_t http_server_set_uri(const char *uri);
 
+/**
+ * @brief 获取汇总窗口配置
+ * @return 汇总窗口（秒），0 表示逐条上报
+ */
+uint32_t http_server_get_summary_window_s(void);
+
+/**
+ * @brief 获取变化上报阈值
+ * @param thresholds 输出各测量值的阈值（×100）
+ * @return true 已启用变化上报（任一阈值大于 0）
+ */
+bool http_server_get_deadband(int32_t thresholds[B39_VALUE_COUNT]);
+
+/**
+ * @brief 获取变化上报的心跳间隔
+ * @return 无变化时的最长上报间隔（秒）
+ */
+uint32_t http_server_get_heartbeat_s(void);
+
+/**
+ * @brief 获取 SNTP 服务器地址（未配置时为 config.h 中的默认值）
+ * @return SNTP 服务器地址字符串
+ */
+const char *http_server_get_sntp_server(void);
+
 #endif // HTTP_SERVER_H
@@ -22,9 +22,11 @@
 #include "http_client.h"
 #include "http_server.h"
 #include "usb_cdc.h"
+#include "history.h"
 #include "gpio_button.h"
 #include "ws2812b.h"
 #include "led_status.h"
+#include "time_sync.h"
 
 static const char *TAG = "MAIN";
 
@@ -38,6 +40,9 @@ void app_main(void)
     // 初始化 HTTP 客户端模块
     http_client_init();
 
+    // 分配本地历史数据存储区（在开始接收串口数据之前）
+    history_init();
+
     // 初始化 USB CDC 模块
     usb_cdc_init();
 
@@ -53,9 +58,12 @@ void app_main(void)
     // 初始化 WiFi 模块
     wifi_manager_init();
 
-    // 初始化 HTTP 服务器（提供 Web 配置界面和 API）
+    // 初始化 HTTP 服务器（提供 Web 配置界面和 API，同时从 NVS 加载配置）
     ESP_ERROR_CHECK(http_server_init());
 
+    // 启动 SNTP 时间同步（联网后自动同步，之后定期校准）
+    time_sync_init(http_server_get_sntp_server());
+
     // 初始化 GPIO 按键监听（必须在 WiFi 初始化之后）
     ESP_ERROR_CHECK(gpio_button_init());
 
@@ -0,0 +1,373 @@
+/*
+ * 离线缓存模块实现
+ *
+ * 分区布局: 按 4KB 扇区循环写入，每个扇区以扇区头开始，之后依次存放记录。
+ *   扇区头: [magic][扇区序号][保留]
+ *   记录:   [长度][状态][CRC32][采集时间][数据][填充至 4 字节对齐]
+ * 记录写入后只会把状态字段由 0xFFFF 改写为 0x0000（标记已发送），无需擦除。
+ * 写满一圈时擦除最旧的扇区，其中尚未发送的记录计入丢弃数。
+ */
+
+#include "offline_log.h"
+#include "config.h"
+
+#include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "OFFLINE_LOG";
+
+#define LOG_SECTOR_SIZE     4096
+#define LOG_SECTOR_MAGIC    0x4C393342      // "B39L"
+#define LOG_LEN_FREE        0xFFFF          // 未写入区域
+#define LOG_FLAG_PENDING    0xFFFF          // 待发送
+#define LOG_FLAG_SENT       0x0000          // 已发送
+
+// 扇区头
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t reserved[2];
+} log_sector_hdr_t;
+
+// 记录头
+typedef struct {
+    uint16_t len;
+    uint16_t flags;
+    uint32_t crc;
+    int64_t captured_at_ms;
+} log_record_hdr_t;
+
+// 分区内位置
+typedef struct {
+    uint32_t sector;
+    uint32_t offset;
+} log_pos_t;
+
+static const esp_partition_t *s_partition = NULL;
+static uint32_t s_sector_count = 0;
+static log_pos_t s_head;                // 下一条记录的写入位置
+static uint32_t s_head_seq = 0;         // 写扇区的序号
+static log_pos_t s_read;                // 最早一条可能未发送记录的位置
+static size_t s_pending = 0;
+static uint32_t s_evicted = 0;
+
+static inline size_t record_size(size_t len)
+{
+    return (sizeof(log_record_hdr_t) + len + 3) & ~(size_t)3;
+}
+
+static inline size_t pos_addr(const log_pos_t *pos)
+{
+    return (size_t)pos->sector * LOG_SECTOR_SIZE + pos->offset;
+}
+
+static inline bool pos_at_head(const log_pos_t *pos)
+{
+    return pos->sector == s_head.sector && pos->offset >= s_head.offset;
+}
+
+/**
+ * @brief 从 pos 开始查找下一条记录，扇区剩余部分为空时跳到下一扇区
+ * @return true 找到记录（pos 指向该记录），false 已到达写位置
+ */
+static bool log_seek_record(log_pos_t *pos, log_record_hdr_t *hdr)
+{
+    while (!pos_at_head(pos)) {
+        if (pos->offset + sizeof(*hdr) <= LOG_SECTOR_SIZE &&
+            esp_partition_read(s_partition, pos_addr(pos), hdr, sizeof(*hdr)) == ESP_OK &&
+            hdr->len != LOG_LEN_FREE &&
+            pos->offset + record_size(hdr->len) <= LOG_SECTOR_SIZE) {
+            return true;
+        }
+        if (pos->sector == s_head.sector) {
+            return false;
+        }
+        pos->sector = (pos->sector + 1) % s_sector_count;
+        pos->offset = sizeof(log_sector_hdr_t);
+    }
+    return false;
+}
+
+/**
+ * @brief 修改记录状态（只能由 1 改写为 0）
+ */
+static esp_err_t log_set_flags(const log_pos_t *pos, uint16_t flags)
+{
+    return esp_partition_write(s_partition, pos_addr(pos) + offsetof(log_record_hdr_t, flags), &flags, sizeof(flags));
+}
+
+/**
+ * @brief 擦除并初始化扇区
+ */
+static esp_err_t log_format_sector(uint32_t sector, uint32_t seq)
+{
+    esp_err_t err = esp_partition_erase_range(s_partition, (size_t)sector * LOG_SECTOR_SIZE, LOG_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    log_sector_hdr_t hdr = {
+        .magic = LOG_SECTOR_MAGIC,
+        .seq = seq,
+        .reserved = { UINT32_MAX, UINT32_MAX },
+    };
+    return esp_partition_write(s_partition, (size_t)sector * LOG_SECTOR_SIZE, &hdr, sizeof(hdr));
+}
+
+/**
+ * @brief 切换到下一个扇区，必要时丢弃最旧扇区中的未发送记录
+ */
+static esp_err_t log_advance_sector(void)
+{
+    uint32_t next = (s_head.sector + 1) % s_sector_count;
+
+    if (s_read.sector == next) {
+        // 写满一圈，统计将被擦除的未发送记录
+        log_pos_t pos = s_read;
+        log_record_hdr_t hdr;
+        uint32_t dropped = 0;
+        while (pos.sector == next && log_seek_record(&pos, &hdr)) {
+            if (pos.sector != next) {
+                break;
+            }
+            if (hdr.flags == LOG_FLAG_PENDING) {
+                dropped++;
+            }
+            pos.offset += record_size(hdr.len);
+        }
+
+        s_evicted += dropped;
+        s_pending = (s_pending > dropped) ? s_pending - dropped : 0;
+        s_read.sector = (next + 1) % s_sector_count;
+        s_read.offset = sizeof(log_sector_hdr_t);
+        if (dropped > 0) {
+            ESP_LOGW(TAG, "离线缓存已满, 丢弃最旧的 %" PRIu32 " 条记录", dropped);
+        }
+    }
+
+    esp_err_t err = log_format_sector(next, s_head_seq + 1);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "擦除扇区失败: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    s_head_seq++;
+    s_head.sector = next;
+    s_head.offset = sizeof(log_sector_hdr_t);
+    return ESP_OK;
+}
+
+esp_err_t offline_log_init(void)
+{
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, OFFLINE_LOG_PARTITION);
+    if (s_partition == NULL) {
+        ESP_LOGE(TAG, "未找到离线缓存分区: %s", OFFLINE_LOG_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    s_sector_count = s_partition->size / LOG_SECTOR_SIZE;
+    if (s_sector_count < 2) {
+        s_partition = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // 序号最大的扇区为当前写扇区
+    bool found = false;
+    for (uint32_t sector = 0; sector < s_sector_count; sector++) {
+        log_sector_hdr_t hdr;
+        if (esp_partition_read(s_partition, (size_t)sector * LOG_SECTOR_SIZE, &hdr, sizeof(hdr)) != ESP_OK ||
+            hdr.magic != LOG_SECTOR_MAGIC) {
+            continue;
+        }
+        if (!found || (int32_t)(hdr.seq - s_head_seq) > 0) {
+            s_head_seq = hdr.seq;
+            s_head.sector = sector;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        ESP_LOGI(TAG, "离线缓存分区为空, 正在初始化");
+        s_head_seq = 0;
+        s_head.sector = 0;
+        s_head.offset = sizeof(log_sector_hdr_t);
+        s_read = s_head;
+        esp_err_t err = log_format_sector(0, 0);
+        if (err != ESP_OK) {
+            s_partition = NULL;
+        }
+        return err;
+    }
+
+    // 恢复写位置
+    s_head.offset = sizeof(log_sector_hdr_t);
+    while (s_head.offset + sizeof(log_record_hdr_t) <= LOG_SECTOR_SIZE) {
+        log_record_hdr_t hdr;
+        esp_partition_read(s_partition, pos_addr(&s_head), &hdr, sizeof(hdr));
+        if (hdr.len == LOG_LEN_FREE) {
+            break;
+        }
+        if (s_head.offset + record_size(hdr.len) > LOG_SECTOR_SIZE) {
+            // 记录头损坏，放弃该扇区剩余空间
+            s_head.offset = LOG_SECTOR_SIZE;
+            break;
+        }
+        s_head.offset += record_size(hdr.len);
+    }
+
+    // 从最旧的扇区开始查找第一条未发送记录并统计待发送数量
+    uint32_t oldest = s_head.sector;
+    for (uint32_t i = 1; i < s_sector_count; i++) {
+        uint32_t sector = (s_head.sector + i) % s_sector_count;
+        log_sector_hdr_t hdr;
+        if (esp_partition_read(s_partition, (size_t)sector * LOG_SECTOR_SIZE, &hdr, sizeof(hdr)) == ESP_OK &&
+            hdr.magic == LOG_SECTOR_MAGIC) {
+            oldest = sector;
+            break;
+        }
+    }
+
+    log_pos_t pos = { .sector = oldest, .offset = sizeof(log_sector_hdr_t) };
+    log_record_hdr_t hdr;
+    bool read_found = false;
+    s_pending = 0;
+    while (log_seek_record(&pos, &hdr)) {
+        if (hdr.flags == LOG_FLAG_PENDING) {
+            if (!read_found) {
+                s_read = pos;
+                read_found = true;
+            }
+            s_pending++;
+        }
+        pos.offset += record_size(hdr.len);
+    }
+    if (!read_found) {
+        s_read = s_head;
+    }
+
+    ESP_LOGI(TAG, "离线缓存: %" PRIu32 " 个扇区, 待发送 %u 条", s_sector_count, (unsigned)s_pending);
+    return ESP_OK;
+}
+
+esp_err_t offline_log_append(const uint8_t *data, size_t len, int64_t captured_at_ms)
+{
+    if (s_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len == 0 || record_size(len) > LOG_SECTOR_SIZE - sizeof(log_sector_hdr_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (s_head.offset + record_size(len) > LOG_SECTOR_SIZE) {
+        esp_err_t err = log_advance_sector();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    log_record_hdr_t hdr = {
+        .len = (uint16_t)len,
+        .flags = LOG_FLAG_PENDING,
+        .crc = esp_rom_crc32_le(0, data, len),
+        .captured_at_ms = captured_at_ms,
+    };
+
+    // 先写记录头再写数据，掉电造成的残缺记录会在读取时因 CRC 不符被跳过
+    size_t addr = pos_addr(&s_head);
+    esp_err_t err = esp_partition_write(s_partition, addr, &hdr, sizeof(hdr));
+    if (err == ESP_OK) {
+        err = esp_partition_write(s_partition, addr + sizeof(hdr), data, len);
+    }
+    // 无论是否成功都跳过该位置，避免在已写入的区域上重复写
+    s_head.offset += record_size(len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "写入离线记录失败: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    s_pending++;
+    return ESP_OK;
+}
+
+size_t offline_log_peek(offline_record_t *records, size_t max, uint8_t *buf, size_t buf_size)
+{
+    if (s_partition == NULL) {
+        return 0;
+    }
+
+    log_pos_t pos = s_read;
+    log_record_hdr_t hdr;
+    size_t count = 0;
+    size_t used = 0;
+
+    while (count < max && log_seek_record(&pos, &hdr)) {
+        if (hdr.flags == LOG_FLAG_PENDING) {
+            if (used + hdr.len > buf_size) {
+                break;
+            }
+
+            uint8_t *data = buf + used;
+            if (esp_partition_read(s_partition, pos_addr(&pos) + sizeof(hdr), data, hdr.len) != ESP_OK ||
+                esp_rom_crc32_le(0, data, hdr.len) != hdr.crc) {
+                // 残缺记录直接标记为已发送
+                ESP_LOGW(TAG, "跳过损坏的离线记录");
+                log_set_flags(&pos, LOG_FLAG_SENT);
+                if (s_pending > 0) {
+                    s_pending--;
+                }
+            } else {
+                records[count].data = data;
+                records[count].len = hdr.len;
+                records[count].captured_at_ms = hdr.captured_at_ms;
+                used += hdr.len;
+                count++;
+            }
+        }
+        pos.offset += record_size(hdr.len);
+    }
+
+    return count;
+}
+
+esp_err_t offline_log_ack(size_t count)
+{
+    if (s_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    log_pos_t pos = s_read;
+    log_record_hdr_t hdr;
+    size_t done = 0;
+
+    while (done < count && log_seek_record(&pos, &hdr)) {
+        if (hdr.flags == LOG_FLAG_PENDING) {
+            esp_err_t err = log_set_flags(&pos, LOG_FLAG_SENT);
+            if (err != ESP_OK) {
+                s_read = pos;
+                return err;
+            }
+            done++;
+            if (s_pending > 0) {
+                s_pending--;
+            }
+        }
+        pos.offset += record_size(hdr.len);
+    }
+
+    s_read = pos;
+    return ESP_OK;
+}
+
+size_t offline_log_pending(void)
+{
+    return s_pending;
+}
+
+uint32_t offline_log_evicted(void)
+{
+    return s_evicted;
+}
@@ -0,0 +1,65 @@
+/*
+ * 离线缓存模块头文件
+ *
+ * WiFi 断开或上报失败时将数据帧追加写入独立的 flash 分区，联网后按顺序补传。
+ * 分区按扇区循环使用（天然均衡擦写），写满时擦除最旧的扇区（丢弃最旧数据）。
+ */
+
+#ifndef OFFLINE_LOG_H
+#define OFFLINE_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// 读取到的离线记录（data 指向调用方提供的缓冲区）
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    int64_t captured_at_ms;     // 采集时间（UTC 毫秒）
+} offline_record_t;
+
+/**
+ * @brief 初始化离线缓存，扫描分区恢复读写位置
+ * @return ESP_OK 成功，ESP_ERR_NOT_FOUND 未找到分区
+ */
+esp_err_t offline_log_init(void);
+
+/**
+ * @brief 追加一条记录
+ * @param data 数据
+ * @param len 数据长度
+ * @param captured_at_ms 采集时间（UTC 毫秒）
+ * @return ESP_OK 成功，其他错误码表示失败
+ */
+esp_err_t offline_log_append(const uint8_t *data, size_t len, int64_t captured_at_ms);
+
+/**
+ * @brief 按写入顺序读取最早的若干条待发送记录（不标记为已发送）
+ * @param records 输出记录数组
+ * @param max 最多读取的条数
+ * @param buf 用于存放记录数据的缓冲区
+ * @param buf_size 缓冲区大小
+ * @return 实际读取的条数
+ */
+size_t offline_log_peek(offline_record_t *records, size_t max, uint8_t *buf, size_t buf_size);
+
+/**
+ * @brief 将最早的若干条待发送记录标记为已发送
+ * @param count 条数（应与之前 offline_log_peek 的返回值一致）
+ * @return ESP_OK 成功，其他错误码表示失败
+ */
+esp_err_t offline_log_ack(size_t count);
+
+/**
+ * @brief 获取待发送的记录条数
+ */
+size_t offline_log_pending(void);
+
+/**
+ * @brief 获取因空间不足被丢弃的记录条数
+ */
+uint32_t offline_log_evicted(void);
+
+#endif // OFFLINE_LOG_H
@@ -0,0 +1,170 @@
+/*
+ * 单生产者/单消费者无锁环形缓冲区实现
+ *
+ * 存储格式: [uint32 长度][数据][填充至 4 字节对齐] ...
+ * 当尾部剩余空间放不下一条记录时写入回绕标记，消费者遇到标记后跳回起始位置，
+ * 从而保证每条记录在内存中都是连续的。
+ */
+
+#include "ring_buffer.h"
+
+#include <string.h>
+
+// 回绕标记
+#define RING_WRAP_MARKER    UINT32_MAX
+// 记录头长度
+#define RING_HEADER_SIZE    sizeof(uint32_t)
+
+static inline size_t ring_align(size_t len)
+{
+    return (len + 3) & ~(size_t)3;
+}
+
+static inline size_t ring_record_size(size_t len)
+{
+    return ring_align(RING_HEADER_SIZE + len);
+}
+
+static inline uint32_t ring_read_header(const ring_buffer_t *rb, size_t idx)
+{
+    uint32_t header;
+    memcpy(&header, rb->buf + idx, sizeof(header));
+    return header;
+}
+
+static inline void ring_write_header(ring_buffer_t *rb, size_t idx, uint32_t header)
+{
+    memcpy(rb->buf + idx, &header, sizeof(header));
+}
+
+bool ring_buffer_init(ring_buffer_t *rb, uint8_t *storage, size_t size)
+{
+    if (rb == NULL || storage == NULL || size < 16 || (size & (size - 1)) != 0) {
+        return false;
+    }
+
+    rb->buf = storage;
+    rb->size = size;
+    atomic_init(&rb->head, 0);
+    atomic_init(&rb->tail, 0);
+    rb->reserved_pos = 0;
+    rb->reserved_len = 0;
+    return true;
+}
+
+uint8_t *ring_buffer_reserve(ring_buffer_t *rb, size_t max_len)
+{
+    if (rb->reserved_len != 0 || max_len == 0) {
+        return NULL;
+    }
+
+    size_t total = ring_record_size(max_len);
+    if (total > rb->size) {
+        return NULL;
+    }
+
+    size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    size_t free_space = rb->size - (head - tail);
+    size_t idx = head & (rb->size - 1);
+    size_t contiguous = rb->size - idx;
+
+    if (contiguous < total) {
+        // 尾部空间不足，需要先回绕到起始位置
+        if (contiguous + total > free_space) {
+            return NULL;
+        }
+        ring_write_header(rb, idx, RING_WRAP_MARKER);
+        head += contiguous;
+        atomic_store_explicit(&rb->head, head, memory_order_release);
+        idx = 0;
+    } else if (total > free_space) {
+        return NULL;
+    }
+
+    rb->reserved_pos = head;
+    rb->reserved_len = max_len;
+    return rb->buf + idx + RING_HEADER_SIZE;
+}
+
+void ring_buffer_commit(ring_buffer_t *rb, size_t len)
+{
+    if (rb->reserved_len == 0) {
+        return;
+    }
+    if (len > rb->reserved_len) {
+        len = rb->reserved_len;
+    }
+
+    ring_write_header(rb, rb->reserved_pos & (rb->size - 1), (uint32_t)len);
+    atomic_store_explicit(&rb->head, rb->reserved_pos + ring_record_size(len), memory_order_release);
+    rb->reserved_len = 0;
+}
+
+void ring_buffer_cancel(ring_buffer_t *rb)
+{
+    rb->reserved_len = 0;
+}
+
+bool ring_buffer_peek(ring_buffer_t *rb, ring_slice_t *out)
+{
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+
+    while (1) {
+        size_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+        if (tail == head) {
+            return false;
+        }
+
+        size_t idx = tail & (rb->size - 1);
+        uint32_t header = ring_read_header(rb, idx);
+        if (header == RING_WRAP_MARKER) {
+            // 跳过回绕标记
+            tail += rb->size - idx;
+            atomic_store_explicit(&rb->tail, tail, memory_order_release);
+            continue;
+        }
+
+        out->data = rb->buf + idx + RING_HEADER_SIZE;
+        out->len = header;
+        return true;
+    }
+}
+
+size_t ring_buffer_peek_batch(ring_buffer_t *rb, ring_slice_t *out, size_t max)
+{
+    if (max == 0 || !ring_buffer_peek(rb, &out[0])) {
+        return 0;
+    }
+
+    size_t count = 1;
+    size_t pos = atomic_load_explicit(&rb->tail, memory_order_relaxed) + ring_record_size(out[0].len);
+    size_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+
+    while (count < max && pos != head) {
+        size_t idx = pos & (rb->size - 1);
+        uint32_t header = ring_read_header(rb, idx);
+        if (header == RING_WRAP_MARKER) {
+            pos += rb->size - idx;
+            continue;
+        }
+
+        out[count].data = rb->buf + idx + RING_HEADER_SIZE;
+        out[count].len = header;
+        pos += ring_record_size(header);
+        count++;
+    }
+
+    return count;
+}
+
+void ring_buffer_release(ring_buffer_t *rb)
+{
+    ring_slice_t slice;
+    if (!ring_buffer_peek(rb, &slice)) {
+        return;
+    }
+
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    atomic_store_explicit(&rb->tail, tail + ring_record_size(slice.len), memory_order_release);
+}
@@ -0,0 +1,80 @@
+/*
+ * 单生产者/单消费者无锁环形缓冲区头文件
+ *
+ * 缓冲区中的每条记录在内存中连续存放，生产者直接在预留空间内写入数据，
+ * 消费者以切片形式读取，整个过程不发生额外拷贝。
+ * 该模块不依赖 FreeRTOS/ESP-IDF，可在主机上单独编译。
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// 环形缓冲区结构（字段仅供模块内部使用）
+typedef struct {
+    uint8_t *buf;                   // 存储区（大小必须为 2 的幂且按 4 字节对齐）
+    size_t size;                    // 存储区大小
+    atomic_size_t head;             // 写位置（仅生产者修改）
+    atomic_size_t tail;             // 读位置（仅消费者修改）
+    size_t reserved_pos;            // 当前预留记录的位置（生产者私有）
+    size_t reserved_len;            // 当前预留的最大长度，0 表示无预留（生产者私有）
+} ring_buffer_t;
+
+// 记录切片（指向缓冲区内部，释放前有效）
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+} ring_slice_t;
+
+/**
+ * @brief 初始化环形缓冲区
+ * @param rb 缓冲区对象
+ * @param storage 存储区，大小必须为 2 的幂且不小于 16 字节
+ * @param size 存储区大小
+ * @return true 成功，false 参数无效
+ */
+bool ring_buffer_init(ring_buffer_t *rb, uint8_t *storage, size_t size);
+
+/**
+ * @brief 生产者：预留一段连续空间用于写入一条记录
+ * @param max_len 记录的最大长度
+ * @return 可写入的地址，空间不足时返回 NULL
+ */
+uint8_t *ring_buffer_reserve(ring_buffer_t *rb, size_t max_len);
+
+/**
+ * @brief 生产者：发布预留的记录
+ * @param len 实际写入的长度，不能超过预留长度
+ */
+void ring_buffer_commit(ring_buffer_t *rb, size_t len);
+
+/**
+ * @brief 生产者：放弃当前预留（不发布任何数据）
+ */
+void ring_buffer_cancel(ring_buffer_t *rb);
+
+/**
+ * @brief 消费者：获取最早的一条记录（不移除）
+ * @param out 输出切片
+ * @return true 有记录，false 缓冲区为空
+ */
+bool ring_buffer_peek(ring_buffer_t *rb, ring_slice_t *out);
+
+/**
+ * @brief 消费者：按顺序获取最早的若干条记录（不移除）
+ * @param out 输出切片数组
+ * @param max 最多获取的条数
+ * @return 实际获取的条数
+ */
+size_t ring_buffer_peek_batch(ring_buffer_t *rb, ring_slice_t *out, size_t max);
+
+/**
+ * @brief 消费者：移除最早的一条记录，该记录的切片随之失效
+ */
+void ring_buffer_release(ring_buffer_t *rb);
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,128 @@
+/*
+ * 时间同步模块实现
+ */
+
+#include "time_sync.h"
+#include "config.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_netif_sntp.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "TIME-SYNC";
+
+// 偏移量由 SNTP 回调写入，USB 接收回调与 HTTP 任务读取，64 位读写需加锁
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_offset_us = 0;     // UTC 微秒 - esp_timer 微秒
+static int64_t s_last_ms = 0;       // 最近一次返回的 UTC 采集时间，用于保证不倒退
+static bool s_synced = false;
+
+// SNTP 只保存服务器名指针，字符串需在运行期间一直有效
+static char s_server[SNTP_SERVER_MAX_LEN] = "";
+static bool s_started = false;
+
+/**
+ * @brief SNTP 同步完成回调（系统时间已设置为 tv）
+ */
+static void time_sync_on_sync(struct timeval *tv)
+{
+    int64_t utc_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    int64_t offset_us = utc_us - esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    bool first = !s_synced;
+    int64_t step_us = offset_us - s_offset_us;
+    s_offset_us = offset_us;
+    s_synced = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (first) {
+        ESP_LOGI(TAG, "时间已同步: %" PRId64 " ms", utc_us / 1000);
+    } else {
+        ESP_LOGI(TAG, "时间已校准, 偏差 %" PRId64 " us", step_us);
+    }
+}
+
+/**
+ * @brief 以 s_server 为服务器启动 SNTP
+ */
+static esp_err_t time_sync_start(void)
+{
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(s_server);
+    config.sync_cb = time_sync_on_sync;
+    esp_err_t err = esp_netif_sntp_init(&config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "SNTP 初始化失败: %s", esp_err_to_name(err));
+        return err;
+    }
+    s_started = true;
+    ESP_LOGI(TAG, "SNTP 已启动, 服务器: %s", s_server);
+    return ESP_OK;
+}
+
+void time_sync_init(const char *server)
+{
+    strncpy(s_server, server, SNTP_SERVER_MAX_LEN - 1);
+    s_server[SNTP_SERVER_MAX_LEN - 1] = '\0';
+    time_sync_start();
+}
+
+esp_err_t time_sync_set_server(const char *server)
+{
+    if (server == NULL || server[0] == '\0' || strlen(server) >= SNTP_SERVER_MAX_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // 停止后再替换服务器名；已有的偏移量保留，新服务器同步后按校准处理
+    if (s_started) {
+        esp_netif_sntp_deinit();
+        s_started = false;
+    }
+    strncpy(s_server, server, SNTP_SERVER_MAX_LEN - 1);
+    s_server[SNTP_SERVER_MAX_LEN - 1] = '\0';
+    return time_sync_start();
+}
+
+bool time_sync_is_synced(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool synced = s_synced;
+    portEXIT_CRITICAL(&s_lock);
+    return synced;
+}
+
+int64_t time_sync_now_ms(bool *synced)
+{
+    int64_t mono_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    *synced = s_synced;
+    int64_t ms = mono_us / 1000;
+    if (s_synced) {
+        // 重新校准后偏移量可能变小，采集时间保持不倒退
+        ms = (mono_us + s_offset_us) / 1000;
+        if (ms < s_last_ms) {
+            ms = s_last_ms;
+        }
+        s_last_ms = ms;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ms;
+}
+
+bool time_sync_to_utc(int64_t mono_ms, int64_t *utc_ms)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool synced = s_synced;
+    int64_t offset_us = s_offset_us;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!synced) {
+        return false;
+    }
+    *utc_ms = mono_ms + offset_us / 1000;
+    return true;
+}
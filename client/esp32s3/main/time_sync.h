@@ -0,0 +1,48 @@
+/*
+ * 时间同步模块头文件
+ *
+ * 通过 SNTP 获取 UTC 时间，记录单调时钟（esp_timer）与 UTC 的偏移量，
+ * 采集时间由单调时钟加偏移量得到：不受系统时间跳变影响，且保证不会倒退。
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief 启动 SNTP 时间同步（必须在 WiFi 初始化之后调用）
+ * @param server SNTP 服务器地址（域名或 IP）
+ */
+void time_sync_init(const char *server);
+
+/**
+ * @brief 更换 SNTP 服务器并重新启动同步（由 HTTP 任务调用）
+ * @param server SNTP 服务器地址，长度需小于 SNTP_SERVER_MAX_LEN
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 地址为空或过长
+ */
+esp_err_t time_sync_set_server(const char *server);
+
+/**
+ * @brief 是否已完成过至少一次时间同步
+ */
+bool time_sync_is_synced(void);
+
+/**
+ * @brief 获取当前采集时间（毫秒）
+ * @param synced 输出是否已同步；已同步时返回 UTC 毫秒，未同步时返回开机以来的单调时间毫秒
+ * @return 采集时间
+ */
+int64_t time_sync_now_ms(bool *synced);
+
+/**
+ * @brief 将本次开机期间未同步时记录的单调时间换算为 UTC
+ * @param mono_ms 开机以来的单调时间毫秒
+ * @param utc_ms 输出 UTC 毫秒
+ * @return true 换算成功，false 尚未同步
+ */
+bool time_sync_to_utc(int64_t mono_ms, int64_t *utc_ms);
+
+#endif // TIME_SYNC_H
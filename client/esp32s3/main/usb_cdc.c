@@ -4,12 +4,18 @@
 
 #include "usb_cdc.h"
 #include "http_client.h"
+#include "http_server.h"
 #include "led_status.h"
+#include "b39_record.h"
+#include "time_sync.h"
+#include "history.h"
 #include "config.h"
 
 #include <string.h>
+#include <inttypes.h>
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "usb/usb_host.h"
@@ -18,15 +24,208 @@
 static const char *TAG = "USB-CDC";
 static SemaphoreHandle_t device_disconnected_sem = NULL;
 
-// 接收缓冲区和相关变量
-static uint8_t rx_buffer[RX_BUFFER_SIZE];
-static size_t rx_buffer_len = 0;
+// 当前帧直接写入上传环形缓冲区的预留空间，无需中间缓冲
+// 帧布局为 [b39_record_t][原始数据行]，接收到的字节写入 rx_line
+static uint8_t *rx_frame = NULL;
+static uint8_t *rx_line = NULL;
+static size_t rx_frame_len = 0;
+// 丢弃当前行直到遇到换行符（帧过长或缓冲区已满）
+static bool rx_discard = false;
+
+// 汇总模式下当前窗口的帧头与统计（仅在 USB 接收回调中更新）
+static b39_record_t rx_summary_head;
+static b39_summary_t rx_summary = {0};
+
+// 变化上报状态（仅在 USB 接收回调中更新）
+static b39_deadband_t rx_deadband = {0};
+
+// 接收统计（仅在 USB 接收回调与设备事件回调中更新）
+static usb_cdc_stats_t rx_stats = {0};
+
+// 供 HTTP 服务器任务读取的统计快照，每次处理完接收数据后在锁内整体复制，读取方不会看到更新了一半的统计
+static usb_cdc_stats_t rx_stats_snapshot = {0};
+static portMUX_TYPE rx_stats_lock = portMUX_INITIALIZER_UNLOCKED;
 
 SemaphoreHandle_t usb_cdc_get_disconnect_sem(void)
 {
     return device_disconnected_sem;
 }
 
+void usb_cdc_get_stats(usb_cdc_stats_t *stats)
+{
+    portENTER_CRITICAL(&rx_stats_lock);
+    *stats = rx_stats_snapshot;
+    portEXIT_CRITICAL(&rx_stats_lock);
+}
+
+/**
+ * @brief 发布统计快照
+ */
+static void usb_cdc_publish_stats(void)
+{
+    portENTER_CRITICAL(&rx_stats_lock);
+    rx_stats_snapshot = rx_stats;
+    portEXIT_CRITICAL(&rx_stats_lock);
+}
+
+/**
+ * @brief 解析数据行并在帧头写入记录
+ * @return true 帧有效，false 格式错误（在本地丢弃，不再上报）
+ */
+static bool usb_cdc_stamp_frame(size_t line_len)
+{
+    b39_record_t record;
+    b39_parse_result_t result = b39_record_parse((const char *)rx_line, line_len, &record);
+    if (result != B39_PARSE_OK)
+    {
+        rx_stats.parse_errors++;
+        ESP_LOGW(TAG, "数据格式错误(%d), 丢弃: %.*s", result, (int)line_len, (const char *)rx_line);
+        return false;
+    }
+
+    // 超出量程的数据仍然上报，由服务器标记为异常
+    if (!b39_record_in_range(&record))
+    {
+        rx_stats.out_of_range++;
+        record.flags |= B39_FLAG_OUT_OF_RANGE;
+        ESP_LOGW(TAG, "数据超出量程: %.*s", (int)line_len, (const char *)rx_line);
+    }
+
+    record.flags |= b39_seq_track(&rx_stats.seq, record.sequence);
+    if (record.flags & (B39_FLAG_SEQ_GAP | B39_FLAG_SEQ_DUPLICATE | B39_FLAG_SEQ_RESET))
+    {
+        ESP_LOGW(TAG, "序号异常(标志 0x%02X): %" PRIu32, record.flags, record.sequence);
+    }
+
+    // 在收到数据行时记录采集时间，未同步时由 HTTP 任务在上报前换算为 UTC
+    bool synced;
+    record.captured_at_ms = time_sync_now_ms(&synced);
+    if (!synced)
+    {
+        record.flags |= B39_FLAG_TIME_UNSYNCED;
+    }
+    b39_frame_set_record(rx_frame, &record);
+
+    // 本地历史保存每一帧（不受汇总模式与变化上报影响）
+    history_append(&record);
+    return true;
+}
+
+/**
+ * @brief 将当前窗口的汇总作为一帧发布（复用当前帧的预留空间）
+ */
+static void usb_cdc_flush_summary(void)
+{
+    if (rx_summary.count == 0)
+    {
+        return;
+    }
+
+    if (rx_frame == NULL)
+    {
+        rx_frame = http_client_reserve(HTTP_FRAME_MAX_SIZE);
+        if (rx_frame == NULL)
+        {
+            ESP_LOGW(TAG, "上传缓冲区已满, 丢弃 %" PRIu32 " 帧的汇总", rx_summary.count);
+            rx_stats.dropped_full += rx_summary.count;
+            rx_summary.count = 0;
+            return;
+        }
+        rx_line = rx_frame + B39_FRAME_HEADER_SIZE;
+    }
+
+    b39_frame_set_record(rx_frame, &rx_summary_head);
+    b39_frame_set_summary(rx_frame, &rx_summary);
+    http_client_commit(B39_SUMMARY_FRAME_SIZE);
+    rx_frame = NULL;
+    rx_frame_len = 0;
+    rx_summary.count = 0;
+    rx_stats.summaries++;
+}
+
+/**
+ * @brief 在当前帧之前发布未结束的汇总窗口（刚从汇总模式切换回原始上报时）
+ *
+ * 环形缓冲区同时只有一个预留空间：先暂存当前帧，用其预留空间发布汇总，再重新预留并恢复当前帧，
+ * 保证上传顺序与采集顺序一致
+ *
+ * @param frame_len 当前帧长度（帧头 + 数据行）
+ * @return true 当前帧仍在 rx_frame 中，false 上传缓冲区已满，当前帧被丢弃
+ */
+static bool usb_cdc_flush_summary_before(size_t frame_len)
+{
+    static uint8_t pending[B39_FRAME_HEADER_SIZE + RX_FRAME_MAX_LEN];
+
+    if (rx_summary.count == 0)
+    {
+        return true;
+    }
+
+    memcpy(pending, rx_frame, frame_len);
+    usb_cdc_flush_summary();
+
+    rx_frame = http_client_reserve(HTTP_FRAME_MAX_SIZE);
+    if (rx_frame == NULL)
+    {
+        ESP_LOGW(TAG, "上传缓冲区已满, 丢弃当前行");
+        rx_stats.dropped_full++;
+        return false;
+    }
+    rx_line = rx_frame + B39_FRAME_HEADER_SIZE;
+    memcpy(rx_frame, pending, frame_len);
+    return true;
+}
+
+/**
+ * @brief 将当前帧计入汇总，帧进入新的时间窗口时先发布上一个窗口
+ *
+ * 窗口按采集时间对齐（如 60 秒窗口对应整分钟），未同步时间的帧与已同步的帧不在同一窗口。
+ * 窗口只在下一帧到达或设备断开时结束，数据中断期间最后一个窗口会延迟上报。
+ */
+static void usb_cdc_summarize(uint32_t window_ms)
+{
+    b39_record_t record;
+    b39_frame_get_record(rx_frame, &record);
+
+    if (rx_summary.count > 0 &&
+        (rx_summary_head.captured_at_ms / window_ms != record.captured_at_ms / window_ms ||
+         ((rx_summary_head.flags ^ record.flags) & B39_FLAG_TIME_UNSYNCED)))
+    {
+        // 预留空间用于汇总帧，当前帧已解析到 record，无需保留数据行
+        usb_cdc_flush_summary();
+    }
+
+    if (rx_summary.count == 0)
+    {
+        rx_summary_head = record;
+        rx_summary_head.flags |= B39_FLAG_SUMMARY;
+    }
+    else
+    {
+        rx_summary_head.flags |= record.flags;
+    }
+    b39_summary_add(&rx_summary, &record, rx_summary_head.captured_at_ms);
+}
+
+/**
+ * @brief 变化上报：判断当前帧是否需要上报（未启用时总是上报）
+ */
+static bool usb_cdc_should_report(void)
+{
+    int32_t thresholds[B39_VALUE_COUNT];
+    if (!http_server_get_deadband(thresholds))
+    {
+        // 重新启用时从下一帧开始比较
+        rx_deadband.started = false;
+        return true;
+    }
+
+    b39_record_t record;
+    b39_frame_get_record(rx_frame, &record);
+    return b39_deadband_check(&rx_deadband, &record, thresholds,
+                              http_server_get_heartbeat_s() * 1000, esp_timer_get_time() / 1000);
+}
+
 bool usb_cdc_handle_rx(const uint8_t *data, size_t data_len, void *arg)
 {
     // 遍历接收到的每个字节
@@ -34,34 +233,92 @@ bool usb_cdc_handle_rx(const uint8_t *data, size_t data_len, void *arg)
     {
         uint8_t byte = data[i];
 
-        // 检查缓冲区是否已满
-        if (rx_buffer_len >= RX_BUFFER_SIZE - 1)
+        if (rx_discard)
         {
-            // 缓冲区满，直接清空
-            rx_buffer_len = 0;
+            if (byte == '\n')
+            {
+                rx_discard = false;
+            }
+            continue;
         }
 
-        // 将字节存入缓冲区
-        rx_buffer[rx_buffer_len++] = byte;
+        // 为新帧预留空间
+        if (rx_frame == NULL)
+        {
+            rx_frame = http_client_reserve(HTTP_FRAME_MAX_SIZE);
+            rx_frame_len = 0;
+            if (rx_frame == NULL)
+            {
+                ESP_LOGW(TAG, "上传缓冲区已满, 丢弃当前行");
+                rx_stats.dropped_full++;
+                rx_discard = (byte != '\n');
+                continue;
+            }
+            rx_line = rx_frame + B39_FRAME_HEADER_SIZE;
+        }
+
+        // 检查帧是否过长
+        if (rx_frame_len >= RX_FRAME_MAX_LEN)
+        {
+            // 帧过长，丢弃该行（保留预留空间供下一帧使用）
+            rx_stats.overflows++;
+            rx_frame_len = 0;
+            rx_discard = (byte != '\n');
+            continue;
+        }
+
+        // 将字节直接写入预留空间
+        rx_line[rx_frame_len++] = byte;
 
         // 检测到 \r\n 结束符
-        if (byte == '\n' && rx_buffer_len > 1 && rx_buffer[rx_buffer_len - 2] == '\r')
+        if (byte == '\n' && rx_frame_len > 1 && rx_line[rx_frame_len - 2] == '\r')
         {
             // 移除 \r\n 结束符
-            rx_buffer_len -= 2;
-            rx_buffer[rx_buffer_len] = '\0';
+            size_t line_len = rx_frame_len - 2;
+            if (line_len == 0)
+            {
+                rx_frame_len = 0;
+                continue;
+            }
+
+            // 格式错误的帧直接丢弃（保留预留空间供下一帧使用）
+            if (!usb_cdc_stamp_frame(line_len))
+            {
+                rx_frame_len = 0;
+                continue;
+            }
 
-            // 将数据发送到HTTP队列
-            http_client_send(rx_buffer, rx_buffer_len);
+            rx_stats.frames++;
+            rx_frame_len = 0;
+            uint32_t window_s = http_server_get_summary_window_s();
+            if (window_s > 0)
+            {
+                // 汇总模式：只计入统计，预留空间留给下一帧
+                usb_cdc_summarize(window_s * 1000);
+            }
+            else
+            {
+                if (!usb_cdc_should_report())
+                {
+                    // 变化未超过阈值：不上报，预留空间留给下一帧
+                    // （刚从汇总模式切换回来时先用于发布未结束的窗口）
+                    rx_stats.suppressed++;
+                    usb_cdc_flush_summary();
+                }
+                else if (usb_cdc_flush_summary_before(B39_FRAME_HEADER_SIZE + line_len))
+                {
+                    // 记录采集时间与解析结果后发布帧，由HTTP任务直接读取
+                    http_client_commit(B39_FRAME_HEADER_SIZE + line_len);
+                    rx_frame = NULL;
+                }
+            }
 
             // 显示数据传输状态（LED 闪烁）
             led_blink_data_tx(100);
-
-            // 重置缓冲区
-            rx_buffer_len = 0;
         }
     }
 
+    usb_cdc_publish_stats();
     return true;
 }
 
@@ -74,6 +331,16 @@ void usb_cdc_handle_event(const cdc_acm_host_dev_event_data_t *event, void *user
         break;
     case CDC_ACM_HOST_DEVICE_DISCONNECTED:
         ESP_LOGI(TAG, "设备突然断开连接");
+        // 发布未结束的汇总窗口，未完成的数据行随之丢弃并归还预留空间，重新连接后从新的一行开始
+        usb_cdc_flush_summary();
+        if (rx_frame != NULL)
+        {
+            http_client_cancel();
+            rx_frame = NULL;
+        }
+        rx_frame_len = 0;
+        rx_discard = false;
+        usb_cdc_publish_stats();
         ESP_ERROR_CHECK(cdc_acm_host_close(event->data.cdc_hdl));
         xSemaphoreGive(device_disconnected_sem);
         break;
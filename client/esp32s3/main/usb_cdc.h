@@ -9,6 +9,19 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "usb/cdc_acm_host.h"
+#include "b39_record.h"
+
+// 串口数据接收统计
+typedef struct {
+    uint32_t frames;            // 解析成功的帧数（含计入汇总与变化上报过滤的帧）
+    uint32_t parse_errors;      // 格式错误被丢弃的行数
+    uint32_t out_of_range;      // 超出量程（仍上报）的帧数
+    uint32_t overflows;         // 超长被丢弃的行数
+    uint32_t dropped_full;      // 上传缓冲区已满被丢弃的行数
+    uint32_t summaries;         // 汇总模式下已发布的汇总帧数
+    uint32_t suppressed;        // 变化未超过阈值而未上报的帧数
+    b39_seq_tracker_t seq;      // 设备序号跟踪
+} usb_cdc_stats_t;
 
 /**
  * @brief 初始化 USB CDC 模块
@@ -30,6 +43,11 @@ bool usb_cdc_handle_rx(const uint8_t *data, size_t data_len, void *arg);
  */
 void usb_cdc_handle_event(const cdc_acm_host_dev_event_data_t *event, void *user_ctx);
 
+/**
+ * @brief 获取串口数据接收统计（可在任意任务中调用，为最近一次接收回调结束时的快照）
+ */
+void usb_cdc_get_stats(usb_cdc_stats_t *stats);
+
 /**
  * @brief 获取设备断开信号量
  */
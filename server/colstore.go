@@ -0,0 +1,556 @@
+package main
+
+import (
+	"context"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"hash/crc32"
+	"log"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+	"sync"
+	"time"
+)
+
+// 可选的列式存储: 设置环境变量 COLUMNAR_PATH 后启用, SQLite 仍是权威数据源,
+// 列存作为原始测量值的只读副本, 供需要遍历原始数据的查询按列读取
+//
+// 数据按 UTC 日期分区, 每个分区一个文件（YYYYMMDD.col）, 文件由若干只追加的数据块组成;
+// 每个数据块包含块头和时间戳、各测量值共 columnCount 列, 各列独立压缩（见 gorilla.go）;
+// 读取时内存映射分区文件, 只解码查询所需的列
+const (
+	columnChunkRows   = 4096 // 每个数据块最多行数
+	columnCount       = metricCount + 1
+	columnHeaderSize  = 4 + 4 + 4 + 8 + 8 + 8 + columnCount*4 + 4
+	columnVersion     = 1
+	columnFileSuffix  = ".col"
+	columnDayMillis   = 86400 * 1000
+	columnCatchUpRows = rollupBackfillChunk
+)
+
+var columnMagic = [4]byte{'B', '3', '9', 'C'}
+
+// allMetricsMask 全部测量值列
+const allMetricsMask = 1<<metricCount - 1
+
+var errColumnStoreFailed = errors.New("列存写入失败, 已停用")
+
+// columnChunk 已落盘数据块的索引
+//
+// 块头: 魔数(4) 版本(1)+保留(3) 行数(4) 最小/最大时间戳(8+8) 最后一条记录 id(8) 各列长度(4*columnCount) 列数据 CRC32(4)
+type columnChunk struct {
+	offset       int64 // 块头在文件中的偏移
+	rows         int
+	minTS, maxTS int64 // 毫秒
+	lastID       uint
+	colLen       [columnCount]uint32
+}
+
+// dataOffset 第 col 列数据在文件中的偏移
+func (c *columnChunk) dataOffset(col int) int64 {
+	off := c.offset + columnHeaderSize
+	for i := 0; i < col; i++ {
+		off += int64(c.colLen[i])
+	}
+	return off
+}
+
+// size 数据块总字节数
+func (c *columnChunk) size() int64 {
+	return c.dataOffset(columnCount) - c.offset
+}
+
+// columnPartition 一天的数据
+type columnPartition struct {
+	day    int64 // 距 Unix 纪元的天数（UTC）
+	path   string
+	chunks []columnChunk
+}
+
+// columnBuffer 尚未落盘的数据块
+type columnBuffer struct {
+	day    int64
+	ts     []int64
+	values [metricCount][]float64
+	lastID uint
+}
+
+func (b *columnBuffer) reset() {
+	b.ts = b.ts[:0]
+	for i := range b.values {
+		b.values[i] = b.values[i][:0]
+	}
+}
+
+// columnStore 列式存储
+type columnStore struct {
+	dir        string
+	mu         sync.RWMutex
+	partitions []*columnPartition // 按日期升序
+	open       columnBuffer
+	lastID     uint // 已写入（含未落盘）的最大记录 id
+	failed     bool
+}
+
+var columns *columnStore
+
+// floorDiv 向下取整的除法
+func floorDiv(a, b int64) int64 {
+	return (a - floorMod(a, b)) / b
+}
+
+// openColumnStore 打开列存目录并加载各分区的数据块索引, 末尾写了一半的数据块会被截掉
+func openColumnStore(dir string) (*columnStore, error) {
+	if err := os.MkdirAll(dir, 0o755); err != nil {
+		return nil, err
+	}
+	paths, err := filepath.Glob(filepath.Join(dir, "*"+columnFileSuffix))
+	if err != nil {
+		return nil, err
+	}
+
+	s := &columnStore{dir: dir}
+	for _, path := range paths {
+		t, err := time.Parse("20060102", strings.TrimSuffix(filepath.Base(path), columnFileSuffix))
+		if err != nil {
+			continue
+		}
+		p := &columnPartition{day: floorDiv(t.UnixMilli(), columnDayMillis), path: path}
+		if err := p.load(); err != nil {
+			return nil, err
+		}
+		for _, c := range p.chunks {
+			s.lastID = max(s.lastID, c.lastID)
+		}
+		s.partitions = append(s.partitions, p)
+	}
+	sort.Slice(s.partitions, func(i, j int) bool { return s.partitions[i].day < s.partitions[j].day })
+	return s, nil
+}
+
+// load 读取分区文件中的全部块头
+func (p *columnPartition) load() error {
+	data, unmap, err := mapFile(p.path)
+	if err != nil {
+		return err
+	}
+	defer unmap()
+
+	var offset int64
+	for offset < int64(len(data)) {
+		c, err := parseColumnChunk(data, offset)
+		if err != nil {
+			break
+		}
+		p.chunks = append(p.chunks, c)
+		offset += c.size()
+	}
+	if offset < int64(len(data)) {
+		log.Printf("列存分区 %s 末尾数据块不完整, 截断 %d 字节\n", p.path, int64(len(data))-offset)
+		return os.Truncate(p.path, offset)
+	}
+	return nil
+}
+
+// parseColumnChunk 解析并校验 offset 处的数据块
+func parseColumnChunk(data []byte, offset int64) (columnChunk, error) {
+	c := columnChunk{offset: offset}
+	if int64(len(data))-offset < columnHeaderSize {
+		return c, errColumnCorrupt
+	}
+	h := data[offset : offset+columnHeaderSize]
+	if [4]byte(h[0:4]) != columnMagic || h[4] != columnVersion {
+		return c, errColumnCorrupt
+	}
+	c.rows = int(binary.LittleEndian.Uint32(h[8:]))
+	c.minTS = int64(binary.LittleEndian.Uint64(h[12:]))
+	c.maxTS = int64(binary.LittleEndian.Uint64(h[20:]))
+	c.lastID = uint(binary.LittleEndian.Uint64(h[28:]))
+	for i := range c.colLen {
+		c.colLen[i] = binary.LittleEndian.Uint32(h[36+i*4:])
+	}
+	end := c.offset + c.size()
+	if end > int64(len(data)) {
+		return c, errColumnCorrupt
+	}
+	if crc32.ChecksumIEEE(data[offset+columnHeaderSize:end]) != binary.LittleEndian.Uint32(h[columnHeaderSize-4:]) {
+		return c, errColumnCorrupt
+	}
+	return c, nil
+}
+
+// partition 获取（或创建）某天的分区, 调用方需持有写锁
+func (s *columnStore) partition(day int64) *columnPartition {
+	i := sort.Search(len(s.partitions), func(i int) bool { return s.partitions[i].day >= day })
+	if i < len(s.partitions) && s.partitions[i].day == day {
+		return s.partitions[i]
+	}
+	name := time.UnixMilli(day*columnDayMillis).UTC().Format("20060102") + columnFileSuffix
+	p := &columnPartition{day: day, path: filepath.Join(s.dir, name)}
+	s.partitions = append(s.partitions, nil)
+	copy(s.partitions[i+1:], s.partitions[i:])
+	s.partitions[i] = p
+	return p
+}
+
+// Append 追加已写入 SQLite 的记录（需已分配 id）, id 不大于已写入最大 id 的记录会被跳过
+func (s *columnStore) Append(records []SensorData) error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if s.failed {
+		return errColumnStoreFailed
+	}
+
+	for i := range records {
+		d := &records[i]
+		if d.ID <= s.lastID {
+			continue
+		}
+		ts := d.CapturedAt.UnixMilli()
+		day := floorDiv(ts, columnDayMillis)
+		if len(s.open.ts) > 0 && (day != s.open.day || len(s.open.ts) >= columnChunkRows) {
+			if err := s.seal(); err != nil {
+				return err
+			}
+		}
+		s.open.day = day
+		s.open.ts = append(s.open.ts, ts)
+		for m, v := range d.metricValues() {
+			s.open.values[m] = append(s.open.values[m], v)
+		}
+		s.open.lastID = d.ID
+		s.lastID = d.ID
+	}
+	return nil
+}
+
+// seal 将未落盘的数据块压缩后追加到分区文件, 调用方需持有写锁;
+// 失败时停用列存（查询回退到 SQLite）, 重新执行迁移后恢复
+func (s *columnStore) seal() error {
+	if len(s.open.ts) == 0 {
+		return nil
+	}
+
+	cols := make([][]byte, 0, columnCount)
+	cols = append(cols, encodeTimestamps(s.open.ts))
+	for m := range s.open.values {
+		cols = append(cols, encodeFloats(s.open.values[m]))
+	}
+
+	c := columnChunk{rows: len(s.open.ts), minTS: s.open.ts[0], maxTS: s.open.ts[0], lastID: s.open.lastID}
+	for _, ts := range s.open.ts {
+		c.minTS = min(c.minTS, ts)
+		c.maxTS = max(c.maxTS, ts)
+	}
+	crc := crc32.NewIEEE()
+	for i, col := range cols {
+		c.colLen[i] = uint32(len(col))
+		crc.Write(col)
+	}
+
+	header := make([]byte, columnHeaderSize)
+	copy(header, columnMagic[:])
+	header[4] = columnVersion
+	binary.LittleEndian.PutUint32(header[8:], uint32(c.rows))
+	binary.LittleEndian.PutUint64(header[12:], uint64(c.minTS))
+	binary.LittleEndian.PutUint64(header[20:], uint64(c.maxTS))
+	binary.LittleEndian.PutUint64(header[28:], uint64(c.lastID))
+	for i, l := range c.colLen {
+		binary.LittleEndian.PutUint32(header[36+i*4:], l)
+	}
+	binary.LittleEndian.PutUint32(header[columnHeaderSize-4:], crc.Sum32())
+
+	p := s.partition(s.open.day)
+	err := p.write(&c, header, cols)
+	if err != nil {
+		s.failed = true
+		log.Printf("列存写入失败, 已停用列存: %v\n", err)
+		return errColumnStoreFailed
+	}
+	p.chunks = append(p.chunks, c)
+	s.open.reset()
+	return nil
+}
+
+// write 追加一个数据块并刷盘, 成功后设置数据块的偏移
+func (p *columnPartition) write(c *columnChunk, header []byte, cols [][]byte) error {
+	f, err := os.OpenFile(p.path, os.O_CREATE|os.O_WRONLY, 0o644)
+	if err != nil {
+		return err
+	}
+	defer f.Close()
+
+	offset, err := f.Seek(0, 2)
+	if err != nil {
+		return err
+	}
+	buf := append([]byte{}, header...)
+	for _, col := range cols {
+		buf = append(buf, col...)
+	}
+	if _, err := f.Write(buf); err != nil {
+		return err
+	}
+	if err := f.Sync(); err != nil {
+		return err
+	}
+	c.offset = offset
+	return nil
+}
+
+// Close 将未落盘的数据写入文件
+func (s *columnStore) Close() error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if s.failed {
+		return nil
+	}
+	return s.seal()
+}
+
+// Healthy 列存是否可用于查询
+func (s *columnStore) Healthy() bool {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	return !s.failed
+}
+
+// columnScanPart 一次查询涉及的分区及其数据块
+type columnScanPart struct {
+	path   string
+	chunks []columnChunk
+}
+
+// Scan 遍历 [start, end) 内的测量值, mask 按位指定需要解码的测量值（第 i 位对应 rollupMetrics[i]）,
+// 未解码的测量值为 0; 按分区、数据块的顺序输出, 不保证严格按时间排序
+func (s *columnStore) Scan(ctx context.Context, start, end time.Time, mask uint8, fn func(ts time.Time, v *[metricCount]float64)) error {
+	from, to := start.UnixMilli(), end.UnixMilli()
+
+	// 在锁内只复制索引和未落盘的数据, 解码在锁外进行
+	s.mu.RLock()
+	if s.failed {
+		s.mu.RUnlock()
+		return errColumnStoreFailed
+	}
+	var parts []columnScanPart
+	for _, p := range s.partitions {
+		if (p.day+1)*columnDayMillis <= from || p.day*columnDayMillis >= to {
+			continue
+		}
+		part := columnScanPart{path: p.path}
+		for _, c := range p.chunks {
+			if c.maxTS >= from && c.minTS < to {
+				part.chunks = append(part.chunks, c)
+			}
+		}
+		if len(part.chunks) > 0 {
+			parts = append(parts, part)
+		}
+	}
+	var openTS []int64
+	var openValues [metricCount][]float64
+	if len(s.open.ts) > 0 {
+		openTS = append(openTS, s.open.ts...)
+		for m := range openValues {
+			if mask&(1<<m) != 0 {
+				openValues[m] = append(openValues[m], s.open.values[m]...)
+			}
+		}
+	}
+	s.mu.RUnlock()
+
+	var v [metricCount]float64
+	emit := func(ts []int64, values *[metricCount][]float64) {
+		for i, t := range ts {
+			if t < from || t >= to {
+				continue
+			}
+			for m := range v {
+				if values[m] != nil {
+					v[m] = values[m][i]
+				}
+			}
+			fn(time.UnixMilli(t), &v)
+		}
+	}
+
+	var ts []int64
+	var values [metricCount][]float64
+	for _, part := range parts {
+		if err := ctx.Err(); err != nil {
+			return err
+		}
+		data, unmap, err := mapFile(part.path)
+		if err != nil {
+			return err
+		}
+		for i := range part.chunks {
+			c := &part.chunks[i]
+			if c.offset+c.size() > int64(len(data)) {
+				unmap()
+				return errColumnCorrupt
+			}
+			ts, err = decodeTimestamps(ts[:0], data[c.dataOffset(0):c.dataOffset(1)], c.rows)
+			if err != nil {
+				unmap()
+				return err
+			}
+			for m := range values {
+				if mask&(1<<m) == 0 {
+					values[m] = nil
+					continue
+				}
+				values[m], err = decodeFloats(values[m][:0], data[c.dataOffset(m+1):c.dataOffset(m+2)], c.rows)
+				if err != nil {
+					unmap()
+					return err
+				}
+			}
+			emit(ts, &values)
+		}
+		unmap()
+	}
+	emit(openTS, &openValues)
+	return nil
+}
+
+// DropBefore 删除整天早于 cutoff 的分区, 返回删除的分区数
+func (s *columnStore) DropBefore(cutoff time.Time) (int, error) {
+	lastDay := floorDiv(cutoff.UnixMilli(), columnDayMillis) // 该天及之后的分区保留
+
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	dropped := 0
+	for len(s.partitions) > 0 && s.partitions[0].day < lastDay && s.partitions[0].day != s.open.day {
+		if err := os.Remove(s.partitions[0].path); err != nil && !os.IsNotExist(err) {
+			return dropped, err
+		}
+		s.partitions = s.partitions[1:]
+		dropped++
+	}
+	return dropped, nil
+}
+
+// Metrics 获取列存统计
+func (s *columnStore) Metrics() map[string]any {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+
+	var chunks, rows, bytes int64
+	for _, p := range s.partitions {
+		for i := range p.chunks {
+			chunks++
+			rows += int64(p.chunks[i].rows)
+			bytes += p.chunks[i].size()
+		}
+	}
+	ratio := 0.0
+	if bytes > 0 {
+		ratio = float64(rows*columnCount*8) / float64(bytes)
+	}
+	return map[string]any{
+		"healthy":           !s.failed,
+		"partitions":        len(s.partitions),
+		"chunks":            chunks,
+		"rows":              rows,
+		"pending_rows":      len(s.open.ts),
+		"bytes":             bytes,
+		"compression_ratio": ratio,
+		"last_id":           s.lastID,
+	}
+}
+
+// catchUp 将 SQLite 中尚未写入列存的记录（id 大于列存最大 id）追加到列存
+//
+// 启动时执行, 补齐上次退出前未落盘的数据; 需在写入队列启动前调用
+func (s *columnStore) catchUp() error {
+	s.mu.RLock()
+	lastID := s.lastID
+	s.mu.RUnlock()
+
+	total := 0
+	for {
+		rows, err := store.scanChunk.Query(lastID, columnCatchUpRows)
+		if err != nil {
+			return err
+		}
+		records, err := scanRecords(rows, columnCatchUpRows)
+		if err != nil {
+			return err
+		}
+		if len(records) == 0 {
+			break
+		}
+		if err := s.Append(records); err != nil {
+			return err
+		}
+		lastID = records[len(records)-1].ID
+		total += len(records)
+		log.Printf("列存迁移: 已处理 %d 条\n", total)
+	}
+	return s.Close()
+}
+
+// migrateColumnStore 根据 SQLite 中的全部记录重建列存（需在服务停止时执行）
+func migrateColumnStore(dir string) error {
+	start := time.Now()
+	paths, err := filepath.Glob(filepath.Join(dir, "*"+columnFileSuffix))
+	if err != nil {
+		return err
+	}
+	for _, path := range paths {
+		if err := os.Remove(path); err != nil {
+			return err
+		}
+	}
+
+	s, err := openColumnStore(dir)
+	if err != nil {
+		return err
+	}
+	if err := s.catchUp(); err != nil {
+		return err
+	}
+	m := s.Metrics()
+	log.Printf("列存迁移完成: 共 %d 条, %d 字节, 压缩比 %.1f, 耗时 %v\n", m["rows"], m["bytes"], m["compression_ratio"], time.Since(start))
+	return nil
+}
+
+// initColumnStore 根据环境变量 COLUMNAR_PATH 打开列存并补齐数据, 未设置时不启用
+func initColumnStore() error {
+	dir := os.Getenv("COLUMNAR_PATH")
+	if dir == "" {
+		return nil
+	}
+	s, err := openColumnStore(dir)
+	if err != nil {
+		return fmt.Errorf("打开列存失败: %w", err)
+	}
+	if err := s.catchUp(); err != nil {
+		return fmt.Errorf("列存补齐数据失败: %w", err)
+	}
+	columns = s
+	log.Printf("列存已启用: %s\n", dir)
+	return nil
+}
+
+// forEachSample 遍历 [start, end) 内的原始测量值: 优先读取热数据缓存, 启用列存时只解码 mask 指定的列, 否则读取 SQLite
+func forEachSample(ctx context.Context, start, end time.Time, mask uint8, fn func(ts time.Time, v *[metricCount]float64)) error {
+	if hot != nil && hot.Range(start, end, fn) {
+		return nil
+	}
+	if columns != nil && columns.Healthy() {
+		return columns.Scan(ctx, start, end, mask, fn)
+	}
+	rows, err := store.scanBetween.QueryContext(ctx, start, end)
+	if err != nil {
+		return err
+	}
+	return forEachRecord(rows, func(d *SensorData) {
+		v := d.metricValues()
+		fn(d.CapturedAt, &v)
+	})
+}
@@ -0,0 +1,200 @@
+package main
+
+import (
+	"encoding/binary"
+	"errors"
+	"math"
+	"math/bits"
+)
+
+// 列存编码:
+// 时间戳（毫秒）按二阶差分（delta-of-delta）编码为 zigzag 变长整数, 等间隔采样时每条约 1 字节;
+// 测量值按 Gorilla 异或编码, 与前一个值相同时只占 1 位, 缓慢变化的传感器数据通常只需几位
+
+var errColumnCorrupt = errors.New("列数据损坏")
+
+// bitWriter 按位写入
+type bitWriter struct {
+	buf   []byte
+	nbits uint8 // 最后一个字节已用的位数
+}
+
+func (w *bitWriter) writeBit(bit bool) {
+	if w.nbits == 0 || w.nbits == 8 {
+		w.buf = append(w.buf, 0)
+		w.nbits = 0
+	}
+	if bit {
+		w.buf[len(w.buf)-1] |= 0x80 >> w.nbits
+	}
+	w.nbits++
+}
+
+// writeBits 写入 v 的低 n 位（高位在前）
+func (w *bitWriter) writeBits(v uint64, n int) {
+	for i := n - 1; i >= 0; i-- {
+		w.writeBit(v>>uint(i)&1 == 1)
+	}
+}
+
+// bitReader 按位读取
+type bitReader struct {
+	buf []byte
+	pos int // 已读取的位数
+}
+
+func (r *bitReader) readBit() (bool, error) {
+	if r.pos >= len(r.buf)*8 {
+		return false, errColumnCorrupt
+	}
+	bit := r.buf[r.pos/8]&(0x80>>uint(r.pos%8)) != 0
+	r.pos++
+	return bit, nil
+}
+
+func (r *bitReader) readBits(n int) (uint64, error) {
+	var v uint64
+	for i := 0; i < n; i++ {
+		bit, err := r.readBit()
+		if err != nil {
+			return 0, err
+		}
+		v <<= 1
+		if bit {
+			v |= 1
+		}
+	}
+	return v, nil
+}
+
+// encodeTimestamps 二阶差分编码: 首值, 首个差分, 之后每个差分与前一个差分之差
+func encodeTimestamps(ts []int64) []byte {
+	buf := make([]byte, 0, len(ts)+16)
+	var prev, prevDelta int64
+	for i, t := range ts {
+		switch i {
+		case 0:
+			buf = binary.AppendVarint(buf, t)
+		default:
+			delta := t - prev
+			buf = binary.AppendVarint(buf, delta-prevDelta)
+			prevDelta = delta
+		}
+		prev = t
+	}
+	return buf
+}
+
+// decodeTimestamps 解码 n 个时间戳, 追加到 dst
+func decodeTimestamps(dst []int64, data []byte, n int) ([]int64, error) {
+	var prev, prevDelta int64
+	for i := 0; i < n; i++ {
+		v, m := binary.Varint(data)
+		if m <= 0 {
+			return nil, errColumnCorrupt
+		}
+		data = data[m:]
+		if i == 0 {
+			prev = v
+		} else {
+			prevDelta += v
+			prev += prevDelta
+		}
+		dst = append(dst, prev)
+	}
+	return dst, nil
+}
+
+// encodeFloats Gorilla 异或编码
+//
+// 首值写入 64 位; 之后与前值异或: 为 0 时写 0;
+// 否则写 1, 若有效位落在上一个值的有效位窗口内, 再写 0 和窗口内的位,
+// 否则写 1、5 位前导零个数、6 位有效位长度（64 记为 0）和有效位
+func encodeFloats(values []float64) []byte {
+	w := &bitWriter{buf: make([]byte, 0, len(values)*2+8)}
+	var prev uint64
+	prevLeading, prevTrailing := -1, 0
+	for i, f := range values {
+		v := math.Float64bits(f)
+		if i == 0 {
+			w.writeBits(v, 64)
+			prev = v
+			continue
+		}
+		xor := v ^ prev
+		prev = v
+		if xor == 0 {
+			w.writeBit(false)
+			continue
+		}
+		w.writeBit(true)
+		leading := min(bits.LeadingZeros64(xor), 31)
+		trailing := bits.TrailingZeros64(xor)
+		if prevLeading >= 0 && leading >= prevLeading && trailing >= prevTrailing {
+			w.writeBit(false)
+			w.writeBits(xor>>uint(prevTrailing), 64-prevLeading-prevTrailing)
+			continue
+		}
+		w.writeBit(true)
+		length := 64 - leading - trailing
+		w.writeBits(uint64(leading), 5)
+		w.writeBits(uint64(length&63), 6)
+		w.writeBits(xor>>uint(trailing), length)
+		prevLeading, prevTrailing = leading, trailing
+	}
+	return w.buf
+}
+
+// decodeFloats 解码 n 个测量值, 追加到 dst
+func decodeFloats(dst []float64, data []byte, n int) ([]float64, error) {
+	r := &bitReader{buf: data}
+	var prev uint64
+	leading, trailing := 0, 0
+	for i := 0; i < n; i++ {
+		if i == 0 {
+			v, err := r.readBits(64)
+			if err != nil {
+				return nil, err
+			}
+			prev = v
+			dst = append(dst, math.Float64frombits(v))
+			continue
+		}
+
+		changed, err := r.readBit()
+		if err != nil {
+			return nil, err
+		}
+		if changed {
+			newWindow, err := r.readBit()
+			if err != nil {
+				return nil, err
+			}
+			if newWindow {
+				l, err := r.readBits(5)
+				if err != nil {
+					return nil, err
+				}
+				length, err := r.readBits(6)
+				if err != nil {
+					return nil, err
+				}
+				if length == 0 {
+					length = 64
+				}
+				leading = int(l)
+				trailing = 64 - leading - int(length)
+				if trailing < 0 {
+					return nil, errColumnCorrupt
+				}
+			}
+			xor, err := r.readBits(64 - leading - trailing)
+			if err != nil {
+				return nil, err
+			}
+			prev ^= xor << uint(trailing)
+		}
+		dst = append(dst, math.Float64frombits(prev))
+	}
+	return dst, nil
+}
@@ -0,0 +1,266 @@
+package main
+
+import (
+	"bufio"
+	"context"
+	"encoding/json"
+	"log"
+	"net/http"
+	"strconv"
+	"strings"
+	"time"
+)
+
+const (
+	// historyWriteBufferSize 历史数据流式输出的写缓冲大小, 写满后以一个 chunk 发送
+	historyWriteBufferSize = 32 << 10
+
+	ndjsonContentType = "application/x-ndjson"
+	// maxHistoryPoints 降采样时最多返回的点数
+	maxHistoryPoints = 10000
+	// nextCursorHeader NDJSON 格式下通过 HTTP trailer 返回下一页游标
+	nextCursorHeader = "X-Next-Cursor"
+	// hotPageChunk 从热数据缓存输出历史数据时每次在读锁内复制的条数
+	hotPageChunk = 256
+)
+
+// handleHistory 获取历史数据（按时间降序）
+//
+// 参数: hours 时间范围, limit 每页条数, cursor 上一页返回的游标（见 pageCursor）, format=ndjson 按行输出,
+// points 降采样后的点数（见 handleHistoryDownsampled）;
+// 结果流式写出（见 streamPage）, 内存占用与查询范围无关
+func handleHistory(w http.ResponseWriter, r *http.Request) {
+	if r.Method != http.MethodGet {
+		http.Error(w, "请求方法不允许", http.StatusMethodNotAllowed)
+		return
+	}
+
+	query := r.URL.Query()
+	if p, err := strconv.Atoi(query.Get("points")); err == nil && p > 0 {
+		// 降采样结果体积小、计算量大, 使用响应缓存
+		respCache.cached(func(w http.ResponseWriter, r *http.Request) {
+			handleHistoryDownsampled(w, r, p)
+		})(w, r)
+		return
+	}
+
+	// 支持 hours 参数按时间范围查询
+	var startTime time.Time
+	if h, err := strconv.Atoi(query.Get("hours")); err == nil && h > 0 {
+		startTime = time.Now().Add(-time.Duration(h) * time.Hour)
+	}
+
+	limit := 0
+	if l, err := strconv.Atoi(query.Get("limit")); err == nil && l > 0 {
+		limit = l
+	}
+
+	var cursor pageCursor
+	if c := query.Get("cursor"); c != "" {
+		parsed, err := parsePageCursor(c)
+		if err != nil {
+			http.Error(w, err.Error(), http.StatusBadRequest)
+			return
+		}
+		cursor = parsed
+	}
+
+	ndjson := query.Get("format") == "ndjson" || strings.Contains(r.Header.Get("Accept"), ndjsonContentType)
+	if ndjson {
+		w.Header().Set("Content-Type", ndjsonContentType)
+		w.Header().Set("Trailer", nextCursorHeader)
+	} else {
+		w.Header().Set("Content-Type", "application/json")
+	}
+
+	bw := bufio.NewWriterSize(w, historyWriteBufferSize)
+	enc := json.NewEncoder(bw)
+
+	if !ndjson {
+		bw.WriteString(`{"data":[`)
+	}
+	count := 0
+	var last pageCursor
+	emit := func(d *SensorData) {
+		if count > 0 && !ndjson {
+			bw.WriteByte(',')
+		}
+		enc.Encode(d)
+		count++
+		last = pageCursor{capturedAt: d.CapturedAt, id: d.ID}
+	}
+	err := streamPage(r.Context(), startTime, cursor, limit, emit)
+	if err != nil {
+		// 响应头已发出, 只能中断输出（客户端会得到不完整的 JSON）
+		log.Printf("读取历史数据失败: %v\n", err)
+		bw.Flush()
+		return
+	}
+
+	// 取满一页时返回下一页游标
+	nextCursor := ""
+	if limit > 0 && count == limit {
+		nextCursor = last.String()
+	}
+
+	if ndjson {
+		bw.Flush()
+		w.Header().Set(nextCursorHeader, nextCursor)
+		return
+	}
+	bw.WriteString(`],"count":`)
+	bw.WriteString(strconv.Itoa(count))
+	bw.WriteString(`,"next_cursor":`)
+	if nextCursor == "" {
+		bw.WriteString("null")
+	} else {
+		bw.WriteString(strconv.Quote(nextCursor))
+	}
+	bw.WriteString("}\n")
+	bw.Flush()
+}
+
+// streamPage 按 (captured_at, id) 降序逐条输出 start 之后、游标之前的最多 limit 条记录（<= 0 时不限制）
+//
+// 时间范围在热数据缓存内时按 hotPageChunk 条一块从缓存复制后输出; 中途缓存不再覆盖时（窗口后移）,
+// 以已输出的最后一条为游标从数据库继续, 否则直接从数据库的游标流式读取
+func streamPage(ctx context.Context, start time.Time, cursor pageCursor, limit int, emit func(d *SensorData)) error {
+	chunk := hotPageChunk
+	if limit > 0 {
+		chunk = min(chunk, limit)
+	}
+	buf := make([]SensorData, chunk)
+	emitted := 0
+	for first := true; ; first = false {
+		want := len(buf)
+		if limit > 0 {
+			want = min(want, limit-emitted)
+		}
+		if want == 0 || ctx.Err() != nil {
+			return ctx.Err()
+		}
+		n, ok := hot.Page(start, cursor, buf[:want], first)
+		if !ok {
+			remaining := 0
+			if limit > 0 {
+				remaining = limit - emitted
+			}
+			return store.Page(ctx, start, cursor, remaining, emit)
+		}
+		for i := 0; i < n; i++ {
+			emit(&buf[i])
+		}
+		emitted += n
+		if n < want {
+			return nil
+		}
+		cursor = pageCursor{capturedAt: buf[n-1].CapturedAt, id: buf[n-1].ID}
+	}
+}
+
+// extremeBucket 降采样桶: 每个测量值的最小、最大值及其出现时间
+type extremeBucket struct {
+	count            int64
+	min, max         [metricCount]float64
+	minTime, maxTime [metricCount]time.Time
+}
+
+// add 计入一个记录或聚合桶, ts 为其时间
+func (b *extremeBucket) add(ts time.Time, agg *rollupAgg) {
+	for i := 0; i < metricCount; i++ {
+		if b.count == 0 || agg.Min[i] < b.min[i] {
+			b.min[i], b.minTime[i] = agg.Min[i], ts
+		}
+		if b.count == 0 || agg.Max[i] > b.max[i] {
+			b.max[i], b.maxTime[i] = agg.Max[i], ts
+		}
+	}
+	b.count += agg.Count
+}
+
+// rows 将桶展开为两个点: 每个测量值按最值出现的先后分别放入两个点,
+// 折线因此保留每个桶内的峰谷（按桶取最小/最大值的降采样）
+func (b *extremeBucket) rows(start time.Time, width time.Duration) [2]SensorData {
+	var first, second [metricCount]float64
+	for i := 0; i < metricCount; i++ {
+		if b.maxTime[i].Before(b.minTime[i]) {
+			first[i], second[i] = b.max[i], b.min[i]
+		} else {
+			first[i], second[i] = b.min[i], b.max[i]
+		}
+	}
+	row := func(ts time.Time, v *[metricCount]float64) SensorData {
+		return SensorData{CreatedAt: ts, CapturedAt: ts, Particle: v[metricParticle], PM25: v[metricPM25], HCHO: v[metricHCHO], CO2: v[metricCO2],
+			Temperature: v[metricTemperature], Humidity: v[metricHumidity], VOC: v[metricVOC], IsValid: true}
+	}
+	return [2]SensorData{row(start, &first), row(start.Add(width/2), &second)}
+}
+
+// downsampleLevel 选择降采样的数据源: 桶宽度至少是聚合粒度的两倍时读取该粒度的聚合表, 否则读取原始记录（返回 0）
+func downsampleLevel(width time.Duration) int {
+	level := 0
+	for _, l := range rollupLevels {
+		if time.Duration(l.seconds)*time.Second*2 <= width {
+			level = l.level
+		}
+	}
+	return level
+}
+
+// handleHistoryDownsampled 将时间范围等分为 points/2 个桶, 每个桶输出最小、最大值两个点（按时间降序, 格式与原始数据相同）
+//
+// 数据来自聚合表或一次流式扫描, 内存占用只与点数有关; 未指定 hours 时默认 24 小时
+func handleHistoryDownsampled(w http.ResponseWriter, r *http.Request, points int) {
+	hours := 24
+	if h, err := strconv.Atoi(r.URL.Query().Get("hours")); err == nil && h > 0 {
+		hours = h
+	}
+	points = min(points, maxHistoryPoints)
+
+	end := time.Now()
+	startTime := end.Add(-time.Duration(hours) * time.Hour)
+	bucketCount := max(points/2, 1)
+	width := end.Sub(startTime) / time.Duration(bucketCount)
+	buckets := make([]extremeBucket, bucketCount)
+
+	add := func(ts time.Time, agg *rollupAgg) {
+		idx := int(ts.Sub(startTime) / width)
+		if idx < 0 || idx >= bucketCount {
+			return
+		}
+		buckets[idx].add(ts, agg)
+	}
+
+	var err error
+	if level := downsampleLevel(width); level > 0 {
+		err = store.WindowAgg(startTime, level, false, add)
+	} else {
+		agg := newRollupAgg(false)
+		err = forEachSample(r.Context(), startTime, end, allMetricsMask, func(ts time.Time, v *[metricCount]float64) {
+			agg.Reset()
+			agg.Add(v)
+			add(ts, agg)
+		})
+	}
+	if err != nil {
+		http.Error(w, "获取数据失败", http.StatusInternalServerError)
+		return
+	}
+
+	data := make([]SensorData, 0, bucketCount*2)
+	for i := bucketCount - 1; i >= 0; i-- {
+		if buckets[i].count == 0 {
+			continue
+		}
+		pair := buckets[i].rows(startTime.Add(time.Duration(i)*width), width)
+		data = append(data, pair[1], pair[0])
+	}
+
+	w.Header().Set("Content-Type", "application/json")
+	json.NewEncoder(w).Encode(map[string]any{
+		"count":          len(data),
+		"data":           data,
+		"next_cursor":    nil,
+		"bucket_seconds": width.Seconds(),
+	})
+}
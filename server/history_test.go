@@ -0,0 +1,62 @@
+package main
+
+import (
+	"net/http"
+	"net/http/httptest"
+	"runtime"
+	"strings"
+	"testing"
+	"time"
+	"unsafe"
+)
+
+// heapSampler 丢弃响应内容, 每次写入时回收垃圾后记录存活堆内存的峰值（不受 GC 时机影响）
+type heapSampler struct {
+	header http.Header
+	peak   uint64
+	bytes  int
+	lines  int
+}
+
+func (w *heapSampler) Header() http.Header { return w.header }
+func (w *heapSampler) WriteHeader(int)     {}
+func (w *heapSampler) Write(p []byte) (int, error) {
+	runtime.GC()
+	var ms runtime.MemStats
+	runtime.ReadMemStats(&ms)
+	w.peak = max(w.peak, ms.HeapAlloc)
+	w.bytes += len(p)
+	w.lines += strings.Count(string(p), "\n")
+	return len(p), nil
+}
+
+func TestHistoryHotWindowStreamsInChunks(t *testing.T) {
+	const rows = 100000
+	hot = newTestHotWindow(t, rows)
+	start := time.Now().Add(-50 * time.Minute)
+	for i := 0; i < rows; i += 1000 {
+		batch := make([]SensorData, 1000)
+		for j := range batch {
+			batch[j] = hotRecord(uint(i+j+1), start.Add(time.Duration(i+j)*10*time.Millisecond))
+		}
+		hot.Append(batch)
+	}
+
+	runtime.GC()
+	var ms runtime.MemStats
+	runtime.ReadMemStats(&ms)
+	baseline := ms.HeapAlloc
+
+	// 不限条数的 NDJSON 请求, 全部命中热数据缓存
+	w := &heapSampler{header: http.Header{}}
+	handleHistory(w, httptest.NewRequest(http.MethodGet, "/api/history?hours=1&format=ndjson", nil))
+
+	if w.lines != rows {
+		t.Fatalf("输出 %d 条, 期望 %d", w.lines, rows)
+	}
+	// 一次复制全部记录需要 rows × sizeof(SensorData)（约 15MB）, 分块输出只需一个分块
+	full := uint64(rows) * uint64(unsafe.Sizeof(SensorData{}))
+	if grown := w.peak - min(w.peak, baseline); grown > full/4 {
+		t.Errorf("输出期间存活堆内存增长 %d 字节, 超过一次性复制全部记录的 1/4（%d 字节）", grown, full/4)
+	}
+}
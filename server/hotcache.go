@@ -0,0 +1,346 @@
+package main
+
+import (
+	"log"
+	"math"
+	"sort"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// 热数据缓存默认配置, 可通过环境变量覆盖
+const (
+	defaultHotWindowHours = 24     // HOT_WINDOW_HOURS: 缓存最近多少小时的数据
+	defaultHotWindowRows  = 200000 // HOT_WINDOW_ROWS: 最多缓存条数
+)
+
+// hotWindow 最近一段时间原始记录的内存缓存: 定长环形缓冲区, 各字段分别存放（列式布局）, 按采集时间有序,
+// 启动时从数据库加载, 写入协程写入数据库后追加; 查询窗口完全落在缓存覆盖范围内时不访问数据库
+type hotWindow struct {
+	mu       sync.RWMutex
+	window   time.Duration
+	capacity int
+	head     int // 最旧一条的位置
+	size     int
+	// covered 该时间之后的记录全部在缓存中
+	covered time.Time
+	// summaryLatest 汇总模式设备最近一个窗口的最后一帧（不进入环形缓冲区, 不参与原始记录的遍历）
+	summaryLatest SensorData
+	hasSummary    bool
+
+	id       []uint
+	ts       []int64 // 采集时间, 纳秒
+	received []int64 // 接收时间, 纳秒
+	values   [metricCount][]float64
+	sequence []int64
+	valid    []bool
+	device   []string
+	flags    []uint8
+
+	hits   int64
+	misses int64
+}
+
+var hot *hotWindow
+
+func newHotWindow() *hotWindow {
+	capacity := envInt("HOT_WINDOW_ROWS", defaultHotWindowRows)
+	h := &hotWindow{
+		window:   time.Duration(envInt("HOT_WINDOW_HOURS", defaultHotWindowHours)) * time.Hour,
+		capacity: capacity,
+		id:       make([]uint, capacity),
+		ts:       make([]int64, capacity),
+		received: make([]int64, capacity),
+		sequence: make([]int64, capacity),
+		valid:    make([]bool, capacity),
+		device:   make([]string, capacity),
+		flags:    make([]uint8, capacity),
+	}
+	for i := range h.values {
+		h.values[i] = make([]float64, capacity)
+	}
+	return h
+}
+
+// load 从数据库加载窗口内最新的记录（启动时、写入队列启动前调用）
+func (h *hotWindow) load() error {
+	start := time.Now().Add(-h.window)
+	records, err := store.Recent(start, h.capacity)
+	if err != nil {
+		return err
+	}
+
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	h.covered = start
+	if len(records) == h.capacity {
+		// 窗口内的数据超过容量, 只有最旧一条之后的数据是完整的
+		h.covered = records[len(records)-1].CapturedAt
+	}
+	for i := len(records) - 1; i >= 0; i-- {
+		h.push(&records[i], start.UnixNano())
+	}
+	log.Printf("热数据缓存: 最近 %v, 容量 %d 条, 已加载 %d 条\n", h.window, h.capacity, len(records))
+
+	summary, found, err := latestSummary()
+	if err != nil {
+		return err
+	}
+	if found {
+		h.summaryLatest, h.hasSummary = summary.latest(), true
+	}
+	return nil
+}
+
+// push 按采集时间插入一条记录, 缓冲区已满时淘汰最旧的一条; 调用方需持有写锁
+//
+// 早于 cutoff 的记录不进入缓存; 乱序记录（如补传的离线数据）从尾部向前移动较新的记录后插入,
+// 移动量为比它新的记录数, 补传不频繁, 正常按序追加时不移动
+func (h *hotWindow) push(d *SensorData, cutoff int64) {
+	t := d.CapturedAt.UnixNano()
+	if t < cutoff {
+		return
+	}
+	if h.size == h.capacity {
+		if t < h.ts[h.head] {
+			// 比缓存中最旧的一条还早, 不再保证该时间之后的记录都在缓存中
+			h.covered = maxTime(h.covered, time.Unix(0, t+1))
+			return
+		}
+		h.covered = maxTime(h.covered, time.Unix(0, h.ts[h.head]+1))
+		h.head = (h.head + 1) % h.capacity
+		h.size--
+	}
+
+	i := h.size
+	for i > 0 && h.ts[(h.head+i-1)%h.capacity] > t {
+		h.move((h.head+i)%h.capacity, (h.head+i-1)%h.capacity)
+		i--
+	}
+	h.size++
+	pos := (h.head + i) % h.capacity
+
+	h.id[pos] = d.ID
+	h.ts[pos] = t
+	h.received[pos] = d.CreatedAt.UnixNano()
+	for m, v := range d.metricValues() {
+		h.values[m][pos] = v
+	}
+	h.sequence[pos] = d.SequenceNum
+	h.valid[pos] = d.IsValid
+	// 设备 ID 通常与上一条相同, 复用同一个字符串
+	prev := (pos + h.capacity - 1) % h.capacity
+	if i > 0 && h.device[prev] == d.DeviceID {
+		h.device[pos] = h.device[prev]
+	} else {
+		h.device[pos] = d.DeviceID
+	}
+	h.flags[pos] = d.Flags
+}
+
+// move 将 src 位置的记录复制到 dst 位置; 调用方需持有写锁
+func (h *hotWindow) move(dst, src int) {
+	h.id[dst] = h.id[src]
+	h.ts[dst] = h.ts[src]
+	h.received[dst] = h.received[src]
+	for m := range h.values {
+		h.values[m][dst] = h.values[m][src]
+	}
+	h.sequence[dst] = h.sequence[src]
+	h.valid[dst] = h.valid[src]
+	h.device[dst] = h.device[src]
+	h.flags[dst] = h.flags[src]
+}
+
+// unixNanoFrom 查询起点的纳秒时间戳, 零值表示不限
+func unixNanoFrom(start time.Time) int64 {
+	if start.IsZero() {
+		return math.MinInt64
+	}
+	return start.UnixNano()
+}
+
+// maxTime 较晚的时间
+func maxTime(a, b time.Time) time.Time {
+	if a.After(b) {
+		return a
+	}
+	return b
+}
+
+// Append 追加已写入数据库的记录, 并淘汰超出时间窗口的记录
+func (h *hotWindow) Append(records []SensorData) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	cutoff := time.Now().Add(-h.window)
+	for i := range records {
+		h.push(&records[i], cutoff.UnixNano())
+	}
+
+	for h.size > 0 && h.ts[h.head] < cutoff.UnixNano() {
+		h.head = (h.head + 1) % h.capacity
+		h.size--
+	}
+	// 早于 cutoff 的记录已淘汰或未进入缓存
+	h.covered = maxTime(h.covered, cutoff)
+}
+
+// AppendSummaries 记录已写入的设备汇总中最新的读数
+func (h *hotWindow) AppendSummaries(summaries []deviceSummary) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	for i := range summaries {
+		if d := summaries[i].latest(); !h.hasSummary || d.CapturedAt.After(h.summaryLatest.CapturedAt) {
+			h.summaryLatest, h.hasSummary = d, true
+		}
+	}
+}
+
+// LatestSummary 汇总模式设备最新的读数
+func (h *hotWindow) LatestSummary() (SensorData, bool) {
+	h.mu.RLock()
+	defer h.mu.RUnlock()
+	return h.summaryLatest, h.hasSummary
+}
+
+// record 读取第 i 条（0 为最旧）; 调用方需持有读锁
+func (h *hotWindow) record(i int) SensorData {
+	pos := (h.head + i) % h.capacity
+	return SensorData{
+		ID:          h.id[pos],
+		CreatedAt:   time.Unix(0, h.received[pos]),
+		CapturedAt:  time.Unix(0, h.ts[pos]),
+		Particle:    h.values[metricParticle][pos],
+		PM25:        h.values[metricPM25][pos],
+		HCHO:        h.values[metricHCHO][pos],
+		CO2:         h.values[metricCO2][pos],
+		Temperature: h.values[metricTemperature][pos],
+		Humidity:    h.values[metricHumidity][pos],
+		VOC:         h.values[metricVOC][pos],
+		SequenceNum: h.sequence[pos],
+		IsValid:     h.valid[pos],
+		DeviceID:    h.device[pos],
+		Flags:       h.flags[pos],
+	}
+}
+
+// contains 判断 start 之后的数据是否都在缓存中; 调用方需持有读锁
+func (h *hotWindow) contains(start time.Time) bool {
+	return !start.IsZero() && !start.Before(h.covered)
+}
+
+// covers 同 contains, 并记录命中率; 调用方需持有读锁
+func (h *hotWindow) covers(start time.Time) bool {
+	if h.contains(start) {
+		atomic.AddInt64(&h.hits, 1)
+		return true
+	}
+	atomic.AddInt64(&h.misses, 1)
+	return false
+}
+
+// Latest 获取 start 之后最新的一条记录; 缓存未覆盖 start 时 ok 为 false
+func (h *hotWindow) Latest(start time.Time) (d SensorData, found, ok bool) {
+	h.mu.RLock()
+	defer h.mu.RUnlock()
+	if h.size > 0 && h.ts[(h.head+h.size-1)%h.capacity] >= unixNanoFrom(start) {
+		atomic.AddInt64(&h.hits, 1)
+		return h.record(h.size - 1), true, true
+	}
+	if !h.covers(start) {
+		return SensorData{}, false, false
+	}
+	return SensorData{}, false, true
+}
+
+// Page 按 (采集时间, id) 从新到旧, 将游标 cursor 之前（零值表示从最新开始）、start 之后的最多 len(buf) 条记录复制到 buf,
+// 返回复制的条数; 缓存未覆盖 start 时返回 false; first 为 false 时不计入命中率（同一请求的后续分块）
+//
+// 缓存中的记录按 (采集时间, id) 升序排列; 每次只在读锁内复制一个分块, 调用方在释放锁之后编码输出,
+// 再以最后一条作为游标继续读取, 内存占用与查询范围无关, 慢客户端也不会阻塞写入协程的 Append
+func (h *hotWindow) Page(start time.Time, cursor pageCursor, buf []SensorData, first bool) (int, bool) {
+	h.mu.RLock()
+	defer h.mu.RUnlock()
+	if first && !h.covers(start) || !first && !h.contains(start) {
+		return 0, false
+	}
+	from := unixNanoFrom(start)
+	end := h.size
+	if cursor.id != 0 {
+		t := cursor.capturedAt.UnixNano()
+		end = sort.Search(h.size, func(i int) bool {
+			pos := (h.head + i) % h.capacity
+			return h.ts[pos] > t || h.ts[pos] == t && h.id[pos] >= cursor.id
+		})
+	}
+	n := 0
+	for i := end - 1; i >= 0 && n < len(buf); i-- {
+		if h.ts[(h.head+i)%h.capacity] < from {
+			break
+		}
+		buf[n] = h.record(i)
+		n++
+	}
+	return n, true
+}
+
+// Range 按采集时间顺序遍历 [start, end) 内的测量值; 缓存未覆盖 start 时返回 false, 不调用 fn
+func (h *hotWindow) Range(start, end time.Time, fn func(ts time.Time, v *[metricCount]float64)) bool {
+	h.mu.RLock()
+	defer h.mu.RUnlock()
+	if !h.covers(start) {
+		return false
+	}
+	from, to := start.UnixNano(), end.UnixNano()
+	var v [metricCount]float64
+	for i := 0; i < h.size; i++ {
+		pos := (h.head + i) % h.capacity
+		if t := h.ts[pos]; t >= from && t < to {
+			for m := range v {
+				v[m] = h.values[m][pos]
+			}
+			fn(time.Unix(0, t), &v)
+		}
+	}
+	return true
+}
+
+// Metrics 获取缓存统计
+func (h *hotWindow) Metrics() map[string]any {
+	h.mu.RLock()
+	defer h.mu.RUnlock()
+	hits, misses := atomic.LoadInt64(&h.hits), atomic.LoadInt64(&h.misses)
+	hitRate := 0.0
+	if hits+misses > 0 {
+		hitRate = float64(hits) / float64(hits+misses)
+	}
+	return map[string]any{
+		"window_hours": h.window.Hours(),
+		"capacity":     h.capacity,
+		"rows":         h.size,
+		"covered_from": h.covered,
+		"hits":         hits,
+		"misses":       misses,
+		"hit_rate":     hitRate,
+	}
+}
+
+// latestSince 获取 start 之后最新的一条记录, 优先读取热数据缓存;
+// 汇总模式的设备没有原始记录, 其最近一个窗口的最后一帧更新时作为最新读数
+func latestSince(start time.Time) (SensorData, bool, error) {
+	d, found, ok := hot.Latest(start)
+	if !ok {
+		recent, err := store.Recent(start, 1)
+		if err != nil {
+			return SensorData{}, false, err
+		}
+		if len(recent) > 0 {
+			d, found = recent[0], true
+		}
+	}
+	if s, ok := hot.LatestSummary(); ok && !s.CapturedAt.Before(start) && (!found || s.CapturedAt.After(d.CapturedAt)) {
+		return s, true, nil
+	}
+	return d, found, nil
+}
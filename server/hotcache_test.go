@@ -0,0 +1,84 @@
+package main
+
+import (
+	"strconv"
+	"testing"
+	"time"
+)
+
+// newTestHotWindow 容量为 capacity、覆盖最近一小时的热数据缓存
+func newTestHotWindow(t testing.TB, capacity int) *hotWindow {
+	t.Setenv("HOT_WINDOW_ROWS", strconv.Itoa(capacity))
+	t.Setenv("HOT_WINDOW_HOURS", "1")
+	return newHotWindow()
+}
+
+func hotRecord(id uint, ts time.Time) SensorData {
+	return SensorData{ID: id, CapturedAt: ts, CreatedAt: ts, SequenceNum: int64(id), DeviceID: "dev", PM25: float64(id)}
+}
+
+// hotTimes 按缓存顺序列出采集时间
+func hotTimes(h *hotWindow) []int64 {
+	times := make([]int64, h.size)
+	for i := range times {
+		times[i] = h.ts[(h.head+i)%h.capacity]
+	}
+	return times
+}
+
+func TestHotWindowOutOfOrder(t *testing.T) {
+	h := newTestHotWindow(t, 4)
+	base := time.Now().Add(-10 * time.Minute)
+	at := func(s int) time.Time { return base.Add(time.Duration(s) * time.Second) }
+
+	h.Append([]SensorData{hotRecord(1, at(10)), hotRecord(2, at(30))})
+	// 补传的旧数据插入到中间, 缓存仍可用于查询最新记录
+	h.Append([]SensorData{hotRecord(3, at(20))})
+	if got := hotTimes(h); len(got) != 3 || got[0] != at(10).UnixNano() || got[1] != at(20).UnixNano() || got[2] != at(30).UnixNano() {
+		t.Fatalf("乱序插入后顺序错误: %v", got)
+	}
+	latest, found, ok := h.Latest(base)
+	if !ok || !found || latest.ID != 2 {
+		t.Fatalf("Latest = %d, found=%v ok=%v, 期望 2", latest.ID, found, ok)
+	}
+
+	// 超出时间窗口的记录不进入缓存
+	h.Append([]SensorData{hotRecord(4, time.Now().Add(-2*time.Hour))})
+	if h.size != 3 {
+		t.Fatalf("窗口外的记录进入了缓存, size=%d", h.size)
+	}
+
+	// 写满后淘汰最旧的一条; 比最旧一条还早的记录直接丢弃, 覆盖起点随之后移
+	h.Append([]SensorData{hotRecord(5, at(40)), hotRecord(6, at(50))})
+	if h.size != 4 || h.ts[h.head] != at(20).UnixNano() {
+		t.Fatalf("淘汰错误: %v", hotTimes(h))
+	}
+	h.Append([]SensorData{hotRecord(7, at(5))})
+	if h.size != 4 || h.ts[h.head] != at(20).UnixNano() {
+		t.Fatalf("过旧的记录进入了缓存: %v", hotTimes(h))
+	}
+	if h.covers(at(5)) {
+		t.Fatal("丢弃记录之前的时间不应被视为已覆盖")
+	}
+
+	// 分块读取: 每块 2 条, 以上一块最后一条为游标继续
+	var ids []uint
+	buf := make([]SensorData, 2)
+	var cursor pageCursor
+	for first := true; ; first = false {
+		n, ok := h.Page(at(20), cursor, buf, first)
+		if !ok {
+			t.Fatal("Page 未命中缓存")
+		}
+		for _, d := range buf[:n] {
+			ids = append(ids, d.ID)
+		}
+		if n < len(buf) {
+			break
+		}
+		cursor = pageCursor{capturedAt: buf[n-1].CapturedAt, id: buf[n-1].ID}
+	}
+	if len(ids) != 4 || ids[0] != 6 || ids[1] != 5 || ids[2] != 2 || ids[3] != 3 {
+		t.Fatalf("Page = %v, 期望 [6 5 2 3]", ids)
+	}
+}
@@ -0,0 +1,257 @@
+package main
+
+import (
+	"log"
+	"os"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// 写入队列默认配置, 可通过环境变量覆盖
+const (
+	defaultIngestQueueSize = 1024 // INGEST_QUEUE_SIZE: 队列容量(请求数)
+	defaultIngestFlushMS   = 200  // INGEST_FLUSH_MS: 最长攒批时间(毫秒)
+	defaultIngestMaxRows   = 1000 // INGEST_MAX_ROWS: 单个事务最多写入条数
+	ingestInsertBatchSize  = 100  // 单条 INSERT 语句的行数
+)
+
+// ingestMetrics 写入队列统计
+type ingestMetrics struct {
+	EnqueuedRecords  int64 // 入队条数
+	WrittenRecords   int64 // 已写入条数
+	FailedRecords    int64 // 写入失败条数
+	DuplicateRecords int64 // 已存在而跳过的条数（重发或补传的重复数据）
+	RejectedRequests int64 // 队列已满被拒绝的请求数
+	Flushes          int64 // 写入事务数
+	LastFlushRows    int64 // 最近一次写入条数
+	LastFlushMicros  int64 // 最近一次写入耗时(微秒)
+	CaptureFallbacks int64 // 采集时间缺失或不可信, 以接收时间代替的条数
+
+	SummaryWindows     int64 // 已写入的设备汇总数
+	SummaryFrames      int64 // 已写入的设备汇总包含的帧数
+	DuplicateSummaries int64 // 已存在而跳过的设备汇总数
+	FailedSummaries    int64 // 写入失败的设备汇总数
+}
+
+// ingestQueue 异步写入队列: 请求处理完校验后立即应答, 由单个写入协程攒批后在一个事务中写入
+type ingestQueue struct {
+	ch        chan []SensorData
+	summaries chan []deviceSummary // 设备汇总, 数量少, 收到后立即写入
+	flush     time.Duration
+	maxRows   int
+	done      chan struct{}
+	closeMu   sync.RWMutex
+	closed    bool
+	stats     ingestMetrics
+}
+
+var ingest *ingestQueue
+
+// envInt 读取正整数环境变量, 未设置或无效时使用默认值
+func envInt(name string, def int) int {
+	if v, err := strconv.Atoi(os.Getenv(name)); err == nil && v > 0 {
+		return v
+	}
+	return def
+}
+
+// envNonNegInt 读取非负整数环境变量, 未设置或无效时使用默认值
+func envNonNegInt(name string, def int) int {
+	if v, err := strconv.Atoi(os.Getenv(name)); err == nil && v >= 0 {
+		return v
+	}
+	return def
+}
+
+// newIngestQueue 创建写入队列并启动写入协程
+func newIngestQueue() *ingestQueue {
+	q := &ingestQueue{
+		ch:        make(chan []SensorData, envInt("INGEST_QUEUE_SIZE", defaultIngestQueueSize)),
+		summaries: make(chan []deviceSummary, envInt("INGEST_QUEUE_SIZE", defaultIngestQueueSize)),
+		flush:     time.Duration(envInt("INGEST_FLUSH_MS", defaultIngestFlushMS)) * time.Millisecond,
+		maxRows:   envInt("INGEST_MAX_ROWS", defaultIngestMaxRows),
+		done:      make(chan struct{}),
+	}
+	log.Printf("写入队列: 容量 %d, 攒批 %v, 每批最多 %d 条\n", cap(q.ch), q.flush, q.maxRows)
+	go q.run()
+	return q
+}
+
+// Enqueue 将一个请求的记录加入队列, 队列已满或已关闭时返回 false
+func (q *ingestQueue) Enqueue(records []SensorData) bool {
+	q.closeMu.RLock()
+	defer q.closeMu.RUnlock()
+	if q.closed {
+		return false
+	}
+
+	select {
+	case q.ch <- records:
+		atomic.AddInt64(&q.stats.EnqueuedRecords, int64(len(records)))
+		return true
+	default:
+		atomic.AddInt64(&q.stats.RejectedRequests, 1)
+		return false
+	}
+}
+
+// EnqueueSummaries 将一个请求的设备汇总加入队列, 队列已满或已关闭时返回 false
+func (q *ingestQueue) EnqueueSummaries(summaries []deviceSummary) bool {
+	q.closeMu.RLock()
+	defer q.closeMu.RUnlock()
+	if q.closed {
+		return false
+	}
+
+	select {
+	case q.summaries <- summaries:
+		return true
+	default:
+		atomic.AddInt64(&q.stats.RejectedRequests, 1)
+		return false
+	}
+}
+
+// Close 停止接收新数据, 等待队列中的数据全部写入
+func (q *ingestQueue) Close() {
+	q.closeMu.Lock()
+	if !q.closed {
+		q.closed = true
+		close(q.ch)
+		close(q.summaries)
+	}
+	q.closeMu.Unlock()
+	<-q.done
+}
+
+// run 写入协程: 攒满 maxRows 条或距第一条超过 flush 时间后写入
+func (q *ingestQueue) run() {
+	defer close(q.done)
+
+	pending := make([]SensorData, 0, q.maxRows)
+	timer := time.NewTimer(q.flush)
+	timer.Stop()
+	summaryCh := q.summaries
+
+	for {
+		select {
+		case records, ok := <-q.ch:
+			if !ok {
+				q.write(pending)
+				for summaries := range q.summaries {
+					q.writeSummaries(summaries)
+				}
+				return
+			}
+			if len(pending) == 0 {
+				timer.Reset(q.flush)
+			}
+			pending = append(pending, records...)
+			if len(pending) >= q.maxRows {
+				if !timer.Stop() {
+					<-timer.C
+				}
+				q.write(pending)
+				pending = pending[:0]
+			}
+		case <-timer.C:
+			q.write(pending)
+			pending = pending[:0]
+		case summaries, ok := <-summaryCh:
+			if !ok {
+				// 关闭时由 q.ch 的分支写完剩余汇总
+				summaryCh = nil
+				continue
+			}
+			q.writeSummaries(summaries)
+		}
+	}
+}
+
+// write 在一个事务中以多行 INSERT 写入
+func (q *ingestQueue) write(records []SensorData) {
+	if len(records) == 0 {
+		return
+	}
+
+	start := time.Now()
+	inserted, err := store.Insert(records)
+	elapsed := time.Since(start)
+	releaseQueued(records)
+
+	if err != nil {
+		// 数据已向设备应答, 写入失败只能记录
+		log.Printf("写入数据失败, 丢弃 %d 条: %v\n", len(records), err)
+		atomic.AddInt64(&q.stats.FailedRecords, int64(len(records)))
+		return
+	}
+	atomic.AddInt64(&q.stats.DuplicateRecords, int64(len(records)-len(inserted)))
+	records = inserted
+
+	// 列存只是副本, 写入失败时会自行停用, 不影响本次写入
+	if columns != nil {
+		columns.Append(records)
+	}
+
+	hot.Append(records)
+	if len(records) > 0 {
+		bumpDataVersion()
+	}
+	hub.publishRecords(records)
+
+	atomic.AddInt64(&q.stats.WrittenRecords, int64(len(records)))
+	atomic.AddInt64(&q.stats.Flushes, 1)
+	atomic.StoreInt64(&q.stats.LastFlushRows, int64(len(records)))
+	atomic.StoreInt64(&q.stats.LastFlushMicros, elapsed.Microseconds())
+}
+
+// writeSummaries 写入设备汇总并合并进聚合表
+func (q *ingestQueue) writeSummaries(summaries []deviceSummary) {
+	inserted, err := store.InsertSummaries(summaries)
+	if err != nil {
+		log.Printf("写入设备汇总失败, 丢弃 %d 条: %v\n", len(summaries), err)
+		atomic.AddInt64(&q.stats.FailedSummaries, int64(len(summaries)))
+		return
+	}
+	atomic.AddInt64(&q.stats.DuplicateSummaries, int64(len(summaries)-len(inserted)))
+	if len(inserted) == 0 {
+		return
+	}
+
+	var frames int64
+	for i := range inserted {
+		frames += inserted[i].req.Count
+	}
+	hot.AppendSummaries(inserted)
+	bumpDataVersion()
+	hub.publishSummaries(inserted)
+
+	atomic.AddInt64(&q.stats.SummaryWindows, int64(len(inserted)))
+	atomic.AddInt64(&q.stats.SummaryFrames, frames)
+}
+
+// Metrics 获取写入队列统计
+func (q *ingestQueue) Metrics() map[string]any {
+	return map[string]any{
+		"queue_len":           len(q.ch),
+		"queue_cap":           cap(q.ch),
+		"flush_ms":            q.flush.Milliseconds(),
+		"max_rows":            q.maxRows,
+		"enqueued_records":    atomic.LoadInt64(&q.stats.EnqueuedRecords),
+		"written_records":     atomic.LoadInt64(&q.stats.WrittenRecords),
+		"failed_records":      atomic.LoadInt64(&q.stats.FailedRecords),
+		"duplicate_records":   atomic.LoadInt64(&q.stats.DuplicateRecords),
+		"rejected_requests":   atomic.LoadInt64(&q.stats.RejectedRequests),
+		"flushes":             atomic.LoadInt64(&q.stats.Flushes),
+		"last_flush_rows":     atomic.LoadInt64(&q.stats.LastFlushRows),
+		"last_flush_us":       atomic.LoadInt64(&q.stats.LastFlushMicros),
+		"capture_fallbacks":   atomic.LoadInt64(&q.stats.CaptureFallbacks),
+		"summary_queue_len":   len(q.summaries),
+		"summary_windows":     atomic.LoadInt64(&q.stats.SummaryWindows),
+		"summary_frames":      atomic.LoadInt64(&q.stats.SummaryFrames),
+		"duplicate_summaries": atomic.LoadInt64(&q.stats.DuplicateSummaries),
+		"failed_summaries":    atomic.LoadInt64(&q.stats.FailedSummaries),
+	}
+}
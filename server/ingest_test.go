@@ -0,0 +1,145 @@
+package main
+
+import (
+	"testing"
+	"time"
+)
+
+// BenchmarkIngest 持续写入吞吐: 每个请求 ingestBenchBatch 条记录进入写入队列, 由写入协程攒批写入,
+// 结束时等待队列写完; rows/s 为从第一条入队到全部写入数据库（含聚合表）的速率
+func BenchmarkIngest(b *testing.B) {
+	const ingestBenchBatch = 20
+	openTestStore(b, b.TempDir())
+
+	start := time.Now().Add(-time.Hour)
+	records := syntheticRecords(start, 10*time.Millisecond, b.N*ingestBenchBatch, 1)
+
+	b.ResetTimer()
+	began := time.Now()
+	ingest = newIngestQueue()
+	for i := 0; i < b.N; i++ {
+		batch := records[i*ingestBenchBatch : (i+1)*ingestBenchBatch]
+		for !ingest.Enqueue(batch) {
+			// 队列已满（设备会收到 503 并重试）
+			time.Sleep(time.Millisecond)
+		}
+	}
+	ingest.Close()
+	elapsed := time.Since(began)
+	b.StopTimer()
+
+	if written := ingest.stats.WrittenRecords; written != int64(len(records)) {
+		b.Fatalf("写入 %d 条, 期望 %d", written, len(records))
+	}
+	b.ReportMetric(float64(len(records))/elapsed.Seconds(), "rows/s")
+}
+
+// BenchmarkStoreInsert 单个事务写入 1000 条记录（多行 INSERT 与聚合表合并）的耗时
+func BenchmarkStoreInsert(b *testing.B) {
+	const rows = 1000
+	openTestStore(b, b.TempDir())
+
+	start := time.Now().Add(-24 * time.Hour)
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		b.StopTimer()
+		records := syntheticRecords(start.Add(time.Duration(i)*rows*time.Second), time.Second, rows, int64(i*rows))
+		b.StartTimer()
+		if _, err := store.Insert(records); err != nil {
+			b.Fatal(err)
+		}
+	}
+	b.ReportMetric(float64(b.N*rows)/b.Elapsed().Seconds(), "rows/s")
+}
+
+func TestIngestDropsRetriedBatch(t *testing.T) {
+	openTestStore(t, t.TempDir())
+
+	records := syntheticRecords(time.Now().Add(-time.Minute), time.Second, 10, 1)
+	retry := append([]SensorData(nil), records...)
+	ingest = newIngestQueue()
+	if !ingest.Enqueue(records) || !ingest.Enqueue(retry) {
+		t.Fatal("入队失败")
+	}
+	ingest.Close()
+
+	if ingest.stats.WrittenRecords != 10 || ingest.stats.DuplicateRecords != 10 {
+		t.Fatalf("写入 %d 条, 重复 %d 条, 期望 10/10", ingest.stats.WrittenRecords, ingest.stats.DuplicateRecords)
+	}
+}
+
+func TestFallbackTimeReusedForRetry(t *testing.T) {
+	var seq deviceSequence
+	received := time.Date(2024, 1, 1, 12, 0, 0, 0, time.UTC)
+
+	first := seq.fallbackTime(time.Time{}, 7, received)
+	if !first.Equal(received) {
+		t.Fatalf("首次收到应使用接收时间, 得到 %v", first)
+	}
+	if got := seq.fallbackTime(time.Time{}, 7, received.Add(30*time.Second)); !got.Equal(first) {
+		t.Errorf("重发应沿用 %v, 得到 %v", first, got)
+	}
+	if got := seq.fallbackTime(time.Time{}, 8, received.Add(30*time.Second)); got.Equal(first) {
+		t.Error("序号不同的记录不应沿用")
+	}
+	unsynced := time.UnixMilli(5000)
+	if got := seq.fallbackTime(unsynced, 7, received.Add(40*time.Second)); got.Equal(first) {
+		t.Error("上报时间不同的记录不应沿用")
+	}
+	later := received.Add(fallbackRetryWindow + time.Second)
+	if got := seq.fallbackTime(time.Time{}, 7, later); !got.Equal(later) {
+		t.Errorf("超过 %v 后应视为新记录, 得到 %v", fallbackRetryWindow, got)
+	}
+}
+
+func TestIngestDropsRetriedRowsWithoutTimestamp(t *testing.T) {
+	openTestStore(t, t.TempDir())
+	ingest = newIngestQueue()
+
+	// 未上报采集时间的旧固件记录: 两次收到的接收时间不同, 仍应只写入一次
+	records := syntheticRecords(time.Time{}, 0, 5, 1)
+	for i := range records {
+		records[i].CapturedAt = time.Time{}
+		records[i].Flags = 0
+	}
+	retry := append([]SensorData(nil), records...)
+	checkRecords("legacy", records)
+	time.Sleep(10 * time.Millisecond)
+	checkRecords("legacy", retry)
+	if !ingest.Enqueue(records) || !ingest.Enqueue(retry) {
+		t.Fatal("入队失败")
+	}
+	ingest.Close()
+
+	if ingest.stats.WrittenRecords != 5 || ingest.stats.DuplicateRecords != 5 {
+		t.Fatalf("写入 %d 条, 重复 %d 条, 期望 5/5", ingest.stats.WrittenRecords, ingest.stats.DuplicateRecords)
+	}
+}
+
+func TestSequenceNeighborsIncludeQueuedRows(t *testing.T) {
+	openTestStore(t, t.TempDir())
+	ingest = newIngestQueue()
+	defer ingest.Close()
+
+	// 窗口已满且都未写入数据库; 随后补传两条早于窗口的记录, 后到的一条序号倒退
+	now := time.Now().Add(-time.Hour)
+	window := syntheticRecords(now, time.Second, sequenceWindow, 1000)
+	backfill := syntheticRecords(now.Add(-10*time.Minute), time.Minute, 2, 0)
+	for _, batch := range [][]SensorData{window, backfill} {
+		for i := range batch {
+			batch[i].Flags = 0
+		}
+	}
+	backfill[0].SequenceNum, backfill[1].SequenceNum = 20, 10
+	checkRecords("backfill", window)
+	checkRecords("backfill", backfill[:1])
+	checkRecords("backfill", backfill[1:])
+
+	if !backfill[0].IsValid || backfill[1].IsValid {
+		t.Fatalf("有效性 %v/%v, 期望 true/false（前一条仍在写入队列中, 序号 20）", backfill[0].IsValid, backfill[1].IsValid)
+	}
+	releaseQueued(backfill)
+	if seq := getDeviceSequence("backfill"); len(seq.queued) != 0 {
+		t.Errorf("写入后仍有 %d 条待写入记录", len(seq.queued))
+	}
+}
@@ -0,0 +1,101 @@
+package main
+
+import (
+	"bytes"
+	"crypto/tls"
+	"io"
+	"net"
+	"net/http"
+	"net/http/httptest"
+	"sync/atomic"
+	"testing"
+	"time"
+)
+
+// 设备上报复用 HTTP 长连接（固件 http_client 的长连接会话）在主机上的对照:
+// 本地替身服务器只读取请求体并应答 202, 分别测量每次请求新建连接与复用连接时的请求速率
+
+// uploadBody 固件批量上报的一条 JSON 请求体
+var uploadBody = []byte(`[{"data":"1234,35.5,12.25,600,-5.5,45.67,300,42","flags":128,"ts":1700000000000}]`)
+
+// newUploadServer 创建替身服务器, conns 统计新建的连接数
+func newUploadServer(tlsEnabled bool, conns *int64) *httptest.Server {
+	srv := httptest.NewUnstartedServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		io.Copy(io.Discard, r.Body)
+		w.WriteHeader(http.StatusAccepted)
+	}))
+	srv.Config.ConnState = func(c net.Conn, state http.ConnState) {
+		if state == http.StateNew {
+			atomic.AddInt64(conns, 1)
+		}
+	}
+	if tlsEnabled {
+		srv.StartTLS()
+	} else {
+		srv.Start()
+	}
+	return srv
+}
+
+// uploadClient 与固件相同的单连接客户端, keepAlive 为 false 时每次请求后关闭连接
+func uploadClient(keepAlive bool) *http.Client {
+	transport := &http.Transport{
+		DisableKeepAlives:   !keepAlive,
+		MaxIdleConnsPerHost: 1,
+		// 不设置会话缓存, 每次新建连接都完整握手（与设备端一致）
+		TLSClientConfig: &tls.Config{InsecureSkipVerify: true},
+	}
+	return &http.Client{Transport: transport, Timeout: 5 * time.Second}
+}
+
+func upload(tb testing.TB, client *http.Client, url string) {
+	resp, err := client.Post(url+"/api/data/batch", "application/json", bytes.NewReader(uploadBody))
+	if err != nil {
+		tb.Fatal(err)
+	}
+	io.Copy(io.Discard, resp.Body)
+	resp.Body.Close()
+	if resp.StatusCode != http.StatusAccepted {
+		tb.Fatalf("状态码 %d", resp.StatusCode)
+	}
+}
+
+func TestUploadKeepAliveReusesConnection(t *testing.T) {
+	for _, keepAlive := range []bool{true, false} {
+		var conns int64
+		srv := newUploadServer(false, &conns)
+		client := uploadClient(keepAlive)
+		for i := 0; i < 20; i++ {
+			upload(t, client, srv.URL)
+		}
+		srv.Close()
+
+		want := int64(1)
+		if !keepAlive {
+			want = 20
+		}
+		if conns != want {
+			t.Errorf("keepAlive=%v: 新建连接 %d 次, 期望 %d", keepAlive, conns, want)
+		}
+	}
+}
+
+func benchmarkUpload(b *testing.B, tlsEnabled, keepAlive bool) {
+	var conns int64
+	srv := newUploadServer(tlsEnabled, &conns)
+	defer srv.Close()
+	client := uploadClient(keepAlive)
+
+	b.ResetTimer()
+	start := time.Now()
+	for i := 0; i < b.N; i++ {
+		upload(b, client, srv.URL)
+	}
+	b.ReportMetric(float64(b.N)/time.Since(start).Seconds(), "req/s")
+	b.ReportMetric(float64(atomic.LoadInt64(&conns)), "conns")
+}
+
+func BenchmarkUploadHTTPNewConnection(b *testing.B)  { benchmarkUpload(b, false, false) }
+func BenchmarkUploadHTTPKeepAlive(b *testing.B)      { benchmarkUpload(b, false, true) }
+func BenchmarkUploadHTTPSNewConnection(b *testing.B) { benchmarkUpload(b, true, false) }
+func BenchmarkUploadHTTPSKeepAlive(b *testing.B)     { benchmarkUpload(b, true, true) }
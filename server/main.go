@@ -1,19 +1,27 @@
 package main
 
 import (
+	"cmp"
+	"context"
 	"embed"
+	"encoding/binary"
 	"encoding/json"
 	"fmt"
 	"io"
 	"io/fs"
 	"log"
 	"math"
+	"mime"
 	"net/http"
 	"os"
+	"os/signal"
+	"slices"
 	"sort"
 	"strconv"
 	"strings"
 	"sync"
+	"sync/atomic"
+	"syscall"
 	"time"
 
 	"github.com/glebarez/sqlite"
@@ -28,6 +36,7 @@ var webDist embed.FS
 type SensorData struct {
 	ID          uint      `gorm:"column:id;primaryKey;autoIncrement;comment:主键ID" json:"id"`
 	CreatedAt   time.Time `gorm:"column:created_at;index;comment:数据接收时间" json:"created_at"`
+	CapturedAt  time.Time `gorm:"column:captured_at;comment:数据采集时间(设备上报, 缺失或不可信时为接收时间)" json:"captured_at"`
 	Particle    float64   `gorm:"column:particle;comment:>0.3um颗粒数(pcs/0.1L)" json:"particle"`             // V1: >0.3um颗粒数
 	PM25        float64   `gorm:"column:pm25;comment:PM2.5(μg/m³)" json:"pm25"`                            // V2: PM2.5
 	HCHO        float64   `gorm:"column:hcho;comment:甲醛(μg/m³)" json:"hcho"`                               // V3: 甲醛
@@ -37,33 +46,115 @@ type SensorData struct {
 	VOC         float64   `gorm:"column:voc;comment:VOC(ppb)" json:"voc"`                                  // V7: VOC
 	SequenceNum int64     `gorm:"column:sequence_num;index;comment:设备递增序号(用于判断传感器状态)" json:"sequence_num"` // V8: 序号
 	IsValid     bool      `gorm:"column:is_valid;index;comment:传感器是否正常(true=序号递增正常,false=可能故障)" json:"is_valid"`
+	DeviceID    string    `gorm:"column:device_id;index;default:'';comment:设备ID(采集器MAC地址)" json:"device_id"`
+	Flags       uint8     `gorm:"column:flags;default:0;comment:设备记录标志(1=超出量程,2=跳号,4=重复,8=回退,16=设备未校时,128=设备已检查序号)" json:"flags"`
 }
 
-var (
-	db            *gorm.DB
-	lastSequence  int64
-	sequenceMutex sync.Mutex
-)
+var db *gorm.DB
 
 func main() {
 	if err := initDB(); err != nil {
 		log.Fatal("数据库初始化失败:", err)
 	}
 
+	// backfill 子命令: 根据原始记录重建聚合表
+	if len(os.Args) > 1 && os.Args[1] == "backfill" {
+		if err := backfillRollups(); err != nil {
+			log.Fatal("聚合回填失败:", err)
+		}
+		return
+	}
+
+	// columnar 子命令: 根据原始记录重建列存
+	if len(os.Args) > 1 && os.Args[1] == "columnar" {
+		dir := os.Getenv("COLUMNAR_PATH")
+		if dir == "" {
+			log.Fatal("未设置 COLUMNAR_PATH")
+		}
+		if err := migrateColumnStore(dir); err != nil {
+			log.Fatal("列存迁移失败:", err)
+		}
+		return
+	}
+
+	// 升级后首次启动时自动回填历史数据
+	if backfill, err := needsBackfill(); err != nil {
+		log.Fatal("检查聚合表失败:", err)
+	} else if backfill {
+		log.Println("聚合表为空, 开始回填历史数据")
+		if err := backfillRollups(); err != nil {
+			log.Fatal("聚合回填失败:", err)
+		}
+	} else if store.removedDuplicates > 0 {
+		log.Printf("已删除 %d 条重复记录, 重建聚合表（启用列存时请执行 columnar 子命令重建列存）\n", store.removedDuplicates)
+		if err := backfillRollups(); err != nil {
+			log.Fatal("聚合回填失败:", err)
+		}
+	}
+
+	if err := initColumnStore(); err != nil {
+		log.Fatal(err)
+	}
+
+	hot = newHotWindow()
+	if err := hot.load(); err != nil {
+		log.Fatal("加载热数据缓存失败:", err)
+	}
+
+	ingest = newIngestQueue()
+
+	// 数据保留策略（可选）
+	retentionCtx, stopRetention := context.WithCancel(context.Background())
+	defer stopRetention()
+	if retention = newRetentionPolicy(); retention != nil {
+		if err := enableIncrementalVacuum(store.sqlDB); err != nil {
+			log.Fatal("切换增量回收模式失败:", err)
+		}
+		go retention.Run(retentionCtx)
+	}
+
 	distFS, err := fs.Sub(webDist, "web/dist")
 	if err != nil {
 		log.Fatal("静态资源加载失败:", err)
 	}
 
 	http.HandleFunc("/api/data", handleData)
+	http.HandleFunc("/api/data/batch", handleDataBatch)
+	http.HandleFunc("/api/data/summary", handleDataSummary)
 	http.HandleFunc("/api/status", handleStatus)
 	http.HandleFunc("/api/history", handleHistory)
-	http.HandleFunc("/api/stats", handleStats)
-	http.HandleFunc("/api/analysis", handleAnalysis)
+	http.HandleFunc("/api/stats", respCache.cached(handleStats))
+	http.HandleFunc("/api/analysis", respCache.cached(handleAnalysis))
+	http.HandleFunc("/api/metrics", handleMetrics)
+	http.HandleFunc("/api/stream", handleStream)
 	http.Handle("/", http.FileServer(http.FS(distFS)))
 
+	server := &http.Server{Addr: ":8080"}
+	// 实时推送连接不会自行结束, 停止时先断开
+	server.RegisterOnShutdown(hub.Close)
+
+	// 收到退出信号后停止接收请求, 并等待写入队列中的数据写完
+	go func() {
+		sig := make(chan os.Signal, 1)
+		signal.Notify(sig, os.Interrupt, syscall.SIGTERM)
+		<-sig
+		ctx, cancel := context.WithTimeout(context.Background(), 10*time.Second)
+		defer cancel()
+		server.Shutdown(ctx)
+	}()
+
 	log.Println("服务已启动:8080")
-	log.Fatal(http.ListenAndServe(":8080", nil))
+	if err := server.ListenAndServe(); err != http.ErrServerClosed {
+		log.Fatal(err)
+	}
+	stopRetention()
+	ingest.Close()
+	if columns != nil {
+		if err := columns.Close(); err != nil {
+			log.Println("列存写入失败:", err)
+		}
+	}
+	log.Println("服务已停止")
 }
 
 // initDB 初始化数据库
@@ -73,8 +164,9 @@ func initDB() error {
 	if dbPath == "" {
 		dbPath = "/data/sensor.db"
 	}
-	db, err = gorm.Open(sqlite.Open(dbPath), &gorm.Config{
-		Logger: logger.Default.LogMode(logger.Silent),
+	db, err = gorm.Open(sqlite.Open(sqliteDSN(dbPath)), &gorm.Config{
+		Logger:      logger.Default.LogMode(logger.Silent),
+		PrepareStmt: true,
 	})
 	if err != nil {
 		return err
@@ -85,89 +177,497 @@ func initDB() error {
 		return err
 	}
 
-	// 从数据库加载最后的序列号
-	var latest SensorData
-	if err := db.Order("sequence_num desc").First(&latest).Error; err == nil {
-		lastSequence = latest.SequenceNum
-		log.Printf("加载的最后序列号: %d\n", lastSequence)
+	// 热点读写路径使用预编译语句
+	sqlDB, err := db.DB()
+	if err != nil {
+		return err
 	}
+	store, err = newSensorStore(sqlDB)
+	return err
+}
+
+// maxBatchSize 单次批量上报允许的最大条数
+const maxBatchSize = 500
 
-	return nil
+// dataRequest 设备上报的单条数据
+type dataRequest struct {
+	Data  string `json:"data"`
+	Flags uint8  `json:"flags"`
+	TS    int64  `json:"ts"` // 采集时间(UTC毫秒), 可选
 }
 
-func handleData(w http.ResponseWriter, r *http.Request) {
-	if r.Method != http.MethodPost {
-		http.Error(w, "请求方法不允许", http.StatusMethodNotAllowed)
-		return
+// parseSensorData 解析逗号分隔的B39数据行
+func parseSensorData(line string) (SensorData, error) {
+	fields := strings.Split(line, ",")
+	if len(fields) != 8 {
+		return SensorData{}, fmt.Errorf("数据格式错误, 需要8个字段")
 	}
 
-	body, err := io.ReadAll(r.Body)
+	// 转换数据
+	var values [8]float64
+	for i, f := range fields {
+		v, err := strconv.ParseFloat(strings.TrimSpace(f), 64)
+		if err != nil {
+			return SensorData{}, fmt.Errorf("第%d个字段数值错误", i+1)
+		}
+		values[i] = v
+	}
+
+	return SensorData{
+		Particle:    values[0], // V1: >0.3um颗粒数
+		PM25:        values[1], // V2: PM2.5
+		HCHO:        values[2], // V3: 甲醛
+		CO2:         values[3], // V4: CO2
+		Temperature: values[4], // V5: 温度
+		Humidity:    values[5], // V6: 湿度
+		VOC:         values[6], // V7: VOC
+		SequenceNum: int64(values[7]),
+	}, nil
+}
+
+// deviceIDHeader 采集器上报设备ID（MAC地址）的请求头, 未携带时视为同一台旧设备
+const deviceIDHeader = "X-Device-ID"
+
+// maxDeviceIDLen 设备ID最大长度
+const maxDeviceIDLen = 32
+
+// sequenceShardCount 序号状态分片数, 不同设备的请求仅在同一分片内竞争
+const sequenceShardCount = 16
+
+// sequenceWindow 每台设备在内存中保留的最近记录数, 更早的记录从数据库查找相邻序号
+const sequenceWindow = 256
+
+// sequencePoint 一条记录的采集时间与序号
+type sequencePoint struct {
+	ts  int64 // 采集时间, 纳秒
+	seq int64
+}
+
+// fallbackRetryWindow 采集时间不可用的记录在此时间内再次收到（相同上报时间与序号）时视为重发
+const fallbackRetryWindow = 10 * time.Minute
+
+// fallbackPoint 一条以接收时间代替采集时间的记录
+type fallbackPoint struct {
+	reported time.Time // 设备上报的采集时间（缺失时为零值）
+	seq      int64
+	assigned int64 // 代替的采集时间, 纳秒
+}
+
+// deviceSequence 单台设备的序号状态: 按采集时间排序的最近若干条记录, 首次使用时从数据库加载
+type deviceSequence struct {
+	mu       sync.Mutex
+	loaded   bool
+	recent   []sequencePoint
+	fallback []fallbackPoint // 最近的 sequenceWindow 条以接收时间代替采集时间的记录, 按接收顺序
+	queued   []sequencePoint // 早于窗口、已检查但尚未写入数据库的记录, 按采集时间排序
+}
+
+// sequenceShard 序号状态分片
+type sequenceShard struct {
+	mu      sync.Mutex
+	devices map[string]*deviceSequence
+}
+
+var sequenceShards [sequenceShardCount]sequenceShard
+
+// deviceIDFromRequest 读取并校验请求中的设备ID
+func deviceIDFromRequest(r *http.Request) (string, error) {
+	deviceID := strings.TrimSpace(r.Header.Get(deviceIDHeader))
+	if len(deviceID) > maxDeviceIDLen {
+		return "", fmt.Errorf("设备ID过长")
+	}
+	return deviceID, nil
+}
+
+// getDeviceSequence 获取设备的序号状态（未加锁、可能尚未加载）
+func getDeviceSequence(deviceID string) *deviceSequence {
+	// FNV-1a 哈希选择分片
+	hash := uint32(2166136261)
+	for i := 0; i < len(deviceID); i++ {
+		hash ^= uint32(deviceID[i])
+		hash *= 16777619
+	}
+	shard := &sequenceShards[hash%sequenceShardCount]
+
+	shard.mu.Lock()
+	defer shard.mu.Unlock()
+	if shard.devices == nil {
+		shard.devices = make(map[string]*deviceSequence)
+	}
+	seq, ok := shard.devices[deviceID]
+	if !ok {
+		seq = &deviceSequence{}
+		shard.devices[deviceID] = seq
+	}
+	return seq
+}
+
+// load 从数据库加载设备最近的记录, 调用方需持有 seq.mu
+func (seq *deviceSequence) load(deviceID string) {
+	if seq.loaded {
+		return
+	}
+	rows, err := store.seqRecent.Query(deviceID, sequenceWindow)
 	if err != nil {
-		http.Error(w, "读取请求体失败", http.StatusBadRequest)
+		// 加载失败时下次再试, 本次按无历史数据处理
+		log.Printf("加载设备 %q 序列号失败: %v\n", deviceID, err)
 		return
 	}
-	defer r.Body.Close()
+	defer rows.Close()
 
-	var req struct {
-		Data string `json:"data"`
+	recent := make([]sequencePoint, 0, sequenceWindow)
+	for rows.Next() {
+		var ts time.Time
+		var p sequencePoint
+		if err := rows.Scan(&ts, &p.seq); err != nil {
+			log.Printf("加载设备 %q 序列号失败: %v\n", deviceID, err)
+			return
+		}
+		p.ts = ts.UnixNano()
+		recent = append(recent, p)
 	}
-	if err := json.Unmarshal(body, &req); err != nil {
-		http.Error(w, "JSON格式错误", http.StatusBadRequest)
+	if err := rows.Err(); err != nil {
+		log.Printf("加载设备 %q 序列号失败: %v\n", deviceID, err)
 		return
 	}
+	slices.Reverse(recent)
+	seq.recent = recent
+	if len(recent) > 0 {
+		log.Printf("加载设备 %q 的最后序列号: %d\n", deviceID, recent[len(recent)-1].seq)
+	}
+	seq.loaded = true
+}
 
-	// 解析逗号分隔的数据
-	fields := strings.Split(req.Data, ",")
-	if len(fields) != 8 {
-		http.Error(w, "数据格式错误, 需要8个字段", http.StatusBadRequest)
+// neighbors 查找采集时间 ts 前后相邻记录的序号（不存在时 ok 为 false）:
+// 在内存窗口内时直接查找, 早于窗口时（补传的旧数据）查询数据库并合并仍在写入队列中的记录; 调用方需持有 seq.mu
+func (seq *deviceSequence) neighbors(deviceID string, ts time.Time, lo, hi int) (prev, next int64, prevOK, nextOK bool) {
+	if lo > 0 || len(seq.recent) < sequenceWindow {
+		if lo > 0 {
+			prev, prevOK = seq.recent[lo-1].seq, true
+		}
+		if hi < len(seq.recent) {
+			next, nextOK = seq.recent[hi].seq, true
+		}
 		return
 	}
+	var prevAt, nextAt time.Time
+	prevOK = store.seqBefore.QueryRow(deviceID, ts).Scan(&prevAt, &prev) == nil
+	nextOK = store.seqAfter.QueryRow(deviceID, ts).Scan(&nextAt, &next) == nil
 
-	// 转换数据
-	values := make([]float64, 8)
-	for i, f := range fields {
-		v, err := strconv.ParseFloat(strings.TrimSpace(f), 64)
+	// 仍在写入队列中的记录不在数据库中, 取各处采集时间最近的一条; 窗口中的记录都不早于 ts, 只能作为后一条
+	t := ts.UnixNano()
+	if hi < len(seq.recent) && (!nextOK || seq.recent[hi].ts < nextAt.UnixNano()) {
+		next, nextOK, nextAt = seq.recent[hi].seq, true, time.Unix(0, seq.recent[hi].ts)
+	}
+	i := sort.Search(len(seq.queued), func(i int) bool { return seq.queued[i].ts >= t })
+	if i > 0 && (!prevOK || seq.queued[i-1].ts > prevAt.UnixNano()) {
+		prev, prevOK = seq.queued[i-1].seq, true
+	}
+	j := sort.Search(len(seq.queued), func(i int) bool { return seq.queued[i].ts > t })
+	if j < len(seq.queued) && (!nextOK || seq.queued[j].ts < nextAt.UnixNano()) {
+		next, nextOK = seq.queued[j].seq, true
+	}
+	return
+}
+
+// check 检查序号是否介于采集时间相邻的前后两条记录之间（乱序到达的记录同样适用）, 并记入窗口;
+// 同一采集时间、同一序号的记录视为重发, 不重复记入; 调用方需持有 seq.mu
+func (seq *deviceSequence) check(deviceID string, capturedAt time.Time, sequenceNum int64) bool {
+	ts := capturedAt.UnixNano()
+	lo := sort.Search(len(seq.recent), func(i int) bool { return seq.recent[i].ts >= ts })
+	hi := lo
+	retry := false
+	for ; hi < len(seq.recent) && seq.recent[hi].ts == ts; hi++ {
+		retry = retry || seq.recent[hi].seq == sequenceNum
+	}
+
+	prev, next, prevOK, nextOK := seq.neighbors(deviceID, capturedAt, lo, hi)
+	isValid := (!prevOK || sequenceNum > prev) && (!nextOK || sequenceNum < next)
+
+	p := sequencePoint{ts: ts, seq: sequenceNum}
+	switch {
+	case retry:
+		// 重发的记录已在窗口中
+	case hi > 0 || len(seq.recent) < sequenceWindow:
+		seq.recent = slices.Insert(seq.recent, hi, p)
+		if len(seq.recent) > sequenceWindow {
+			seq.recent = slices.Delete(seq.recent, 0, 1)
+		}
+	default:
+		// 早于窗口的补传记录在写入前由 queued 代替数据库提供相邻序号, 写入后由 releaseQueued 移除
+		if i, found := slices.BinarySearchFunc(seq.queued, p, compareSequencePoints); !found {
+			seq.queued = slices.Insert(seq.queued, i, p)
+		}
+	}
+	return isValid
+}
+
+// compareSequencePoints 按采集时间、序号排序
+func compareSequencePoints(a, b sequencePoint) int {
+	if c := cmp.Compare(a.ts, b.ts); c != 0 {
+		return c
+	}
+	return cmp.Compare(a.seq, b.seq)
+}
+
+// releaseQueued 写入协程写完（或丢弃）一批记录后, 将其中旧固件的记录移出各设备的 queued
+func releaseQueued(records []SensorData) {
+	var seq *deviceSequence
+	deviceID := ""
+	for i := range records {
+		d := &records[i]
+		if d.Flags&flagSeqTracked != 0 {
+			continue
+		}
+		if seq == nil || d.DeviceID != deviceID {
+			if seq != nil {
+				seq.mu.Unlock()
+			}
+			deviceID = d.DeviceID
+			seq = getDeviceSequence(deviceID)
+			seq.mu.Lock()
+		}
+		p := sequencePoint{ts: d.CapturedAt.UnixNano(), seq: d.SequenceNum}
+		if j, found := slices.BinarySearchFunc(seq.queued, p, compareSequencePoints); found {
+			seq.queued = slices.Delete(seq.queued, j, j+1)
+		}
+	}
+	if seq != nil {
+		seq.mu.Unlock()
+	}
+}
+
+// fallbackTime 采集时间不可用的记录以接收时间代替; 近期收到过上报时间与序号都相同的记录时沿用当时代替的时间,
+// 重发的记录因此与首次收到的记录完全相同, 由唯一索引 idx_sensor_data_reading 去重; 调用方需持有 seq.mu
+func (seq *deviceSequence) fallbackTime(reported time.Time, sequenceNum int64, receivedAt time.Time) time.Time {
+	horizon := receivedAt.Add(-fallbackRetryWindow).UnixNano()
+	for i := len(seq.fallback) - 1; i >= 0; i-- {
+		p := &seq.fallback[i]
+		if p.seq == sequenceNum && p.assigned >= horizon && p.reported.Equal(reported) {
+			return time.Unix(0, p.assigned)
+		}
+	}
+
+	seq.fallback = append(seq.fallback, fallbackPoint{reported: reported, seq: sequenceNum, assigned: receivedAt.UnixNano()})
+	if len(seq.fallback) > sequenceWindow {
+		seq.fallback = slices.Delete(seq.fallback, 0, 1)
+	}
+	return receivedAt
+}
+
+// checkRecords 检查同一设备各条记录的传感器状态, 并记录设备ID与接收时间, 返回正常的条数
+//
+// 设备已检查序号的记录直接使用设备标志, 无需加锁; 旧固件上报的记录按采集时间与该设备相邻记录的序号判断;
+// 采集时间不可用的记录见 fallbackTime
+func checkRecords(deviceID string, records []SensorData) int {
+	var seq *deviceSequence
+	lock := func() {
+		if seq == nil {
+			seq = getDeviceSequence(deviceID)
+			seq.mu.Lock()
+			seq.load(deviceID)
+		}
+	}
+	validCount := 0
+	receivedAt := time.Now()
+	for i := range records {
+		data := &records[i]
+		data.DeviceID = deviceID
+		data.CreatedAt = receivedAt
+		if !trustCaptureTime(data.Flags, data.CapturedAt, receivedAt) {
+			lock()
+			data.CapturedAt = seq.fallbackTime(data.CapturedAt, data.SequenceNum, receivedAt)
+			atomic.AddInt64(&ingest.stats.CaptureFallbacks, 1)
+		}
+		if data.Flags&flagSeqTracked != 0 {
+			data.IsValid = data.Flags&flagInvalidMask == 0
+		} else {
+			lock()
+			data.IsValid = seq.check(deviceID, data.CapturedAt, data.SequenceNum) && data.Flags&flagOutOfRange == 0
+		}
+		if data.IsValid {
+			validCount++
+		}
+	}
+	if seq != nil {
+		seq.mu.Unlock()
+	}
+	return validCount
+}
+
+// 采集时间的合理范围: 早于 captureTimeFloor 说明设备时钟未设置, 晚于接收时间 captureClockSkew 以上说明设备时钟超前
+var captureTimeFloor = time.Date(2020, 1, 1, 0, 0, 0, 0, time.UTC)
+
+const captureClockSkew = 5 * time.Minute
+
+// trustCaptureTime 判断设备上报的采集时间是否可用
+func trustCaptureTime(flags uint8, capturedAt, receivedAt time.Time) bool {
+	return flags&flagTimeUnsynced == 0 &&
+		!capturedAt.Before(captureTimeFloor) &&
+		!capturedAt.After(receivedAt.Add(captureClockSkew))
+}
+
+// 二进制上报格式 (application/vnd.b39.record), 每条记录固定44字节, 小端序:
+//
+//	偏移  长度  字段
+//	0     1     版本号
+//	1     1     记录标志
+//	2     2     保留
+//	4     4     设备序号 (uint32)
+//	8     8     采集时间 (UTC毫秒, int64; 带未校时标志时为设备开机后的时间)
+//	16    28    V1~V7 测量值 ×100 (int32)
+const (
+	binaryContentType   = "application/vnd.b39.record"
+	binaryRecordSize    = 44
+	binaryRecordVersion = 1
+	binaryValueScale    = 100
+)
+
+// 设备记录标志
+const (
+	flagOutOfRange   = 1 << 0 // 测量值超出传感器量程
+	flagSeqGap       = 1 << 1 // 序号跳号（中间有数据丢失）
+	flagSeqDup       = 1 << 2 // 序号重复
+	flagSeqReset     = 1 << 3 // 序号回退（传感器重启）
+	flagTimeUnsynced = 1 << 4 // 设备尚未校时, 采集时间不可用
+	flagSummary      = 1 << 5 // 设备汇总（窗口内各帧标志的并集, 仅出现在 /api/data/summary）
+	flagSeqTracked   = 1 << 7 // 序号已由设备检查
+	flagInvalidMask  = flagOutOfRange | flagSeqDup | flagSeqReset
+)
+
+// decodeBinaryRecords 解码二进制格式的记录, 无需字符串处理
+func decodeBinaryRecords(body []byte) ([]SensorData, error) {
+	if len(body) == 0 || len(body)%binaryRecordSize != 0 {
+		return nil, fmt.Errorf("二进制数据长度错误, 需为%d字节的整数倍", binaryRecordSize)
+	}
+
+	records := make([]SensorData, len(body)/binaryRecordSize)
+	for i := range records {
+		rec := body[i*binaryRecordSize : (i+1)*binaryRecordSize]
+		if rec[0] != binaryRecordVersion {
+			return nil, fmt.Errorf("第%d条记录版本不支持: %d", i+1, rec[0])
+		}
+
+		var values [7]float64
+		for j := range values {
+			v := int32(binary.LittleEndian.Uint32(rec[16+j*4:]))
+			values[j] = float64(v) / binaryValueScale
+		}
+
+		records[i] = SensorData{
+			CapturedAt:  time.UnixMilli(int64(binary.LittleEndian.Uint64(rec[8:]))),
+			Particle:    values[0], // V1: >0.3um颗粒数
+			PM25:        values[1], // V2: PM2.5
+			HCHO:        values[2], // V3: 甲醛
+			CO2:         values[3], // V4: CO2
+			Temperature: values[4], // V5: 温度
+			Humidity:    values[5], // V6: 湿度
+			VOC:         values[6], // V7: VOC
+			SequenceNum: int64(binary.LittleEndian.Uint32(rec[4:])),
+			Flags:       rec[1],
+		}
+	}
+	return records, nil
+}
+
+// readSensorData 按 Content-Type 读取并解析上报数据, 返回的状态码用于错误响应
+//
+// JSON 格式: 单条为 {"data":"...","flags":N,"ts":T}, 批量为 [{...}, ...], flags 与 ts 可省略
+// 二进制格式: 单条为一条记录, 批量为多条记录依次拼接
+func readSensorData(r *http.Request, batch bool) ([]SensorData, int, error) {
+	isBinary := false
+	if contentType := r.Header.Get("Content-Type"); contentType != "" {
+		mediaType, _, err := mime.ParseMediaType(contentType)
 		if err != nil {
-			http.Error(w, fmt.Sprintf("第%d个字段数值错误", i+1), http.StatusBadRequest)
-			return
+			return nil, http.StatusUnsupportedMediaType, fmt.Errorf("Content-Type 格式错误")
+		}
+		switch mediaType {
+		case "application/json":
+		case binaryContentType:
+			isBinary = true
+		default:
+			return nil, http.StatusUnsupportedMediaType, fmt.Errorf("不支持的数据格式: %s", mediaType)
 		}
-		values[i] = v
 	}
 
-	sequenceNum := int64(values[7])
+	body, err := io.ReadAll(r.Body)
+	if err != nil {
+		return nil, http.StatusBadRequest, fmt.Errorf("读取请求体失败")
+	}
+	defer r.Body.Close()
 
-	// 检查传感器状态（序号是否递增）
-	sequenceMutex.Lock()
-	isValid := sequenceNum > lastSequence
-	if isValid {
-		lastSequence = sequenceNum
+	if isBinary {
+		records, err := decodeBinaryRecords(body)
+		if err != nil {
+			return nil, http.StatusBadRequest, err
+		}
+		if !batch && len(records) != 1 {
+			return nil, http.StatusBadRequest, fmt.Errorf("单条上报只能包含1条记录")
+		}
+		return records, http.StatusOK, nil
 	}
-	sequenceMutex.Unlock()
 
-	// 保存到数据库
-	sensorData := SensorData{
-		Particle:    values[0], // V1: >0.3um颗粒数
-		PM25:        values[1], // V2: PM2.5
-		HCHO:        values[2], // V3: 甲醛
-		CO2:         values[3], // V4: CO2
-		Temperature: values[4], // V5: 温度
-		Humidity:    values[5], // V6: 湿度
-		VOC:         values[6], // V7: VOC
-		SequenceNum: sequenceNum,
-		IsValid:     isValid,
+	var reqs []dataRequest
+	if batch {
+		err = json.Unmarshal(body, &reqs)
+	} else {
+		reqs = make([]dataRequest, 1)
+		err = json.Unmarshal(body, &reqs[0])
+	}
+	if err != nil {
+		return nil, http.StatusBadRequest, fmt.Errorf("JSON格式错误")
+	}
+
+	records := make([]SensorData, len(reqs))
+	for i, req := range reqs {
+		// 解析逗号分隔的数据
+		sensorData, err := parseSensorData(req.Data)
+		if err != nil {
+			if batch {
+				err = fmt.Errorf("第%d条%s", i+1, err.Error())
+			}
+			return nil, http.StatusBadRequest, err
+		}
+		sensorData.Flags = req.Flags
+		if req.TS > 0 {
+			sensorData.CapturedAt = time.UnixMilli(req.TS)
+		}
+		records[i] = sensorData
+	}
+	return records, http.StatusOK, nil
+}
+
+func handleData(w http.ResponseWriter, r *http.Request) {
+	if r.Method != http.MethodPost {
+		http.Error(w, "请求方法不允许", http.StatusMethodNotAllowed)
+		return
 	}
 
-	if err := db.Create(&sensorData).Error; err != nil {
-		http.Error(w, "保存数据失败", http.StatusInternalServerError)
+	deviceID, err := deviceIDFromRequest(r)
+	if err != nil {
+		http.Error(w, err.Error(), http.StatusBadRequest)
+		return
+	}
+
+	records, status, err := readSensorData(r, false)
+	if err != nil {
+		http.Error(w, err.Error(), status)
 		return
 	}
 
-	// 打印接收到的数据
-	prettyJSON, _ := json.MarshalIndent(sensorData, "", "  ")
-	fmt.Printf("收到数据:\n%s\n", string(prettyJSON))
+	// 检查传感器状态（序号是否递增）
+	checkRecords(deviceID, records)
+	sensorData := records[0]
+	isValid := sensorData.IsValid
+
+	// 加入写入队列后立即应答
+	if !ingest.Enqueue(records) {
+		writeBusy(w)
+		return
+	}
 
 	w.Header().Set("Content-Type", "application/json")
-	w.WriteHeader(http.StatusOK)
+	w.WriteHeader(http.StatusAccepted)
 	json.NewEncoder(w).Encode(map[string]any{
 		"status":  "success",
 		"data":    sensorData,
@@ -175,63 +675,99 @@ func handleData(w http.ResponseWriter, r *http.Request) {
 	})
 }
 
-// handleStatus 获取传感器当前状态
-func handleStatus(w http.ResponseWriter, r *http.Request) {
-	if r.Method != http.MethodGet {
+// writeBusy 写入队列已满时应答 503, 设备稍后重发
+func writeBusy(w http.ResponseWriter) {
+	w.Header().Set("Retry-After", "1")
+	http.Error(w, "服务器繁忙, 请稍后重试", http.StatusServiceUnavailable)
+}
+
+// handleDataBatch 批量接收数据, 请求体为 [{"data":"..."}, ...] 或拼接的二进制记录
+func handleDataBatch(w http.ResponseWriter, r *http.Request) {
+	if r.Method != http.MethodPost {
 		http.Error(w, "请求方法不允许", http.StatusMethodNotAllowed)
 		return
 	}
 
-	var latest SensorData
-	if err := db.Order("created_at desc").First(&latest).Error; err != nil {
-		http.Error(w, "暂无数据", http.StatusNotFound)
+	deviceID, err := deviceIDFromRequest(r)
+	if err != nil {
+		http.Error(w, err.Error(), http.StatusBadRequest)
+		return
+	}
+
+	records, status, err := readSensorData(r, true)
+	if err != nil {
+		http.Error(w, err.Error(), status)
+		return
+	}
+	if len(records) == 0 {
+		http.Error(w, "批量数据为空", http.StatusBadRequest)
+		return
+	}
+	if len(records) > maxBatchSize {
+		http.Error(w, fmt.Sprintf("批量数据过多, 最多%d条", maxBatchSize), http.StatusRequestEntityTooLarge)
+		return
+	}
+
+	// 按上报顺序检查序号
+	validCount := checkRecords(deviceID, records)
+
+	// 加入写入队列后立即应答
+	if !ingest.Enqueue(records) {
+		writeBusy(w)
 		return
 	}
 
 	w.Header().Set("Content-Type", "application/json")
+	w.WriteHeader(http.StatusAccepted)
 	json.NewEncoder(w).Encode(map[string]any{
-		"sensor_status": map[bool]string{true: "正常", false: "异常"}[latest.IsValid],
-		"last_sequence": latest.SequenceNum,
-		"last_data":     latest,
+		"status": "success",
+		"count":  len(records),
+		"valid":  validCount,
 	})
 }
 
-// handleHistory 获取历史数据
-func handleHistory(w http.ResponseWriter, r *http.Request) {
+// handleMetrics 获取服务运行指标
+func handleMetrics(w http.ResponseWriter, r *http.Request) {
 	if r.Method != http.MethodGet {
 		http.Error(w, "请求方法不允许", http.StatusMethodNotAllowed)
 		return
 	}
 
-	// 支持 hours 参数按时间范围查询
-	hoursStr := r.URL.Query().Get("hours")
-	limitStr := r.URL.Query().Get("limit")
-
-	var records []SensorData
-	query := db.Order("created_at desc")
-
-	if hoursStr != "" {
-		if h, err := strconv.Atoi(hoursStr); err == nil && h > 0 {
-			startTime := time.Now().Add(-time.Duration(h) * time.Hour)
-			query = query.Where("created_at >= ?", startTime)
-		}
+	metrics := map[string]any{
+		"ingest": ingest.Metrics(),
+		"stream": hub.Metrics(),
+		"hot":    hot.Metrics(),
+		"cache":  respCache.Metrics(),
+	}
+	if columns != nil {
+		metrics["columnar"] = columns.Metrics()
+	}
+	if retention != nil {
+		metrics["retention"] = retention.Metrics()
 	}
 
-	if limitStr != "" {
-		if l, err := strconv.Atoi(limitStr); err == nil && l > 0 {
-			query = query.Limit(l)
-		}
+	w.Header().Set("Content-Type", "application/json")
+	json.NewEncoder(w).Encode(metrics)
+}
+
+// handleStatus 获取传感器当前状态
+func handleStatus(w http.ResponseWriter, r *http.Request) {
+	if r.Method != http.MethodGet {
+		http.Error(w, "请求方法不允许", http.StatusMethodNotAllowed)
+		return
 	}
 
-	if err := query.Find(&records).Error; err != nil {
-		http.Error(w, "获取数据失败", http.StatusInternalServerError)
+	latest, found, err := latestSince(time.Time{})
+	if err != nil || !found {
+		http.Error(w, "暂无数据", http.StatusNotFound)
 		return
 	}
 
 	w.Header().Set("Content-Type", "application/json")
 	json.NewEncoder(w).Encode(map[string]any{
-		"count": len(records),
-		"data":  records,
+		"sensor_status": map[bool]string{true: "正常", false: "异常"}[latest.IsValid],
+		"last_sequence": latest.SequenceNum,
+		"last_data":     latest,
 	})
 }
 
@@ -245,73 +781,20 @@ type StatsResult struct {
 	Count  int     `json:"count"`
 }
 
-// 计算统计数据
-func calculateStats(values []float64) StatsResult {
-	if len(values) == 0 {
+// calculateStats 根据聚合值计算统计数据
+func calculateStats(agg *rollupAgg, i int) StatsResult {
+	if agg.Count == 0 {
 		return StatsResult{}
 	}
 
-	// 排序用于计算中位数
-	sorted := make([]float64, len(values))
-	copy(sorted, values)
-	sort.Float64s(sorted)
-
-	// 计算各项统计值
-	min, max := sorted[0], sorted[len(sorted)-1]
-	sum := 0.0
-	for _, v := range values {
-		sum += v
-	}
-	avg := sum / float64(len(values))
-
-	// 中位数
-	median := sorted[len(sorted)/2]
-	if len(sorted)%2 == 0 {
-		median = (sorted[len(sorted)/2-1] + sorted[len(sorted)/2]) / 2
-	}
-
-	// 标准差
-	variance := 0.0
-	for _, v := range values {
-		variance += (v - avg) * (v - avg)
-	}
-	stdDev := math.Sqrt(variance / float64(len(values)))
-
 	return StatsResult{
-		Min:    math.Round(min*100) / 100,
-		Max:    math.Round(max*100) / 100,
-		Avg:    math.Round(avg*100) / 100,
-		Median: math.Round(median*100) / 100,
-		StdDev: math.Round(stdDev*100) / 100,
-		Count:  len(values),
-	}
-}
-
-// 计算相关系数
-func calculateCorrelation(x, y []float64) float64 {
-	if len(x) != len(y) || len(x) == 0 {
-		return 0
-	}
-
-	n := float64(len(x))
-	sumX, sumY, sumXY, sumX2, sumY2 := 0.0, 0.0, 0.0, 0.0, 0.0
-
-	for i := range x {
-		sumX += x[i]
-		sumY += y[i]
-		sumXY += x[i] * y[i]
-		sumX2 += x[i] * x[i]
-		sumY2 += y[i] * y[i]
-	}
-
-	numerator := n*sumXY - sumX*sumY
-	denominator := math.Sqrt((n*sumX2 - sumX*sumX) * (n*sumY2 - sumY*sumY))
-
-	if denominator == 0 {
-		return 0
+		Min:    math.Round(agg.Min[i]*100) / 100,
+		Max:    math.Round(agg.Max[i]*100) / 100,
+		Avg:    math.Round(agg.Mean[i]*100) / 100,
+		Median: math.Round(agg.Median(i)*100) / 100,
+		StdDev: math.Round(agg.StdDev(i)*100) / 100,
+		Count:  int(agg.Count),
 	}
-
-	return math.Round(numerator/denominator*1000) / 1000
 }
 
 // handleStats 获取统计数据
@@ -331,13 +814,23 @@ func handleStats(w http.ResponseWriter, r *http.Request) {
 
 	startTime := time.Now().Add(-time.Duration(hours) * time.Hour)
 
-	var records []SensorData
-	if err := db.Where("created_at >= ?", startTime).Order("created_at asc").Find(&records).Error; err != nil {
+	// 按窗口合并各粒度的聚合值, 中位数由合并后的分位数草图估算
+	total := newRollupAgg(true)
+	err := store.WindowAgg(startTime, rollupDay, true, func(ts time.Time, agg *rollupAgg) {
+		total.Merge(agg)
+	})
+	if err != nil {
 		http.Error(w, "获取数据失败", http.StatusInternalServerError)
 		return
 	}
 
-	if len(records) == 0 {
+	latest, found, err := latestSince(startTime)
+	if err != nil {
+		http.Error(w, "获取数据失败", http.StatusInternalServerError)
+		return
+	}
+
+	if total.Count == 0 || !found {
 		w.Header().Set("Content-Type", "application/json")
 		json.NewEncoder(w).Encode(map[string]any{
 			"message": "暂无数据",
@@ -346,23 +839,13 @@ func handleStats(w http.ResponseWriter, r *http.Request) {
 		return
 	}
 
-	// 提取各项数据
-	particles, pm25s, hchos, co2s := make([]float64, len(records)), make([]float64, len(records)), make([]float64, len(records)), make([]float64, len(records))
-	temps, humidities, vocs := make([]float64, len(records)), make([]float64, len(records)), make([]float64, len(records))
-
-	for i, r := range records {
-		particles[i] = r.Particle
-		pm25s[i] = r.PM25
-		hchos[i] = r.HCHO
-		co2s[i] = r.CO2
-		temps[i] = r.Temperature
-		humidities[i] = r.Humidity
-		vocs[i] = r.VOC
+	stats := make(map[string]StatsResult, metricCount)
+	for i, name := range rollupMetrics {
+		stats[name] = calculateStats(total, i)
 	}
 
 	// 异常检测：检查是否超过阈值
 	anomalies := []map[string]any{}
-	latest := records[len(records)-1]
 
 	if latest.PM25 > 75 {
 		anomalies = append(anomalies, map[string]any{"type": "pm25", "value": latest.PM25, "threshold": 75, "level": "warning", "message": "PM2.5 超标"})
@@ -392,22 +875,46 @@ func handleStats(w http.ResponseWriter, r *http.Request) {
 	w.Header().Set("Content-Type", "application/json")
 	json.NewEncoder(w).Encode(map[string]any{
 		"hours":      hours,
-		"count":      len(records),
+		"count":      total.Count,
 		"start_time": startTime,
 		"end_time":   time.Now(),
-		"stats": map[string]StatsResult{
-			"particle":    calculateStats(particles),
-			"pm25":        calculateStats(pm25s),
-			"hcho":        calculateStats(hchos),
-			"co2":         calculateStats(co2s),
-			"temperature": calculateStats(temps),
-			"humidity":    calculateStats(humidities),
-			"voc":         calculateStats(vocs),
-		},
-		"anomalies": anomalies,
+		"stats":      stats,
+		"anomalies":  anomalies,
 	})
 }
 
+// hourlySum 某个时段（UTC 小时, 与小时聚合桶的边界一致）的测量值之和
+type hourlySum struct {
+	count int64
+	sum   [metricCount]float64
+}
+
+// means 各测量值的平均值（保留两位小数）
+func (h *hourlySum) means() [metricCount]float64 {
+	var mean [metricCount]float64
+	for i := range mean {
+		mean[i] = math.Round(h.sum[i]/float64(h.count)*100) / 100
+	}
+	return mean
+}
+
+// analysisKernel 分析接口的单遍累加器: 全部状态都在定长数组中, 遍历过程中不分配内存
+type analysisKernel struct {
+	total  rollupAgg
+	hourly [24]hourlySum
+}
+
+// add 计入一个原始记录或聚合桶（WindowAgg 回调）
+func (k *analysisKernel) add(ts time.Time, agg *rollupAgg) {
+	k.total.Merge(agg)
+	h := &k.hourly[ts.UTC().Hour()]
+	h.count += agg.Count
+	n := float64(agg.Count)
+	for i, mean := range agg.Mean {
+		h.sum[i] += mean * n
+	}
+}
+
 // handleAnalysis 获取分析数据
 func handleAnalysis(w http.ResponseWriter, r *http.Request) {
 	if r.Method != http.MethodGet {
@@ -424,90 +931,71 @@ func handleAnalysis(w http.ResponseWriter, r *http.Request) {
 
 	startTime := time.Now().Add(-time.Duration(hours) * time.Hour)
 
-	var records []SensorData
-	if err := db.Where("created_at >= ?", startTime).Order("created_at asc").Find(&records).Error; err != nil {
+	// 一遍遍历窗口内的聚合桶, 同时累加总体矩（相关系数）与各时段的和（小时趋势）
+	var kernel analysisKernel
+	err := store.WindowAgg(startTime, rollupHour, false, kernel.add)
+	if err != nil {
+		http.Error(w, "获取数据失败", http.StatusInternalServerError)
+		return
+	}
+
+	latest, found, err := latestSince(startTime)
+	if err != nil {
 		http.Error(w, "获取数据失败", http.StatusInternalServerError)
 		return
 	}
 
-	if len(records) == 0 {
+	if kernel.total.Count == 0 || !found {
 		w.Header().Set("Content-Type", "application/json")
 		json.NewEncoder(w).Encode(map[string]any{"message": "暂无数据"})
 		return
 	}
 
-	// 提取数据用于相关性分析
-	temps, humidities := make([]float64, len(records)), make([]float64, len(records))
-	pm25s, hchos, vocs, co2s := make([]float64, len(records)), make([]float64, len(records)), make([]float64, len(records)), make([]float64, len(records))
-
-	for i, r := range records {
-		temps[i] = r.Temperature
-		humidities[i] = r.Humidity
-		pm25s[i] = r.PM25
-		hchos[i] = r.HCHO
-		vocs[i] = r.VOC
-		co2s[i] = r.CO2
-	}
-
 	// 计算相关性
+	total := &kernel.total
 	correlations := map[string]float64{
-		"temp_hcho":     calculateCorrelation(temps, hchos),
-		"humidity_hcho": calculateCorrelation(humidities, hchos),
-		"temp_voc":      calculateCorrelation(temps, vocs),
-		"humidity_voc":  calculateCorrelation(humidities, vocs),
-		"pm25_particle": calculateCorrelation(pm25s, make([]float64, len(records))), // 需要particles
-	}
-
-	// 按小时聚合趋势数据
-	hourlyData := make(map[int][]SensorData)
-	for _, record := range records {
-		hour := record.CreatedAt.Hour()
-		hourlyData[hour] = append(hourlyData[hour], record)
-	}
-
-	// 计算每小时平均值
-	hourlyAvg := make([]map[string]any, 0)
-	for hour := 0; hour < 24; hour++ {
-		if data, ok := hourlyData[hour]; ok && len(data) > 0 {
-			avgPM25, avgCO2, avgHCHO, avgVOC, avgTemp, avgHumidity := 0.0, 0.0, 0.0, 0.0, 0.0, 0.0
-			for _, d := range data {
-				avgPM25 += d.PM25
-				avgCO2 += d.CO2
-				avgHCHO += d.HCHO
-				avgVOC += d.VOC
-				avgTemp += d.Temperature
-				avgHumidity += d.Humidity
-			}
-			n := float64(len(data))
-			hourlyAvg = append(hourlyAvg, map[string]any{
-				"hour":        hour,
-				"pm25":        math.Round(avgPM25/n*100) / 100,
-				"co2":         math.Round(avgCO2/n*100) / 100,
-				"hcho":        math.Round(avgHCHO/n*100) / 100,
-				"voc":         math.Round(avgVOC/n*100) / 100,
-				"temperature": math.Round(avgTemp/n*100) / 100,
-				"humidity":    math.Round(avgHumidity/n*100) / 100,
-				"count":       len(data),
-			})
+		"temp_hcho":     total.Correlation(metricTemperature, metricHCHO),
+		"humidity_hcho": total.Correlation(metricHumidity, metricHCHO),
+		"temp_voc":      total.Correlation(metricTemperature, metricVOC),
+		"humidity_voc":  total.Correlation(metricHumidity, metricVOC),
+		"pm25_particle": total.Correlation(metricPM25, metricParticle),
+	}
+	correlationMatrix := make(map[string]float64, pairCount)
+	for i := 0; i < metricCount; i++ {
+		for j := i + 1; j < metricCount; j++ {
+			correlationMatrix[rollupMetrics[i]+"_"+rollupMetrics[j]] = total.Correlation(i, j)
 		}
 	}
 
-	// 找出峰值时段
+	// 每小时平均值与峰值时段
+	hourlyAvg := make([]map[string]any, 0, 24)
 	var peakPM25Hour, peakCO2Hour int
 	var maxPM25, maxCO2 float64
-	for _, avg := range hourlyAvg {
-		if pm25 := avg["pm25"].(float64); pm25 > maxPM25 {
-			maxPM25 = pm25
-			peakPM25Hour = avg["hour"].(int)
+	for hour := 0; hour < 24; hour++ {
+		h := &kernel.hourly[hour]
+		if h.count == 0 {
+			continue
+		}
+		mean := h.means()
+		hourlyAvg = append(hourlyAvg, map[string]any{
+			"hour":        hour,
+			"pm25":        mean[metricPM25],
+			"co2":         mean[metricCO2],
+			"hcho":        mean[metricHCHO],
+			"voc":         mean[metricVOC],
+			"temperature": mean[metricTemperature],
+			"humidity":    mean[metricHumidity],
+			"count":       h.count,
+		})
+		if mean[metricPM25] > maxPM25 {
+			maxPM25, peakPM25Hour = mean[metricPM25], hour
 		}
-		if co2 := avg["co2"].(float64); co2 > maxCO2 {
-			maxCO2 = co2
-			peakCO2Hour = avg["hour"].(int)
+		if mean[metricCO2] > maxCO2 {
+			maxCO2, peakCO2Hour = mean[metricCO2], hour
 		}
 	}
 
 	// 环境建议
-	latest := records[len(records)-1]
 	suggestions := generateSuggestions(latest)
 
 	// AQI 计算 (简化版)
@@ -515,9 +1003,10 @@ func handleAnalysis(w http.ResponseWriter, r *http.Request) {
 
 	w.Header().Set("Content-Type", "application/json")
 	json.NewEncoder(w).Encode(map[string]any{
-		"hours":        hours,
-		"correlations": correlations,
-		"hourly_trend": hourlyAvg,
+		"hours":              hours,
+		"correlations":       correlations,
+		"correlation_matrix": correlationMatrix,
+		"hourly_trend":       hourlyAvg,
 		"peak_hours": map[string]any{
 			"pm25": map[string]any{"hour": peakPM25Hour, "value": maxPM25},
 			"co2":  map[string]any{"hour": peakCO2Hour, "value": maxCO2},
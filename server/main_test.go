@@ -0,0 +1,158 @@
+package main
+
+import (
+	"math"
+	"math/rand"
+	"path/filepath"
+	"testing"
+	"time"
+)
+
+// openTestStore 在 dir 中创建数据库并初始化全局 store 与热数据缓存（不启用列存）
+func openTestStore(tb testing.TB, dir string) {
+	tb.Helper()
+	tb.Setenv("DB_PATH", filepath.Join(dir, "sensor.db"))
+	tb.Setenv("COLUMNAR_PATH", "")
+	tb.Setenv("HOT_WINDOW_ROWS", "1000")
+	if err := initDB(); err != nil {
+		tb.Fatal(err)
+	}
+	s := store
+	tb.Cleanup(func() { s.sqlDB.Close() })
+	hot = newHotWindow()
+	if err := hot.load(); err != nil {
+		tb.Fatal(err)
+	}
+}
+
+// syntheticRecords 生成从 start 起每隔 interval 一条、序号从 seq 开始的 n 条模拟记录:
+// 测量值为日周期曲线加固定种子的随机噪声, 各测量值之间有一定相关性
+func syntheticRecords(start time.Time, interval time.Duration, n int, seq int64) []SensorData {
+	rng := rand.New(rand.NewSource(seq))
+	records := make([]SensorData, n)
+	for i := range records {
+		ts := start.Add(time.Duration(i) * interval)
+		day := math.Sin(2 * math.Pi * float64(ts.Unix()%86400) / 86400)
+		temp := 24 + 4*day + rng.NormFloat64()
+		records[i] = SensorData{
+			CreatedAt:   ts,
+			CapturedAt:  ts,
+			Particle:    math.Round(1000 + 300*day + 100*rng.Float64()),
+			PM25:        math.Round((35+15*day+5*rng.NormFloat64())*100) / 100,
+			HCHO:        math.Round((30+2*temp+5*rng.NormFloat64())*100) / 100,
+			CO2:         math.Round(600 + 200*day + 50*rng.Float64()),
+			Temperature: math.Round(temp*100) / 100,
+			Humidity:    math.Round((50-5*day+3*rng.NormFloat64())*100) / 100,
+			VOC:         math.Round(300 + 4*temp + 20*rng.Float64()),
+			SequenceNum: seq + int64(i),
+			IsValid:     true,
+			DeviceID:    "bench",
+			Flags:       flagSeqTracked,
+		}
+	}
+	return records
+}
+
+// kernelInputs 将记录转换为分析内核的两种输入: 逐条（窗口未对齐部分）与分钟聚合桶
+func kernelInputs(records []SensorData) (rows [][metricCount]float64, minutes map[int64]*rollupAgg) {
+	rows = make([][metricCount]float64, len(records))
+	minutes = make(map[int64]*rollupAgg)
+	for i := range records {
+		rows[i] = records[i].metricValues()
+		bucket := records[i].CapturedAt.Unix() / 60 * 60
+		if minutes[bucket] == nil {
+			minutes[bucket] = newRollupAgg(false)
+		}
+		minutes[bucket].Add(&rows[i])
+	}
+	return rows, minutes
+}
+
+func TestAnalysisKernel(t *testing.T) {
+	// 从 UTC 零点前半小时开始, 每 10 秒一条, 共 25 小时
+	start := time.Date(2024, 3, 1, 23, 30, 0, 0, time.UTC)
+	records := syntheticRecords(start, 10*time.Second, 25*360, 1)
+	rows, minutes := kernelInputs(records)
+	_, m2, c2 := twoPassAgg(rows)
+
+	var raw, bucketed analysisKernel
+	agg := newRollupAgg(false)
+	for i := range rows {
+		agg.Reset()
+		agg.Add(&rows[i])
+		raw.add(records[i].CapturedAt, agg)
+	}
+	for bucket, m := range minutes {
+		bucketed.add(time.Unix(bucket, 0), m)
+	}
+
+	var hourly [24]hourlySum
+	for i := range rows {
+		h := &hourly[records[i].CapturedAt.UTC().Hour()]
+		h.count++
+		for m, v := range rows[i] {
+			h.sum[m] += v
+		}
+	}
+
+	for name, k := range map[string]*analysisKernel{"逐条": &raw, "分钟桶": &bucketed} {
+		p := 0
+		for i := 0; i < metricCount; i++ {
+			for j := i + 1; j < metricCount; j++ {
+				// Correlation 保留三位小数, 累加顺序不同时舍入结果可能相差一位
+				want := c2[p] / math.Sqrt(m2[i]*m2[j])
+				if got := k.total.Correlation(i, j); math.Abs(got-want) > 0.0006 {
+					t.Errorf("%s: 相关系数 (%d, %d) = %g, 期望 %g", name, i, j, got, want)
+				}
+				p++
+			}
+		}
+		for hour := range hourly {
+			got, want := &k.hourly[hour], &hourly[hour]
+			if got.count != want.count {
+				t.Errorf("%s: %d 时 %d 条, 期望 %d 条", name, hour, got.count, want.count)
+			}
+			for m := range want.sum {
+				if !closeTo(got.sum[m], want.sum[m]) {
+					t.Errorf("%s: %d 时测量值 %d 之和 %g, 期望 %g", name, hour, m, got.sum[m], want.sum[m])
+				}
+			}
+		}
+	}
+}
+
+// BenchmarkAnalysisKernel 100 万条记录（每秒一条）经过分析内核: 逐条累加与按分钟聚合桶累加
+func BenchmarkAnalysisKernel(b *testing.B) {
+	const n = 1000000
+	start := time.Date(2024, 1, 1, 0, 0, 0, 0, time.UTC)
+	records := syntheticRecords(start, time.Second, n, 0)
+	rows, minutes := kernelInputs(records)
+	buckets := make([]int64, 0, len(minutes))
+	for bucket := range minutes {
+		buckets = append(buckets, bucket)
+	}
+
+	b.Run("rows", func(b *testing.B) {
+		b.ReportAllocs()
+		agg := newRollupAgg(false)
+		for i := 0; i < b.N; i++ {
+			var k analysisKernel
+			for r := range rows {
+				agg.Reset()
+				agg.Add(&rows[r])
+				k.add(records[r].CapturedAt, agg)
+			}
+		}
+		b.ReportMetric(float64(n*b.N)/b.Elapsed().Seconds(), "rows/s")
+	})
+	b.Run("minutes", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			var k analysisKernel
+			for _, bucket := range buckets {
+				k.add(time.Unix(bucket, 0), minutes[bucket])
+			}
+		}
+		b.ReportMetric(float64(n*b.N)/b.Elapsed().Seconds(), "rows/s")
+	})
+}
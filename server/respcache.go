@@ -0,0 +1,198 @@
+package main
+
+import (
+	"bytes"
+	"compress/gzip"
+	"fmt"
+	"hash/fnv"
+	"net/http"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+const (
+	// responseCacheTTL 数据未变化时缓存的最长时间（时间窗口随当前时间滑动, 不能无限期复用）
+	responseCacheTTL = 30 * time.Second
+	// responseCacheMaxEntries 缓存的最大条目数, 超过后清空
+	responseCacheMaxEntries = 256
+	// responseGzipMinSize 小于该大小的响应不压缩
+	responseGzipMinSize = 1024
+)
+
+// dataVersion 数据版本号: 每次写入新数据后递增, 用于使缓存的响应失效
+var dataVersion int64
+
+// bumpDataVersion 数据发生变化后调用
+func bumpDataVersion() {
+	atomic.AddInt64(&dataVersion, 1)
+}
+
+// cachedResponse 缓存的响应: 原始内容与预先压缩的内容
+type cachedResponse struct {
+	version     int64
+	created     time.Time
+	etag        string
+	contentType string
+	body        []byte
+	gzipBody    []byte // 为 nil 时不压缩
+}
+
+// responseCacheMetrics 响应缓存统计
+type responseCacheMetrics struct {
+	Hits        int64
+	Misses      int64
+	NotModified int64
+}
+
+// responseCache 分析类接口的响应缓存: 以路径 + 查询参数为键, 数据版本变化或超时后重新计算,
+// 命中时直接返回预先压缩的内容, 客户端带 If-None-Match 且内容未变时返回 304
+type responseCache struct {
+	mu      sync.RWMutex
+	entries map[string]*cachedResponse
+	stats   responseCacheMetrics
+}
+
+var respCache = &responseCache{entries: make(map[string]*cachedResponse)}
+
+// bufferedResponse 记录处理函数的输出
+type bufferedResponse struct {
+	header http.Header
+	status int
+	body   bytes.Buffer
+}
+
+func (b *bufferedResponse) Header() http.Header { return b.header }
+
+func (b *bufferedResponse) WriteHeader(status int) {
+	if b.status == 0 {
+		b.status = status
+	}
+}
+
+func (b *bufferedResponse) Write(p []byte) (int, error) {
+	if b.status == 0 {
+		b.status = http.StatusOK
+	}
+	return b.body.Write(p)
+}
+
+// cached 为 GET 处理函数加上响应缓存, 只缓存 200 响应
+func (c *responseCache) cached(next http.HandlerFunc) http.HandlerFunc {
+	return func(w http.ResponseWriter, r *http.Request) {
+		if r.Method != http.MethodGet {
+			next(w, r)
+			return
+		}
+
+		key := r.URL.Path + "?" + r.URL.Query().Encode()
+		version := atomic.LoadInt64(&dataVersion)
+
+		c.mu.RLock()
+		entry := c.entries[key]
+		c.mu.RUnlock()
+
+		if entry != nil && entry.version == version && time.Since(entry.created) < responseCacheTTL {
+			atomic.AddInt64(&c.stats.Hits, 1)
+		} else {
+			atomic.AddInt64(&c.stats.Misses, 1)
+			buf := &bufferedResponse{header: make(http.Header)}
+			next(buf, r)
+			if buf.status != http.StatusOK {
+				for k, v := range buf.header {
+					w.Header()[k] = v
+				}
+				w.WriteHeader(buf.status)
+				w.Write(buf.body.Bytes())
+				return
+			}
+			entry = newCachedResponse(version, buf)
+			c.store(key, entry)
+		}
+
+		c.serve(w, r, entry)
+	}
+}
+
+// newCachedResponse 根据处理结果生成缓存条目, 计算 ETag 并预先压缩
+func newCachedResponse(version int64, buf *bufferedResponse) *cachedResponse {
+	body := buf.body.Bytes()
+	h := fnv.New64a()
+	h.Write(body)
+	entry := &cachedResponse{
+		version:     version,
+		created:     time.Now(),
+		etag:        fmt.Sprintf(`"%x"`, h.Sum64()),
+		contentType: buf.header.Get("Content-Type"),
+		body:        body,
+	}
+	if len(body) >= responseGzipMinSize {
+		var gz bytes.Buffer
+		zw, _ := gzip.NewWriterLevel(&gz, gzip.BestCompression)
+		zw.Write(body)
+		if zw.Close() == nil {
+			entry.gzipBody = gz.Bytes()
+		}
+	}
+	return entry
+}
+
+// store 写入缓存条目
+func (c *responseCache) store(key string, entry *cachedResponse) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if len(c.entries) >= responseCacheMaxEntries {
+		c.entries = make(map[string]*cachedResponse)
+	}
+	c.entries[key] = entry
+}
+
+// serve 输出缓存的响应
+func (c *responseCache) serve(w http.ResponseWriter, r *http.Request, entry *cachedResponse) {
+	header := w.Header()
+	header.Set("ETag", entry.etag)
+	header.Set("Cache-Control", "no-cache")
+	header.Set("Vary", "Accept-Encoding")
+
+	if etagMatch(r.Header.Get("If-None-Match"), entry.etag) {
+		atomic.AddInt64(&c.stats.NotModified, 1)
+		w.WriteHeader(http.StatusNotModified)
+		return
+	}
+
+	if entry.contentType != "" {
+		header.Set("Content-Type", entry.contentType)
+	}
+	if entry.gzipBody != nil && strings.Contains(r.Header.Get("Accept-Encoding"), "gzip") {
+		header.Set("Content-Encoding", "gzip")
+		w.Write(entry.gzipBody)
+		return
+	}
+	w.Write(entry.body)
+}
+
+// etagMatch 判断 If-None-Match 是否包含 etag
+func etagMatch(ifNoneMatch, etag string) bool {
+	for _, tag := range strings.Split(ifNoneMatch, ",") {
+		tag = strings.TrimSpace(tag)
+		if tag == "*" || strings.TrimPrefix(tag, "W/") == etag {
+			return true
+		}
+	}
+	return false
+}
+
+// Metrics 获取响应缓存统计
+func (c *responseCache) Metrics() map[string]any {
+	c.mu.RLock()
+	entries := len(c.entries)
+	c.mu.RUnlock()
+	return map[string]any{
+		"entries":      entries,
+		"hits":         atomic.LoadInt64(&c.stats.Hits),
+		"misses":       atomic.LoadInt64(&c.stats.Misses),
+		"not_modified": atomic.LoadInt64(&c.stats.NotModified),
+		"data_version": atomic.LoadInt64(&dataVersion),
+	}
+}
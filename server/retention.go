@@ -0,0 +1,239 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"fmt"
+	"log"
+	"sync/atomic"
+	"time"
+)
+
+// 数据保留策略, 通过环境变量配置（0 表示永久保留）:
+// RETENTION_RAW_DAYS 原始记录（及设备汇总台账）保留天数, 之后只保留聚合值;
+// RETENTION_MINUTE_DAYS 分钟聚合保留天数, 之后只保留小时、天聚合;
+// RETENTION_INTERVAL_MIN 清理间隔(分钟)
+const (
+	defaultRetentionIntervalMin = 60
+	retentionDeleteBatch        = 5000                  // 每个删除事务的行数
+	retentionPause              = 50 * time.Millisecond // 两批删除之间的间隔, 让出写锁
+	vacuumSlicePages            = 256                   // 每次增量回收的页数
+)
+
+// retentionMetrics 数据保留统计
+type retentionMetrics struct {
+	DeletedRaw       int64 // 已删除的原始记录数
+	DeletedRollups   int64 // 已删除的分钟聚合桶数
+	DeletedSummaries int64 // 已删除的设备汇总台账行数
+	ReclaimedBytes   int64 // 增量回收释放的字节数
+	Runs             int64 // 清理次数
+	LastRunUnix      int64 // 最近一次清理时间
+	LastRunMillis    int64 // 最近一次清理耗时(毫秒)
+	FreelistPages    int64 // 清理后仍未回收的空闲页数
+	DroppedColumnar  int64 // 已删除的列存分区数
+}
+
+// retentionPolicy 后台数据保留: 分批删除过期的原始记录与分钟聚合, 再小批量增量回收空间
+type retentionPolicy struct {
+	rawDays    int
+	minuteDays int
+	interval   time.Duration
+	stats      retentionMetrics
+}
+
+var retention *retentionPolicy
+
+// newRetentionPolicy 读取保留策略配置, 未配置任何保留期时返回 nil
+func newRetentionPolicy() *retentionPolicy {
+	p := &retentionPolicy{
+		rawDays:    envNonNegInt("RETENTION_RAW_DAYS", 0),
+		minuteDays: envNonNegInt("RETENTION_MINUTE_DAYS", 0),
+		interval:   time.Duration(envInt("RETENTION_INTERVAL_MIN", defaultRetentionIntervalMin)) * time.Minute,
+	}
+	if p.rawDays == 0 && p.minuteDays == 0 {
+		return nil
+	}
+	return p
+}
+
+// enableIncrementalVacuum 将数据库切换为增量回收模式（auto_vacuum=INCREMENTAL）
+//
+// 已有数据库需要一次完整的 VACUUM 才能切换, 只在首次启用保留策略时执行一次
+func enableIncrementalVacuum(sqlDB *sql.DB) error {
+	ctx := context.Background()
+	conn, err := sqlDB.Conn(ctx)
+	if err != nil {
+		return err
+	}
+	defer conn.Close()
+
+	var mode int
+	if err := conn.QueryRowContext(ctx, "PRAGMA auto_vacuum").Scan(&mode); err != nil {
+		return err
+	}
+	if mode == 2 {
+		return nil
+	}
+
+	log.Println("切换数据库为增量回收模式, 执行一次完整 VACUUM")
+	start := time.Now()
+	if _, err := conn.ExecContext(ctx, "PRAGMA auto_vacuum = INCREMENTAL"); err != nil {
+		return err
+	}
+	if _, err := conn.ExecContext(ctx, "VACUUM"); err != nil {
+		return err
+	}
+	log.Printf("VACUUM 完成, 耗时 %v\n", time.Since(start))
+	return nil
+}
+
+// Run 后台定期清理, ctx 取消后退出
+func (p *retentionPolicy) Run(ctx context.Context) {
+	log.Printf("数据保留: 原始记录 %d 天, 分钟聚合 %d 天, 每 %v 清理一次\n", p.rawDays, p.minuteDays, p.interval)
+	ticker := time.NewTicker(p.interval)
+	defer ticker.Stop()
+	for {
+		if err := p.runOnce(ctx); err != nil && ctx.Err() == nil {
+			log.Printf("数据保留清理失败: %v\n", err)
+		}
+		select {
+		case <-ctx.Done():
+			return
+		case <-ticker.C:
+		}
+	}
+}
+
+// runOnce 执行一次清理
+func (p *retentionPolicy) runOnce(ctx context.Context) error {
+	start := time.Now()
+	changed := false
+
+	if p.rawDays > 0 {
+		cutoff := start.AddDate(0, 0, -p.rawDays)
+		n, err := p.deleteBatches(ctx, &p.stats.DeletedRaw,
+			"DELETE FROM sensor_data WHERE id IN (SELECT id FROM sensor_data WHERE captured_at < ? ORDER BY captured_at LIMIT ?)", cutoff)
+		if err != nil {
+			return err
+		}
+		changed = changed || n > 0
+		// 汇总台账与原始记录同期清理（其聚合值保留）
+		if _, err := p.deleteBatches(ctx, &p.stats.DeletedSummaries,
+			"DELETE FROM sensor_summaries WHERE id IN (SELECT id FROM sensor_summaries WHERE captured_at < ? ORDER BY captured_at LIMIT ?)", cutoff); err != nil {
+			return err
+		}
+		if columns != nil {
+			dropped, err := columns.DropBefore(cutoff)
+			if err != nil {
+				return err
+			}
+			atomic.AddInt64(&p.stats.DroppedColumnar, int64(dropped))
+		}
+	}
+
+	if p.minuteDays > 0 {
+		cutoff := start.AddDate(0, 0, -p.minuteDays).Unix()
+		n, err := p.deleteBatches(ctx, &p.stats.DeletedRollups,
+			"DELETE FROM sensor_rollups WHERE level = 1 AND bucket IN (SELECT bucket FROM sensor_rollups WHERE level = 1 AND bucket < ? ORDER BY bucket LIMIT ?)", cutoff)
+		if err != nil {
+			return err
+		}
+		changed = changed || n > 0
+	}
+
+	if changed {
+		bumpDataVersion()
+	}
+	if err := p.vacuum(ctx); err != nil {
+		return err
+	}
+
+	atomic.AddInt64(&p.stats.Runs, 1)
+	atomic.StoreInt64(&p.stats.LastRunUnix, start.Unix())
+	atomic.StoreInt64(&p.stats.LastRunMillis, time.Since(start).Milliseconds())
+	return nil
+}
+
+// deleteBatches 分批执行删除语句直到没有可删除的行, 每批一个事务, 批间暂停以免长时间阻塞写入
+func (p *retentionPolicy) deleteBatches(ctx context.Context, counter *int64, query string, cutoff any) (int64, error) {
+	var total int64
+	for {
+		res, err := store.sqlDB.ExecContext(ctx, query, cutoff, retentionDeleteBatch)
+		if err != nil {
+			return total, err
+		}
+		n, err := res.RowsAffected()
+		if err != nil {
+			return total, err
+		}
+		total += n
+		atomic.AddInt64(counter, n)
+		if n < retentionDeleteBatch {
+			return total, nil
+		}
+		select {
+		case <-ctx.Done():
+			return total, ctx.Err()
+		case <-time.After(retentionPause):
+		}
+	}
+}
+
+// vacuum 小批量增量回收空闲页, 每批之间暂停
+func (p *retentionPolicy) vacuum(ctx context.Context) error {
+	var pageSize int64
+	if err := store.sqlDB.QueryRowContext(ctx, "PRAGMA page_size").Scan(&pageSize); err != nil {
+		return err
+	}
+	freelist := func() (int64, error) {
+		var n int64
+		err := store.sqlDB.QueryRowContext(ctx, "PRAGMA freelist_count").Scan(&n)
+		return n, err
+	}
+
+	before, err := freelist()
+	if err != nil {
+		return err
+	}
+	for before > 0 {
+		if _, err := store.sqlDB.ExecContext(ctx, fmt.Sprintf("PRAGMA incremental_vacuum(%d)", vacuumSlicePages)); err != nil {
+			return err
+		}
+		after, err := freelist()
+		if err != nil {
+			return err
+		}
+		if after >= before {
+			// 未启用增量回收模式
+			break
+		}
+		atomic.AddInt64(&p.stats.ReclaimedBytes, (before-after)*pageSize)
+		before = after
+
+		select {
+		case <-ctx.Done():
+			return ctx.Err()
+		case <-time.After(retentionPause):
+		}
+	}
+	atomic.StoreInt64(&p.stats.FreelistPages, before)
+	return nil
+}
+
+// Metrics 获取数据保留统计
+func (p *retentionPolicy) Metrics() map[string]any {
+	return map[string]any{
+		"raw_days":          p.rawDays,
+		"minute_days":       p.minuteDays,
+		"interval_min":      p.interval.Minutes(),
+		"deleted_raw":       atomic.LoadInt64(&p.stats.DeletedRaw),
+		"deleted_rollups":   atomic.LoadInt64(&p.stats.DeletedRollups),
+		"deleted_summaries": atomic.LoadInt64(&p.stats.DeletedSummaries),
+		"dropped_columnar":  atomic.LoadInt64(&p.stats.DroppedColumnar),
+		"reclaimed_bytes":   atomic.LoadInt64(&p.stats.ReclaimedBytes),
+		"freelist_pages":    atomic.LoadInt64(&p.stats.FreelistPages),
+		"runs":              atomic.LoadInt64(&p.stats.Runs),
+		"last_run":          atomic.LoadInt64(&p.stats.LastRunUnix),
+		"last_run_ms":       atomic.LoadInt64(&p.stats.LastRunMillis),
+	}
+}
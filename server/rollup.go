@@ -0,0 +1,581 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"log"
+	"math"
+	"strings"
+	"time"
+)
+
+// 参与聚合的测量值（与 SensorData 中 V1~V7 的顺序一致）
+var rollupMetrics = [metricCount]string{"particle", "pm25", "hcho", "co2", "temperature", "humidity", "voc"}
+
+// 指标下标
+const (
+	metricParticle = iota
+	metricPM25
+	metricHCHO
+	metricCO2
+	metricTemperature
+	metricHumidity
+	metricVOC
+)
+
+const (
+	metricCount = 7
+	// pairCount 两两组合数, 用于计算相关系数
+	pairCount = metricCount * (metricCount - 1) / 2
+)
+
+// 聚合粒度
+const (
+	rollupMinute = 1
+	rollupHour   = 2
+	rollupDay    = 3
+)
+
+// rollupLevels 各聚合粒度的桶宽度(秒), 桶按 UTC 对齐
+var rollupLevels = []struct {
+	level   int
+	seconds int64
+}{
+	{rollupMinute, 60},
+	{rollupHour, 3600},
+	{rollupDay, 86400},
+}
+
+// rollupBackfillChunk 回填时每个事务处理的原始记录数
+const rollupBackfillChunk = 100000
+
+// metricValues 按 rollupMetrics 顺序取出测量值
+func (d *SensorData) metricValues() [metricCount]float64 {
+	return [metricCount]float64{d.Particle, d.PM25, d.HCHO, d.CO2, d.Temperature, d.Humidity, d.VOC}
+}
+
+// pairIndex 测量值 i, j (i < j) 在两两组合中的下标
+func pairIndex(i, j int) int {
+	return i*(2*metricCount-i-1)/2 + (j - i - 1)
+}
+
+// rollupAgg 可合并的聚合值: 计数、均值与离差平方和（Welford 算法）、最值、两两协离差和及分位数草图
+//
+// Sketch 为 nil 的测量值不统计分位数, 合并时也忽略对方的草图
+type rollupAgg struct {
+	Count  int64
+	Mean   [metricCount]float64
+	M2     [metricCount]float64
+	Min    [metricCount]float64
+	Max    [metricCount]float64
+	C2     [pairCount]float64
+	Sketch [metricCount]*quantileSketch
+}
+
+// newRollupAgg 创建聚合值, withSketch 为 true 时统计分位数
+func newRollupAgg(withSketch bool) *rollupAgg {
+	a := &rollupAgg{}
+	if withSketch {
+		for i := range a.Sketch {
+			a.Sketch[i] = newQuantileSketch()
+		}
+	}
+	return a
+}
+
+// Reset 清空聚合值, 保留草图的内存
+func (a *rollupAgg) Reset() {
+	sketches := a.Sketch
+	*a = rollupAgg{Sketch: sketches}
+	for _, sk := range sketches {
+		if sk != nil {
+			sk.Reset()
+		}
+	}
+}
+
+// Add 加入一条记录（单遍更新均值与离差平方和, 避免大数相减的精度损失）
+func (a *rollupAgg) Add(v *[metricCount]float64) {
+	if a.Count == 0 {
+		a.Min, a.Max = *v, *v
+	}
+	a.Count++
+	n := float64(a.Count)
+
+	var before, after [metricCount]float64
+	for i, x := range v {
+		before[i] = x - a.Mean[i]
+		a.Mean[i] += before[i] / n
+		after[i] = x - a.Mean[i]
+		a.M2[i] += before[i] * after[i]
+		a.Min[i] = math.Min(a.Min[i], x)
+		a.Max[i] = math.Max(a.Max[i], x)
+		if a.Sketch[i] != nil {
+			a.Sketch[i].Add(x)
+		}
+	}
+
+	p := 0
+	for i := 0; i < metricCount; i++ {
+		for j := i + 1; j < metricCount; j++ {
+			a.C2[p] += before[i] * after[j]
+			p++
+		}
+	}
+}
+
+// Merge 合并另一个聚合值（Chan 并行合并公式）
+func (a *rollupAgg) Merge(b *rollupAgg) {
+	if b.Count == 0 {
+		return
+	}
+	for i := range a.Sketch {
+		if a.Sketch[i] != nil && b.Sketch[i] != nil {
+			a.Sketch[i].Merge(b.Sketch[i])
+		}
+	}
+	if a.Count == 0 {
+		a.Count, a.Mean, a.M2, a.Min, a.Max, a.C2 = b.Count, b.Mean, b.M2, b.Min, b.Max, b.C2
+		return
+	}
+
+	na, nb := float64(a.Count), float64(b.Count)
+	n := na + nb
+	var delta [metricCount]float64
+	for i := 0; i < metricCount; i++ {
+		delta[i] = b.Mean[i] - a.Mean[i]
+		a.Mean[i] += delta[i] * nb / n
+		a.M2[i] += b.M2[i] + delta[i]*delta[i]*na*nb/n
+		a.Min[i] = math.Min(a.Min[i], b.Min[i])
+		a.Max[i] = math.Max(a.Max[i], b.Max[i])
+	}
+	p := 0
+	for i := 0; i < metricCount; i++ {
+		for j := i + 1; j < metricCount; j++ {
+			a.C2[p] += b.C2[p] + delta[i]*delta[j]*na*nb/n
+			p++
+		}
+	}
+	a.Count += b.Count
+}
+
+// StdDev 测量值 i 的总体标准差
+func (a *rollupAgg) StdDev(i int) float64 {
+	if a.Count == 0 {
+		return 0
+	}
+	return math.Sqrt(math.Max(a.M2[i], 0) / float64(a.Count))
+}
+
+// Median 测量值 i 的中位数（草图估算, 未统计分位数时返回 0）
+func (a *rollupAgg) Median(i int) float64 {
+	if a.Sketch[i] == nil || a.Count == 0 {
+		return 0
+	}
+	return math.Min(math.Max(a.Sketch[i].Quantile(0.5), a.Min[i]), a.Max[i])
+}
+
+// Correlation 测量值 i, j 的皮尔逊相关系数
+func (a *rollupAgg) Correlation(i, j int) float64 {
+	if i == j || a.Count == 0 {
+		return 0
+	}
+	if i > j {
+		i, j = j, i
+	}
+	denominator := math.Sqrt(a.M2[i] * a.M2[j])
+	if denominator == 0 || math.IsNaN(denominator) {
+		return 0
+	}
+	return math.Round(a.C2[pairIndex(i, j)]/denominator*1000) / 1000
+}
+
+// rollupColumns 聚合表中聚合值的列名（与 rollupAgg.fields 顺序一致）, 草图列在最后
+func rollupColumns(withSketch bool) []string {
+	cols := []string{"count"}
+	for _, prefix := range []string{"mean", "m2", "min", "max"} {
+		for _, m := range rollupMetrics {
+			cols = append(cols, prefix+"_"+m)
+		}
+	}
+	for i := 0; i < metricCount; i++ {
+		for j := i + 1; j < metricCount; j++ {
+			cols = append(cols, "c2_"+rollupMetrics[i]+"_"+rollupMetrics[j])
+		}
+	}
+	if withSketch {
+		for _, m := range rollupMetrics {
+			cols = append(cols, "sketch_"+m)
+		}
+	}
+	return cols
+}
+
+// fields 按 rollupColumns 顺序返回数值字段的指针（用于 Scan）
+func (a *rollupAgg) fields() []any {
+	ptrs := []any{&a.Count}
+	for _, arr := range []*[metricCount]float64{&a.Mean, &a.M2, &a.Min, &a.Max} {
+		for i := range arr {
+			ptrs = append(ptrs, &arr[i])
+		}
+	}
+	for p := range a.C2 {
+		ptrs = append(ptrs, &a.C2[p])
+	}
+	return ptrs
+}
+
+// values 按 rollupColumns(true) 顺序返回各字段的值（用于写入）
+func (a *rollupAgg) values() []any {
+	ptrs := a.fields()
+	vals := make([]any, 0, len(ptrs)+metricCount)
+	for _, p := range ptrs {
+		switch v := p.(type) {
+		case *int64:
+			vals = append(vals, *v)
+		case *float64:
+			vals = append(vals, *v)
+		}
+	}
+	for _, sk := range a.Sketch {
+		vals = append(vals, sk.MarshalBinary())
+	}
+	return vals
+}
+
+// rollupScanner 逐行读取聚合值: 各行复用同一个聚合值（含草图）与扫描目标, 读取下一行后上一行的结果失效
+type rollupScanner struct {
+	bucket int64
+	agg    *rollupAgg
+	blobs  [metricCount]sql.RawBytes
+	dest   []any
+}
+
+// newRollupScanner withSketch 为 true 时查询结果需包含草图列
+func newRollupScanner(withSketch bool) *rollupScanner {
+	s := &rollupScanner{agg: newRollupAgg(withSketch)}
+	s.dest = append([]any{&s.bucket}, s.agg.fields()...)
+	if withSketch {
+		for i := range s.blobs {
+			s.dest = append(s.dest, &s.blobs[i])
+		}
+	}
+	return s
+}
+
+// scan 读取当前行（RawBytes 只能用于 Rows, 不能用于 QueryRow）
+func (s *rollupScanner) scan(rows *sql.Rows) error {
+	if err := rows.Scan(s.dest...); err != nil {
+		return err
+	}
+	for i, sk := range s.agg.Sketch {
+		if sk != nil {
+			if err := sk.UnmarshalBinary(s.blobs[i]); err != nil {
+				return err
+			}
+		}
+	}
+	return nil
+}
+
+// rollupCreateSQL 聚合表: 每个 (粒度, 桶起始时间) 一行
+func rollupCreateSQL() string {
+	defs := []string{"level INTEGER NOT NULL", "bucket INTEGER NOT NULL", "count INTEGER NOT NULL"}
+	for _, c := range rollupColumns(true)[1:] {
+		if strings.HasPrefix(c, "sketch_") {
+			defs = append(defs, c+" BLOB NOT NULL")
+		} else {
+			defs = append(defs, c+" REAL NOT NULL")
+		}
+	}
+	return "CREATE TABLE IF NOT EXISTS sensor_rollups (" + strings.Join(defs, ", ") + ", PRIMARY KEY (level, bucket)) WITHOUT ROWID"
+}
+
+// rollupSelectSQL 查询聚合桶的语句前缀
+func rollupSelectSQL(withSketch bool) string {
+	return "SELECT bucket, " + strings.Join(rollupColumns(withSketch), ", ") + " FROM sensor_rollups"
+}
+
+// rollupReplaceSQL 写入（覆盖）一个桶的聚合值
+func rollupReplaceSQL() string {
+	cols := rollupColumns(true)
+	return "INSERT OR REPLACE INTO sensor_rollups (level, bucket, " + strings.Join(cols, ", ") + ") VALUES (" +
+		strings.TrimSuffix(strings.Repeat("?,", len(cols)+2), ",") + ")"
+}
+
+// migrateRollupTable 聚合表结构与当前版本不一致时删除重建（之后由回填恢复数据）
+func migrateRollupTable(sqlDB *sql.DB) error {
+	var exists bool
+	if err := sqlDB.QueryRow("SELECT EXISTS (SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'sensor_rollups')").Scan(&exists); err != nil {
+		return err
+	}
+	if !exists {
+		return nil
+	}
+	rows, err := sqlDB.Query(rollupSelectSQL(true) + " LIMIT 0")
+	if err == nil {
+		return rows.Close()
+	}
+	log.Println("聚合表结构已变更, 重建聚合表")
+	_, err = sqlDB.Exec("DROP TABLE sensor_rollups")
+	return err
+}
+
+// rollupKey 聚合桶
+type rollupKey struct {
+	level  int
+	bucket int64
+}
+
+// rollupDeltas 按各粒度累加一批记录
+func rollupDeltas(records []SensorData, deltas map[rollupKey]*rollupAgg) {
+	for i := range records {
+		v := records[i].metricValues()
+		ts := records[i].CapturedAt.Unix()
+		for _, l := range rollupLevels {
+			key := rollupKey{l.level, ts - floorMod(ts, l.seconds)}
+			agg, ok := deltas[key]
+			if !ok {
+				agg = newRollupAgg(true)
+				deltas[key] = agg
+			}
+			agg.Add(&v)
+		}
+	}
+}
+
+// floorMod 非负取模
+func floorMod(a, b int64) int64 {
+	m := a % b
+	if m < 0 {
+		m += b
+	}
+	return m
+}
+
+// mergeRollups 在事务中将聚合增量合并进聚合表
+//
+// 草图无法在 SQL 中合并, 因此先读出已有的桶、在内存中合并后整行写回;
+// 聚合表只由写入协程（或停服时的回填）修改, 读改写之间不会有并发写入
+func (s *sensorStore) mergeRollups(tx *sql.Tx, deltas map[rollupKey]*rollupAgg) error {
+	get := tx.Stmt(s.getRollup)
+	put := tx.Stmt(s.putRollup)
+	scanner := newRollupScanner(true)
+	for key, delta := range deltas {
+		agg, err := getRollup(get, scanner, key)
+		if err != nil {
+			return err
+		}
+		if agg == nil {
+			agg = delta
+		} else {
+			agg.Merge(delta)
+		}
+		if _, err := put.Exec(append([]any{key.level, key.bucket}, agg.values()...)...); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// getRollup 读取一个聚合桶, 不存在时返回 nil
+func getRollup(get *sql.Stmt, scanner *rollupScanner, key rollupKey) (*rollupAgg, error) {
+	rows, err := get.Query(key.level, key.bucket)
+	if err != nil {
+		return nil, err
+	}
+	defer rows.Close()
+	if !rows.Next() {
+		return nil, rows.Err()
+	}
+	if err := scanner.scan(rows); err != nil {
+		return nil, err
+	}
+	return scanner.agg, nil
+}
+
+// alignUp 将时间向上对齐到桶边界
+func alignUp(ts, seconds int64) int64 {
+	if m := floorMod(ts, seconds); m != 0 {
+		return ts + seconds - m
+	}
+	return ts
+}
+
+// WindowAgg 按时间窗口读取聚合值: 窗口起点未对齐的部分直接遍历原始记录（及设备汇总）,
+// 其余部分依次使用分钟、小时、天等逐级更粗的聚合桶, 最粗不超过 maxLevel
+//
+// fn 对每个原始记录或聚合桶调用一次, ts 为记录时间或桶起始时间, agg 仅在回调期间有效;
+// withSketch 为 true 时聚合值带有分位数草图
+func (s *sensorStore) WindowAgg(start time.Time, maxLevel int, withSketch bool, fn func(ts time.Time, agg *rollupAgg)) error {
+	startTS := start.Unix()
+	if start.Nanosecond() > 0 {
+		startTS++
+	}
+
+	// 窗口起点到第一个分钟边界之间的原始记录
+	firstMinute := alignUp(startTS, rollupLevels[0].seconds)
+	// 每条记录复用同一个聚合值, 回调不能保留 agg
+	agg := newRollupAgg(withSketch)
+	err := forEachSample(context.Background(), start, time.Unix(firstMinute, 0), allMetricsMask, func(ts time.Time, v *[metricCount]float64) {
+		agg.Reset()
+		agg.Add(v)
+		fn(ts, agg)
+	})
+	if err != nil {
+		return err
+	}
+	// 汇总模式的设备没有原始记录, 这一段取汇总中分摊到该时段的帧
+	if err := forEachSummaryPart(start, time.Unix(firstMinute, 0), fn); err != nil {
+		return err
+	}
+
+	// 各粒度负责从本级边界到上一级边界之间的部分, 最粗一级负责到当前时间
+	for idx, l := range rollupLevels {
+		if l.level > maxLevel {
+			break
+		}
+		from := alignUp(startTS, l.seconds)
+		to := int64(math.MaxInt64)
+		if idx+1 < len(rollupLevels) && rollupLevels[idx+1].level <= maxLevel {
+			to = alignUp(startTS, rollupLevels[idx+1].seconds)
+		}
+		if err := s.scanRollups(l.level, from, to, withSketch, fn); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// scanRollups 读取 [from, to) 内指定粒度的聚合桶
+func (s *sensorStore) scanRollups(level int, from, to int64, withSketch bool, fn func(ts time.Time, agg *rollupAgg)) error {
+	stmt := s.scanRollup
+	if withSketch {
+		stmt = s.scanRollupSketch
+	}
+	rows, err := stmt.Query(level, from, to)
+	if err != nil {
+		return err
+	}
+	defer rows.Close()
+
+	scanner := newRollupScanner(withSketch)
+	for rows.Next() {
+		if err := scanner.scan(rows); err != nil {
+			return err
+		}
+		fn(time.Unix(scanner.bucket, 0), scanner.agg)
+	}
+	return rows.Err()
+}
+
+// backfillRollups 根据原始记录与设备汇总台账重建聚合表（需在服务停止时执行, 否则新数据会被重复计入）, 范围见 backfillFrom
+func backfillRollups() error {
+	start := time.Now()
+	from, err := backfillFrom()
+	if err != nil {
+		return err
+	}
+	if _, err := store.sqlDB.Exec("DELETE FROM sensor_rollups WHERE bucket >= ?", from); err != nil {
+		return err
+	}
+
+	var lastID uint
+	total := 0
+	for {
+		rows, err := store.scanChunk.Query(lastID, rollupBackfillChunk)
+		if err != nil {
+			return err
+		}
+		records, err := scanRecords(rows, rollupBackfillChunk)
+		if err != nil {
+			return err
+		}
+		if len(records) == 0 {
+			break
+		}
+
+		lastID = records[len(records)-1].ID
+		total += len(records)
+
+		// 跳过保留期清理后残缺的第一天（其聚合值保持不变）
+		kept := records[:0]
+		for _, d := range records {
+			if d.CapturedAt.Unix() >= from {
+				kept = append(kept, d)
+			}
+		}
+
+		deltas := make(map[rollupKey]*rollupAgg)
+		rollupDeltas(kept, deltas)
+		tx, err := store.sqlDB.Begin()
+		if err != nil {
+			return err
+		}
+		if err := store.mergeRollups(tx, deltas); err != nil {
+			tx.Rollback()
+			return err
+		}
+		if err := tx.Commit(); err != nil {
+			return err
+		}
+
+		log.Printf("聚合回填: 已处理 %d 条\n", total)
+	}
+
+	summaries, err := replaySummaries(from)
+	if err != nil {
+		return err
+	}
+	if summaries > 0 {
+		log.Printf("聚合回填: 已重放 %d 条设备汇总\n", summaries)
+	}
+
+	log.Printf("聚合回填完成: 共 %d 条, 耗时 %v\n", total, time.Since(start))
+	return nil
+}
+
+// backfillFrom 回填的起始时间（Unix 秒）: 原始记录被保留期清理过时（聚合表中有早于最早原始记录的桶）,
+// 只重建最早原始记录之后第一个整天开始的部分, 更早的聚合值无法再从原始记录恢复, 保持不变
+// （设备汇总台账与原始记录同期清理, 两者中较早的一个视为最早的原始数据）
+func backfillFrom() (int64, error) {
+	var oldestRaw time.Time
+	err := store.sqlDB.QueryRow("SELECT captured_at FROM sensor_data ORDER BY captured_at ASC LIMIT 1").Scan(&oldestRaw)
+	hasRaw := err == nil
+	if err != nil && err != sql.ErrNoRows {
+		return 0, err
+	}
+	oldestSum, hasSum, err := oldestSummary()
+	if err != nil {
+		return 0, err
+	}
+	if hasSum && (!hasRaw || oldestSum.Before(oldestRaw)) {
+		oldestRaw, hasRaw = oldestSum, true
+	}
+	if !hasRaw {
+		return math.MinInt64, nil
+	}
+
+	var oldestBucket sql.NullInt64
+	if err := store.sqlDB.QueryRow("SELECT MIN(bucket) FROM sensor_rollups").Scan(&oldestBucket); err != nil {
+		return 0, err
+	}
+	day := rollupLevels[len(rollupLevels)-1].seconds
+	rawTS := oldestRaw.Unix()
+	if !oldestBucket.Valid || oldestBucket.Int64 >= rawTS-floorMod(rawTS, day) {
+		return math.MinInt64, nil
+	}
+	return alignUp(rawTS, day), nil
+}
+
+// needsBackfill 聚合表为空而原始表或设备汇总台账有数据时（升级后首次启动或聚合表结构变更）需要回填
+func needsBackfill() (bool, error) {
+	var hasRollup, hasRaw bool
+	if err := store.sqlDB.QueryRow("SELECT EXISTS (SELECT 1 FROM sensor_rollups)").Scan(&hasRollup); err != nil {
+		return false, err
+	}
+	if err := store.sqlDB.QueryRow("SELECT EXISTS (SELECT 1 FROM sensor_data) OR EXISTS (SELECT 1 FROM sensor_summaries)").Scan(&hasRaw); err != nil {
+		return false, err
+	}
+	return !hasRollup && hasRaw, nil
+}
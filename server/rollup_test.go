@@ -0,0 +1,132 @@
+package main
+
+import (
+	"math"
+	"math/rand"
+	"testing"
+)
+
+// rollupTestRows 各测量值量级不同且两两相关的测试数据
+func rollupTestRows(n int) [][metricCount]float64 {
+	rng := rand.New(rand.NewSource(2))
+	rows := make([][metricCount]float64, n)
+	for r := range rows {
+		base := rng.NormFloat64()
+		for i := 0; i < metricCount; i++ {
+			scale := math.Pow(10, float64(i%4))
+			rows[r][i] = 1e4 + scale*(base*float64(i+1)+rng.NormFloat64())
+		}
+	}
+	return rows
+}
+
+// twoPassAgg 两遍法的均值、离差平方和与协离差和（作为精确参考）
+func twoPassAgg(rows [][metricCount]float64) (mean, m2 [metricCount]float64, c2 [pairCount]float64) {
+	for _, v := range rows {
+		for i, x := range v {
+			mean[i] += x
+		}
+	}
+	for i := range mean {
+		mean[i] /= float64(len(rows))
+	}
+	for _, v := range rows {
+		p := 0
+		for i := 0; i < metricCount; i++ {
+			m2[i] += (v[i] - mean[i]) * (v[i] - mean[i])
+			for j := i + 1; j < metricCount; j++ {
+				c2[p] += (v[i] - mean[i]) * (v[j] - mean[j])
+				p++
+			}
+		}
+	}
+	return mean, m2, c2
+}
+
+func closeTo(got, want float64) bool {
+	return math.Abs(got-want) <= 1e-9*math.Max(1, math.Abs(want))
+}
+
+func TestRollupAggMergeEquivalence(t *testing.T) {
+	rows := rollupTestRows(10000)
+	mean, m2, c2 := twoPassAgg(rows)
+
+	whole := newRollupAgg(false)
+	for i := range rows {
+		whole.Add(&rows[i])
+	}
+
+	// 大小不一的分段逐级合并, 与分钟桶合并为小时桶、再合并为查询窗口的方式相同
+	merged := newRollupAgg(false)
+	part := newRollupAgg(false)
+	size := 1
+	for i := range rows {
+		part.Add(&rows[i])
+		if part.Count == int64(size) || i == len(rows)-1 {
+			merged.Merge(part)
+			part.Reset()
+			size = size%97 + 1
+		}
+	}
+
+	for name, agg := range map[string]*rollupAgg{"逐条": whole, "合并": merged} {
+		if agg.Count != int64(len(rows)) {
+			t.Fatalf("%s: 计数 %d, 期望 %d", name, agg.Count, len(rows))
+		}
+		for i := 0; i < metricCount; i++ {
+			if !closeTo(agg.Mean[i], mean[i]) || !closeTo(agg.M2[i], m2[i]) {
+				t.Errorf("%s: 测量值 %d 均值/离差平方和 %g/%g, 期望 %g/%g", name, i, agg.Mean[i], agg.M2[i], mean[i], m2[i])
+			}
+		}
+		for p := range c2 {
+			if !closeTo(agg.C2[p], c2[p]) {
+				t.Errorf("%s: 协离差和 %d = %g, 期望 %g", name, p, agg.C2[p], c2[p])
+			}
+		}
+	}
+	for i := 0; i < metricCount; i++ {
+		if merged.Min[i] != whole.Min[i] || merged.Max[i] != whole.Max[i] {
+			t.Errorf("测量值 %d 最值不一致", i)
+		}
+	}
+}
+
+// BenchmarkRollupAgg 逐条加入 1 万条记录, 以及把 1440 个分钟桶合并为一天
+func BenchmarkRollupAgg(b *testing.B) {
+	rows := rollupTestRows(10000)
+	for _, withSketch := range []bool{false, true} {
+		name := "add"
+		if withSketch {
+			name = "add_sketch"
+		}
+		b.Run(name, func(b *testing.B) {
+			b.ReportAllocs()
+			agg := newRollupAgg(withSketch)
+			for i := 0; i < b.N; i++ {
+				agg.Reset()
+				for r := range rows {
+					agg.Add(&rows[r])
+				}
+			}
+			b.ReportMetric(float64(len(rows)*b.N)/b.Elapsed().Seconds(), "rows/s")
+		})
+	}
+
+	minutes := make([]*rollupAgg, 1440)
+	for m := range minutes {
+		minutes[m] = newRollupAgg(true)
+		for r := 0; r < 60; r++ {
+			minutes[m].Add(&rows[(m*60+r)%len(rows)])
+		}
+	}
+	b.Run("merge_day", func(b *testing.B) {
+		b.ReportAllocs()
+		day := newRollupAgg(true)
+		for i := 0; i < b.N; i++ {
+			day.Reset()
+			for _, m := range minutes {
+				day.Merge(m)
+			}
+		}
+	})
+}
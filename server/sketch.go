@@ -0,0 +1,221 @@
+package main
+
+import (
+	"encoding/binary"
+	"errors"
+	"math"
+	"sort"
+)
+
+// 分位数草图: 按对数等比分桶（DDSketch）, 任意分位数的相对误差不超过 sketchRelativeAccuracy,
+// 草图可直接相加合并, 因此能存入聚合表并跨桶合并
+const (
+	sketchRelativeAccuracy = 0.005
+	sketchMaxBins          = 2048 // 超过时合并绝对值最小的桶
+	sketchMinValue         = 1e-9 // 绝对值更小的值计入零桶
+	sketchEncodingVersion  = 1
+)
+
+var (
+	sketchGamma    = (1 + sketchRelativeAccuracy) / (1 - sketchRelativeAccuracy)
+	sketchLogGamma = math.Log(sketchGamma)
+)
+
+// quantileSketch 分位数草图, 正负值分别按 ceil(log_gamma(|x|)) 分桶
+type quantileSketch struct {
+	pos   map[int32]uint64
+	neg   map[int32]uint64
+	zero  uint64
+	count uint64
+}
+
+func newQuantileSketch() *quantileSketch {
+	return &quantileSketch{pos: make(map[int32]uint64), neg: make(map[int32]uint64)}
+}
+
+// sketchKey 值所在的桶
+func sketchKey(abs float64) int32 {
+	return int32(math.Ceil(math.Log(abs) / sketchLogGamma))
+}
+
+// sketchValue 桶的代表值（相对误差最小）
+func sketchValue(key int32) float64 {
+	return 2 * math.Pow(sketchGamma, float64(key)) / (1 + sketchGamma)
+}
+
+// Reset 清空草图
+func (s *quantileSketch) Reset() {
+	clear(s.pos)
+	clear(s.neg)
+	s.zero, s.count = 0, 0
+}
+
+// Add 加入一个值
+func (s *quantileSketch) Add(x float64) {
+	s.AddN(x, 1)
+}
+
+// AddN 加入 n 个相同的值
+func (s *quantileSketch) AddN(x float64, n uint64) {
+	if n == 0 {
+		return
+	}
+	s.count += n
+	switch {
+	case x > sketchMinValue:
+		s.pos[sketchKey(x)] += n
+	case x < -sketchMinValue:
+		s.neg[sketchKey(-x)] += n
+	default:
+		s.zero += n
+	}
+	s.collapse()
+}
+
+// Merge 合并另一个草图
+func (s *quantileSketch) Merge(o *quantileSketch) {
+	for k, c := range o.pos {
+		s.pos[k] += c
+	}
+	for k, c := range o.neg {
+		s.neg[k] += c
+	}
+	s.zero += o.zero
+	s.count += o.count
+	s.collapse()
+}
+
+// collapse 桶数超限时将绝对值最小的桶并入相邻桶（仅影响最接近零的分位数的精度）
+func (s *quantileSketch) collapse() {
+	excess := len(s.pos) + len(s.neg) - sketchMaxBins
+	if excess <= 0 {
+		return
+	}
+	for _, bins := range []map[int32]uint64{s.neg, s.pos} {
+		if len(bins) < 2 {
+			continue
+		}
+		keys := sortedKeys(bins)
+		for i := 0; i < len(keys)-1 && excess > 0; i++ {
+			bins[keys[i+1]] += bins[keys[i]]
+			delete(bins, keys[i])
+			excess--
+		}
+	}
+}
+
+// sortedKeys 按升序返回桶号
+func sortedKeys(bins map[int32]uint64) []int32 {
+	keys := make([]int32, 0, len(bins))
+	for k := range bins {
+		keys = append(keys, k)
+	}
+	sort.Slice(keys, func(i, j int) bool { return keys[i] < keys[j] })
+	return keys
+}
+
+// Quantile 估算 q (0~1) 分位数, 草图为空时返回 0
+func (s *quantileSketch) Quantile(q float64) float64 {
+	if s.count == 0 {
+		return 0
+	}
+	rank := q * float64(s.count-1)
+	var acc uint64
+
+	// 负值: 绝对值从大到小
+	negKeys := sortedKeys(s.neg)
+	for i := len(negKeys) - 1; i >= 0; i-- {
+		acc += s.neg[negKeys[i]]
+		if float64(acc) > rank {
+			return -sketchValue(negKeys[i])
+		}
+	}
+	acc += s.zero
+	if float64(acc) > rank {
+		return 0
+	}
+	posKeys := sortedKeys(s.pos)
+	for _, k := range posKeys {
+		acc += s.pos[k]
+		if float64(acc) > rank {
+			return sketchValue(k)
+		}
+	}
+	if len(posKeys) > 0 {
+		return sketchValue(posKeys[len(posKeys)-1])
+	}
+	return 0
+}
+
+// MarshalBinary 编码: 版本号, 零桶计数, 负值桶, 正值桶; 每组为桶数 + (桶号差值, 计数) 变长整数
+func (s *quantileSketch) MarshalBinary() []byte {
+	buf := make([]byte, 0, 8+(len(s.pos)+len(s.neg))*4)
+	buf = append(buf, sketchEncodingVersion)
+	buf = binary.AppendUvarint(buf, s.zero)
+	for _, bins := range []map[int32]uint64{s.neg, s.pos} {
+		keys := sortedKeys(bins)
+		buf = binary.AppendUvarint(buf, uint64(len(keys)))
+		prev := int32(0)
+		for _, k := range keys {
+			buf = binary.AppendVarint(buf, int64(k-prev))
+			buf = binary.AppendUvarint(buf, bins[k])
+			prev = k
+		}
+	}
+	return buf
+}
+
+var errSketchCorrupt = errors.New("分位数草图数据损坏")
+
+// UnmarshalBinary 解码 MarshalBinary 的结果, 复用已有草图的内存
+func (s *quantileSketch) UnmarshalBinary(data []byte) error {
+	if s.pos == nil {
+		*s = *newQuantileSketch()
+	} else {
+		s.Reset()
+	}
+	if len(data) == 0 {
+		return nil
+	}
+	if data[0] != sketchEncodingVersion {
+		return errSketchCorrupt
+	}
+	data = data[1:]
+
+	readUvarint := func() (uint64, bool) {
+		v, n := binary.Uvarint(data)
+		if n <= 0 {
+			return 0, false
+		}
+		data = data[n:]
+		return v, true
+	}
+
+	var ok bool
+	if s.zero, ok = readUvarint(); !ok {
+		return errSketchCorrupt
+	}
+	s.count = s.zero
+	for _, bins := range []map[int32]uint64{s.neg, s.pos} {
+		n, ok := readUvarint()
+		if !ok || n > uint64(len(data)) {
+			return errSketchCorrupt
+		}
+		key := int32(0)
+		for i := uint64(0); i < n; i++ {
+			delta, m := binary.Varint(data)
+			if m <= 0 {
+				return errSketchCorrupt
+			}
+			data = data[m:]
+			c, ok := readUvarint()
+			if !ok {
+				return errSketchCorrupt
+			}
+			key += int32(delta)
+			bins[key] = c
+			s.count += c
+		}
+	}
+	return nil
+}
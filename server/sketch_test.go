@@ -0,0 +1,115 @@
+package main
+
+import (
+	"math"
+	"math/rand"
+	"sort"
+	"testing"
+)
+
+// exactQuantile 排序后的精确分位数（与 Quantile 相同的取秩方式）
+func exactQuantile(sorted []float64, q float64) float64 {
+	return sorted[int(q*float64(len(sorted)-1))]
+}
+
+// sketchTestData 含正负值、零值与跨多个数量级的测试数据, 与测量值一样精确到 0.01
+func sketchTestData(n int) []float64 {
+	rng := rand.New(rand.NewSource(1))
+	values := make([]float64, n)
+	for i := range values {
+		var v float64
+		switch i % 4 {
+		case 0:
+			v = rng.ExpFloat64() * 1000
+		case 1:
+			v = math.Exp(rng.NormFloat64() * 2)
+		case 2:
+			v = -rng.ExpFloat64() * 10
+		default:
+			v = math.Round(rng.Float64()*4) - 2
+		}
+		values[i] = math.Round(v*100) / 100
+	}
+	return values
+}
+
+func TestQuantileSketchRelativeError(t *testing.T) {
+	values := sketchTestData(100000)
+	sk := newQuantileSketch()
+	for _, v := range values {
+		sk.Add(v)
+	}
+	// 误差上界只在桶数未超限（未合并过桶）时成立
+	if bins := len(sk.pos) + len(sk.neg); bins >= sketchMaxBins {
+		t.Fatalf("测试数据占用 %d 个桶, 超过上限 %d", bins, sketchMaxBins)
+	}
+	sorted := append([]float64(nil), values...)
+	sort.Float64s(sorted)
+
+	for q := 0.0; q <= 1; q += 0.01 {
+		want := exactQuantile(sorted, q)
+		got := sk.Quantile(q)
+		if math.Abs(got-want) > sketchRelativeAccuracy*math.Abs(want)+1e-12 {
+			t.Errorf("q=%.2f: 估算 %g, 精确值 %g, 相对误差超过 %g", q, got, want, sketchRelativeAccuracy)
+		}
+	}
+}
+
+func TestQuantileSketchMergeAndEncoding(t *testing.T) {
+	values := sketchTestData(10000)
+	whole := newQuantileSketch()
+	merged := newQuantileSketch()
+	part := newQuantileSketch()
+	for i, v := range values {
+		whole.Add(v)
+		part.Add(v)
+		if i%1000 == 999 {
+			// 经过编码再合并, 与写入聚合表再读出的路径相同
+			decoded := newQuantileSketch()
+			if err := decoded.UnmarshalBinary(part.MarshalBinary()); err != nil {
+				t.Fatal(err)
+			}
+			merged.Merge(decoded)
+			part.Reset()
+		}
+	}
+	if merged.count != whole.count {
+		t.Fatalf("合并后计数 %d, 期望 %d", merged.count, whole.count)
+	}
+	for q := 0.0; q <= 1; q += 0.05 {
+		if got, want := merged.Quantile(q), whole.Quantile(q); got != want {
+			t.Errorf("q=%.2f: 合并后 %g, 整体 %g", q, got, want)
+		}
+	}
+}
+
+// BenchmarkMedian 中位数: 草图（逐条加入后查询）与精确排序的对比, 报告草图的相对误差
+func BenchmarkMedian(b *testing.B) {
+	values := sketchTestData(100000)
+	sorted := append([]float64(nil), values...)
+	sort.Float64s(sorted)
+	exact := exactQuantile(sorted, 0.5)
+
+	b.Run("sketch", func(b *testing.B) {
+		b.ReportAllocs()
+		sk := newQuantileSketch()
+		var got float64
+		for i := 0; i < b.N; i++ {
+			sk.Reset()
+			for _, v := range values {
+				sk.Add(v)
+			}
+			got = sk.Quantile(0.5)
+		}
+		b.ReportMetric(math.Abs(got-exact)/math.Abs(exact), "relerr")
+	})
+	b.Run("sort", func(b *testing.B) {
+		b.ReportAllocs()
+		buf := make([]float64, len(values))
+		for i := 0; i < b.N; i++ {
+			copy(buf, values)
+			sort.Float64s(buf)
+			_ = exactQuantile(buf, 0.5)
+		}
+	})
+}
@@ -0,0 +1,364 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"errors"
+	"strconv"
+	"strings"
+	"time"
+)
+
+// sqlitePragmas 每个连接打开时设置的 PRAGMA:
+// WAL 模式下读写互不阻塞, synchronous=NORMAL 在 WAL 下仍保证崩溃一致性,
+// 64MB 页缓存与内存临时表加速范围扫描
+var sqlitePragmas = []string{
+	"journal_mode(WAL)",
+	"synchronous(NORMAL)",
+	"busy_timeout(5000)",
+	"cache_size(-65536)",
+	"temp_store(MEMORY)",
+}
+
+// sqliteDSN 在数据库路径后追加 PRAGMA 参数
+func sqliteDSN(path string) string {
+	sep := "?"
+	if strings.Contains(path, "?") {
+		sep = "&"
+	}
+	return path + sep + "_pragma=" + strings.Join(sqlitePragmas, "&_pragma=")
+}
+
+// sensorColumns 传感器数据表的全部列（与 SensorData 字段顺序一致）
+const sensorColumns = "id, created_at, captured_at, particle, pm25, hcho, co2, temperature, humidity, voc, sequence_num, is_valid, device_id, flags"
+
+// sensorInsertColumns 写入时的列（id 自增）
+const sensorInsertColumns = "created_at, captured_at, particle, pm25, hcho, co2, temperature, humidity, voc, sequence_num, is_valid, device_id, flags"
+
+// sensorInsertArgs 每行写入的参数个数
+const sensorInsertArgs = 13
+
+// storageIndexes 覆盖索引: 按采集时间范围扫描时只读索引即可取到全部列, 无需回表
+// （旧版本按接收时间建立的 idx_sensor_data_window 已不再使用）
+var storageIndexes = []string{
+	"DROP INDEX IF EXISTS idx_sensor_data_window",
+	"CREATE INDEX IF NOT EXISTS idx_sensor_data_captured ON sensor_data(captured_at, created_at, particle, pm25, hcho, co2, temperature, humidity, voc, is_valid, sequence_num, device_id, flags)",
+	// 同一设备、采集时间、序号只保留一条（设备重发或补传的重复数据在写入时跳过）, 同时用于按设备查找相邻序号
+	"CREATE UNIQUE INDEX IF NOT EXISTS idx_sensor_data_reading ON sensor_data(device_id, captured_at, sequence_num)",
+}
+
+// sensorConflictClause 写入时跳过已存在的记录
+const sensorConflictClause = " ON CONFLICT (device_id, captured_at, sequence_num) DO NOTHING"
+
+// backfillCapturedAt 旧版本写入的记录没有采集时间, 以接收时间代替
+const backfillCapturedAt = "UPDATE sensor_data SET captured_at = created_at WHERE captured_at IS NULL"
+
+// sensorStore 热点读写路径使用的预编译语句, 绕过 GORM 反射
+type sensorStore struct {
+	sqlDB            *sql.DB
+	insertOne        *sql.Stmt
+	insertBatch      *sql.Stmt // ingestInsertBatchSize 行的多行 INSERT
+	scanBetween      *sql.Stmt // [start, end) 内的全部记录（升序）
+	scanRecent       *sql.Stmt // 时间范围内的最新若干条记录（降序）
+	scanAfter        *sql.Stmt // 游标之后的最新若干条记录（按 (captured_at, id) 降序）
+	scanChunk        *sql.Stmt // 按 id 分段读取全部记录
+	scanRollup       *sql.Stmt // 指定粒度 [from, to) 内的聚合桶（不含草图）
+	scanRollupSketch *sql.Stmt // 同上, 含分位数草图
+	getRollup        *sql.Stmt // 读取单个聚合桶（含草图）
+	putRollup        *sql.Stmt // 写入单个聚合桶
+	seqRecent        *sql.Stmt // 设备最新的若干条 (采集时间, 序号)（降序）
+	seqBefore        *sql.Stmt // 设备在指定采集时间之前的最后一条记录的采集时间与序号
+	seqAfter         *sql.Stmt // 设备在指定采集时间之后的第一条记录的采集时间与序号
+	insertSummary    *sql.Stmt // 写入一条设备汇总（已存在时跳过）
+	scanSummaries    *sql.Stmt // 窗口起始时间在指定范围内的设备汇总
+
+	// removedDuplicates 建立唯一索引时删除的重复记录数（聚合表需要重建）
+	removedDuplicates int64
+}
+
+var store *sensorStore
+
+// insertSQL 生成 rows 行的多行 INSERT 语句
+func insertSQL(rows int) string {
+	row := "(" + strings.TrimSuffix(strings.Repeat("?,", sensorInsertArgs), ",") + ")"
+	values := strings.TrimSuffix(strings.Repeat(row+",", rows), ",")
+	return "INSERT INTO sensor_data (" + sensorInsertColumns + ") VALUES " + values + sensorConflictClause
+}
+
+// removeDuplicateReadings 建立唯一索引前删除重复记录（同一设备、采集时间、序号只保留最早写入的一条）, 返回删除的条数
+func removeDuplicateReadings(sqlDB *sql.DB) (int64, error) {
+	var indexed bool
+	if err := sqlDB.QueryRow("SELECT EXISTS (SELECT 1 FROM sqlite_master WHERE type = 'index' AND name = 'idx_sensor_data_reading')").Scan(&indexed); err != nil {
+		return 0, err
+	}
+	if indexed {
+		return 0, nil
+	}
+	res, err := sqlDB.Exec("DELETE FROM sensor_data WHERE id NOT IN (SELECT MIN(id) FROM sensor_data GROUP BY device_id, captured_at, sequence_num)")
+	if err != nil {
+		return 0, err
+	}
+	return res.RowsAffected()
+}
+
+// newSensorStore 创建聚合表与索引, 并预编译热点语句
+func newSensorStore(sqlDB *sql.DB) (*sensorStore, error) {
+	if err := migrateRollupTable(sqlDB); err != nil {
+		return nil, err
+	}
+	for _, stmt := range []string{rollupCreateSQL(), summaryCreateSQL, backfillCapturedAt} {
+		if _, err := sqlDB.Exec(stmt); err != nil {
+			return nil, err
+		}
+	}
+	removed, err := removeDuplicateReadings(sqlDB)
+	if err != nil {
+		return nil, err
+	}
+	for _, stmt := range append(storageIndexes, summaryIndexes...) {
+		if _, err := sqlDB.Exec(stmt); err != nil {
+			return nil, err
+		}
+	}
+	// 更新查询规划器的统计信息
+	if _, err := sqlDB.Exec("PRAGMA optimize"); err != nil {
+		return nil, err
+	}
+
+	s := &sensorStore{sqlDB: sqlDB, removedDuplicates: removed}
+	prepare := func(query string) *sql.Stmt {
+		if err != nil {
+			return nil
+		}
+		var stmt *sql.Stmt
+		stmt, err = sqlDB.Prepare(query)
+		return stmt
+	}
+
+	s.insertOne = prepare(insertSQL(1))
+	s.insertBatch = prepare(insertSQL(ingestInsertBatchSize))
+	s.scanBetween = prepare("SELECT " + sensorColumns + " FROM sensor_data INDEXED BY idx_sensor_data_captured WHERE captured_at >= ? AND captured_at < ? ORDER BY captured_at ASC")
+	s.scanRecent = prepare("SELECT " + sensorColumns + " FROM sensor_data INDEXED BY idx_sensor_data_captured WHERE captured_at >= ? ORDER BY captured_at DESC, id DESC LIMIT ?")
+	s.scanAfter = prepare("SELECT " + sensorColumns + " FROM sensor_data INDEXED BY idx_sensor_data_captured WHERE captured_at >= ? AND (captured_at, id) < (?, ?) ORDER BY captured_at DESC, id DESC LIMIT ?")
+	s.scanChunk = prepare("SELECT " + sensorColumns + " FROM sensor_data WHERE id > ? ORDER BY id ASC LIMIT ?")
+	s.scanRollup = prepare(rollupSelectSQL(false) + " WHERE level = ? AND bucket >= ? AND bucket < ? ORDER BY bucket ASC")
+	s.scanRollupSketch = prepare(rollupSelectSQL(true) + " WHERE level = ? AND bucket >= ? AND bucket < ? ORDER BY bucket ASC")
+	s.getRollup = prepare(rollupSelectSQL(true) + " WHERE level = ? AND bucket = ?")
+	s.putRollup = prepare(rollupReplaceSQL())
+	s.seqRecent = prepare("SELECT captured_at, sequence_num FROM sensor_data INDEXED BY idx_sensor_data_reading WHERE device_id = ? ORDER BY captured_at DESC LIMIT ?")
+	s.seqBefore = prepare("SELECT captured_at, sequence_num FROM sensor_data INDEXED BY idx_sensor_data_reading WHERE device_id = ? AND captured_at < ? ORDER BY captured_at DESC LIMIT 1")
+	s.seqAfter = prepare("SELECT captured_at, sequence_num FROM sensor_data INDEXED BY idx_sensor_data_reading WHERE device_id = ? AND captured_at > ? ORDER BY captured_at ASC LIMIT 1")
+	s.insertSummary = prepare(summaryInsertSQL)
+	s.scanSummaries = prepare(summaryScanSQL)
+	if err != nil {
+		return nil, err
+	}
+	return s, nil
+}
+
+// appendInsertArgs 追加一行写入参数
+func appendInsertArgs(args []any, d *SensorData) []any {
+	return append(args, d.CreatedAt, d.CapturedAt, d.Particle, d.PM25, d.HCHO, d.CO2, d.Temperature, d.Humidity, d.VOC,
+		d.SequenceNum, d.IsValid, d.DeviceID, d.Flags)
+}
+
+// Insert 在一个事务中写入多条记录, 并同步更新各粒度的聚合表; 已存在的记录（设备重发或补传的重复数据）被跳过,
+// 返回实际写入的记录（复用 records 的底层数组, 已回填 id）
+func (s *sensorStore) Insert(records []SensorData) ([]SensorData, error) {
+	tx, err := s.sqlDB.Begin()
+	if err != nil {
+		return nil, err
+	}
+	defer tx.Rollback()
+
+	batch := tx.Stmt(s.insertBatch)
+	one := tx.Stmt(s.insertOne)
+	args := make([]any, 0, ingestInsertBatchSize*sensorInsertArgs)
+	i := 0
+	for ; i+ingestInsertBatchSize <= len(records); i += ingestInsertBatchSize {
+		if err := insertChunk(tx, batch, one, records[i:i+ingestInsertBatchSize], args); err != nil {
+			return nil, err
+		}
+	}
+	for ; i < len(records); i++ {
+		if err := insertOneRecord(one, &records[i], args); err != nil {
+			return nil, err
+		}
+	}
+
+	// 只保留实际写入的记录（跳过的记录 id 为 0）
+	inserted := records[:0]
+	for k := range records {
+		if records[k].ID != 0 {
+			inserted = append(inserted, records[k])
+		}
+	}
+
+	deltas := make(map[rollupKey]*rollupAgg)
+	rollupDeltas(inserted, deltas)
+	if err := s.mergeRollups(tx, deltas); err != nil {
+		return nil, err
+	}
+
+	return inserted, tx.Commit()
+}
+
+// insertChunk 以一条多行 INSERT 写入 ingestInsertBatchSize 条记录; 其中有已存在的记录时无法得知各条的 id,
+// 回滚到保存点后逐条写入（重复数据只在重发时出现, 不影响正常写入的速度）
+func insertChunk(tx *sql.Tx, batch, one *sql.Stmt, chunk []SensorData, args []any) error {
+	if _, err := tx.Exec("SAVEPOINT insert_chunk"); err != nil {
+		return err
+	}
+	args = args[:0]
+	for k := range chunk {
+		args = appendInsertArgs(args, &chunk[k])
+	}
+	res, err := batch.Exec(args...)
+	if err != nil {
+		return err
+	}
+	n, err := res.RowsAffected()
+	if err != nil {
+		return err
+	}
+	if n == int64(len(chunk)) {
+		if err := assignIDs(res, chunk); err != nil {
+			return err
+		}
+		_, err = tx.Exec("RELEASE insert_chunk")
+		return err
+	}
+
+	if _, err := tx.Exec("ROLLBACK TO insert_chunk"); err != nil {
+		return err
+	}
+	if _, err := tx.Exec("RELEASE insert_chunk"); err != nil {
+		return err
+	}
+	for k := range chunk {
+		if err := insertOneRecord(one, &chunk[k], args); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// insertOneRecord 写入一条记录并回填 id, 记录已存在时 id 保持为 0
+func insertOneRecord(one *sql.Stmt, d *SensorData, args []any) error {
+	res, err := one.Exec(appendInsertArgs(args[:0], d)...)
+	if err != nil {
+		return err
+	}
+	n, err := res.RowsAffected()
+	if err != nil || n == 0 {
+		return err
+	}
+	id, err := res.LastInsertId()
+	if err != nil {
+		return err
+	}
+	d.ID = uint(id)
+	return nil
+}
+
+// forEachRecord 逐条读取查询结果, 不保留整个结果集
+func forEachRecord(rows *sql.Rows, fn func(d *SensorData)) error {
+	defer rows.Close()
+
+	var d SensorData
+	for rows.Next() {
+		if err := rows.Scan(&d.ID, &d.CreatedAt, &d.CapturedAt, &d.Particle, &d.PM25, &d.HCHO, &d.CO2, &d.Temperature, &d.Humidity, &d.VOC,
+			&d.SequenceNum, &d.IsValid, &d.DeviceID, &d.Flags); err != nil {
+			return err
+		}
+		fn(&d)
+	}
+	return rows.Err()
+}
+
+// assignIDs 回填一条 INSERT 语句写入的记录 id: 写入协程独占写入, 同一语句内自增 id 连续
+func assignIDs(res sql.Result, records []SensorData) error {
+	last, err := res.LastInsertId()
+	if err != nil {
+		return err
+	}
+	first := uint(last) - uint(len(records)) + 1
+	for k := range records {
+		records[k].ID = first + uint(k)
+	}
+	return nil
+}
+
+// scanRecords 读取查询结果
+func scanRecords(rows *sql.Rows, sizeHint int) ([]SensorData, error) {
+	records := make([]SensorData, 0, sizeHint)
+	err := forEachRecord(rows, func(d *SensorData) {
+		records = append(records, *d)
+	})
+	if err != nil {
+		return nil, err
+	}
+	return records, nil
+}
+
+// pageCursor 历史分页游标: 上一页最后一条记录的采集时间与 id, 零值表示从最新开始;
+// 游标本身携带排序键, 该记录被数据保留清理后仍可继续翻页
+type pageCursor struct {
+	capturedAt time.Time
+	id         uint
+}
+
+// String 编码为 "<采集时间纳秒>_<id>"
+func (c pageCursor) String() string {
+	return strconv.FormatInt(c.capturedAt.UnixNano(), 10) + "_" + strconv.FormatUint(uint64(c.id), 10)
+}
+
+// parsePageCursor 解析 String 的结果
+func parsePageCursor(s string) (pageCursor, error) {
+	ts, id, ok := strings.Cut(s, "_")
+	if !ok {
+		return pageCursor{}, errInvalidCursor
+	}
+	ns, err := strconv.ParseInt(ts, 10, 64)
+	if err != nil {
+		return pageCursor{}, errInvalidCursor
+	}
+	parsed, err := strconv.ParseUint(id, 10, 64)
+	if err != nil || parsed == 0 {
+		return pageCursor{}, errInvalidCursor
+	}
+	return pageCursor{capturedAt: time.Unix(0, ns), id: uint(parsed)}, nil
+}
+
+var errInvalidCursor = errors.New("游标无效")
+
+// Page 按 (captured_at, id) 降序逐条读取 start 之后、游标 cursor 之前的记录, 最多 limit 条（<= 0 时不限制）
+func (s *sensorStore) Page(ctx context.Context, start time.Time, cursor pageCursor, limit int, fn func(d *SensorData)) error {
+	if limit <= 0 {
+		limit = -1
+	}
+	var rows *sql.Rows
+	var err error
+	if cursor.id == 0 {
+		rows, err = s.scanRecent.QueryContext(ctx, start, limit)
+	} else {
+		rows, err = s.scanAfter.QueryContext(ctx, start, cursor.capturedAt, cursor.id, limit)
+	}
+	if err != nil {
+		return err
+	}
+	return forEachRecord(rows, fn)
+}
+
+// Recent 按采集时间降序读取 start 之后最新的 limit 条记录, limit <= 0 时不限制条数
+func (s *sensorStore) Recent(start time.Time, limit int) ([]SensorData, error) {
+	sizeHint := limit
+	if limit <= 0 {
+		limit, sizeHint = -1, 0
+	}
+	rows, err := s.scanRecent.Query(start, limit)
+	if err != nil {
+		return nil, err
+	}
+	return scanRecords(rows, sizeHint)
+}
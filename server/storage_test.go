@@ -0,0 +1,171 @@
+package main
+
+import (
+	"context"
+	"fmt"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+)
+
+// 查询基准的数据集: BENCH_ROWS 条（默认 1000 万）每秒一条的记录, 生成一次后保存在临时目录中供之后的运行复用
+const defaultBenchRows = 10000000
+
+// benchDataStart 基准数据集第一条记录的采集时间
+var benchDataStart = time.Date(2024, 1, 1, 0, 0, 0, 0, time.UTC)
+
+// openBenchStore 打开基准数据集, 不足时补齐, 返回最后一条记录的采集时间
+func openBenchStore(b *testing.B) time.Time {
+	b.Helper()
+	rows := envInt("BENCH_ROWS", defaultBenchRows)
+	dir := filepath.Join(os.TempDir(), fmt.Sprintf("b39-bench-%d", rows))
+	if err := os.MkdirAll(dir, 0o755); err != nil {
+		b.Fatal(err)
+	}
+	openTestStore(b, dir)
+
+	var existing int
+	if err := store.sqlDB.QueryRow("SELECT COUNT(*) FROM sensor_data").Scan(&existing); err != nil {
+		b.Fatal(err)
+	}
+	const chunk = 10000
+	for n := existing; n < rows; n += chunk {
+		count := min(chunk, rows-n)
+		records := syntheticRecords(benchDataStart.Add(time.Duration(n)*time.Second), time.Second, count, int64(n))
+		if _, err := store.Insert(records); err != nil {
+			b.Fatal(err)
+		}
+		if n%(100*chunk) == 0 {
+			b.Logf("生成基准数据: %d/%d", n, rows)
+		}
+	}
+	return benchDataStart.Add(time.Duration(rows-1) * time.Second)
+}
+
+// BenchmarkQueryHistoryPage /api/history 的一页（100 条）: 最新一页与第 1000 页（游标翻页）
+func BenchmarkQueryHistoryPage(b *testing.B) {
+	end := openBenchStore(b)
+	start := end.Add(-30 * 24 * time.Hour)
+	ctx := context.Background()
+
+	var cursor pageCursor
+	for page := 0; page < 1000; page++ {
+		if err := store.Page(ctx, start, cursor, 100, func(d *SensorData) { cursor = pageCursor{d.CapturedAt, d.ID} }); err != nil {
+			b.Fatal(err)
+		}
+	}
+
+	for _, bc := range []struct {
+		name   string
+		cursor pageCursor
+	}{{"first", pageCursor{}}, {"page1000", cursor}} {
+		b.Run(bc.name, func(b *testing.B) {
+			for i := 0; i < b.N; i++ {
+				n := 0
+				if err := store.Page(ctx, start, bc.cursor, 100, func(d *SensorData) { n++ }); err != nil {
+					b.Fatal(err)
+				}
+				if n != 100 {
+					b.Fatalf("读取 %d 条, 期望 100", n)
+				}
+			}
+		})
+	}
+}
+
+// BenchmarkQueryRange 按采集时间范围遍历原始记录（覆盖索引扫描, 不经过热数据缓存与列存）
+func BenchmarkQueryRange(b *testing.B) {
+	end := openBenchStore(b)
+	for _, span := range []time.Duration{time.Hour, 24 * time.Hour} {
+		b.Run(span.String(), func(b *testing.B) {
+			ctx := context.Background()
+			rows := 0
+			for i := 0; i < b.N; i++ {
+				res, err := store.scanBetween.QueryContext(ctx, end.Add(-span), end)
+				if err != nil {
+					b.Fatal(err)
+				}
+				rows = 0
+				if err := forEachRecord(res, func(d *SensorData) { rows++ }); err != nil {
+					b.Fatal(err)
+				}
+			}
+			b.ReportMetric(float64(rows*b.N)/b.Elapsed().Seconds(), "rows/s")
+		})
+	}
+}
+
+// BenchmarkQueryWindowAgg /api/stats 与 /api/analysis 的窗口聚合: 未对齐部分读原始记录, 其余读聚合表
+func BenchmarkQueryWindowAgg(b *testing.B) {
+	end := openBenchStore(b)
+	for _, span := range []time.Duration{24 * time.Hour, 30 * 24 * time.Hour} {
+		b.Run(span.String(), func(b *testing.B) {
+			start := end.Add(-span).Add(-17 * time.Second)
+			for i := 0; i < b.N; i++ {
+				total := newRollupAgg(true)
+				err := store.WindowAgg(start, rollupDay, true, func(ts time.Time, agg *rollupAgg) {
+					total.Merge(agg)
+				})
+				if err != nil {
+					b.Fatal(err)
+				}
+				if total.Count == 0 {
+					b.Fatal("窗口内没有数据")
+				}
+			}
+		})
+	}
+}
+
+// BenchmarkQueryLatest /api/status 的最新一条记录（不经过热数据缓存）
+func BenchmarkQueryLatest(b *testing.B) {
+	openBenchStore(b)
+	for i := 0; i < b.N; i++ {
+		recent, err := store.Recent(time.Time{}, 1)
+		if err != nil || len(recent) != 1 {
+			b.Fatal(err)
+		}
+	}
+}
+
+func TestPageCursorRoundTrip(t *testing.T) {
+	c := pageCursor{capturedAt: time.Unix(1700000000, 123456789), id: 42}
+	parsed, err := parsePageCursor(c.String())
+	if err != nil || parsed.id != c.id || !parsed.capturedAt.Equal(c.capturedAt) {
+		t.Fatalf("解析 %q 得到 %+v, %v", c.String(), parsed, err)
+	}
+	for _, s := range []string{"42", "x_1", "1_0", "1_", "_1"} {
+		if _, err := parsePageCursor(s); err == nil {
+			t.Errorf("游标 %q 应无效", s)
+		}
+	}
+}
+
+func TestPageSurvivesDeletedCursorRow(t *testing.T) {
+	openTestStore(t, t.TempDir())
+	start := time.Now().Add(-time.Hour)
+	if _, err := store.Insert(syntheticRecords(start, time.Second, 30, 1)); err != nil {
+		t.Fatal(err)
+	}
+	ctx := context.Background()
+
+	var first []SensorData
+	if err := store.Page(ctx, time.Time{}, pageCursor{}, 10, func(d *SensorData) { first = append(first, *d) }); err != nil {
+		t.Fatal(err)
+	}
+	last := first[len(first)-1]
+	// 数据保留清理删除了游标所在的记录
+	if _, err := store.sqlDB.Exec("DELETE FROM sensor_data WHERE id = ?", last.ID); err != nil {
+		t.Fatal(err)
+	}
+
+	var next []SensorData
+	cursor := pageCursor{capturedAt: last.CapturedAt, id: last.ID}
+	if err := store.Page(ctx, time.Time{}, cursor, 10, func(d *SensorData) { next = append(next, *d) }); err != nil {
+		t.Fatal(err)
+	}
+	if len(next) != 10 || !next[0].CapturedAt.Before(last.CapturedAt) {
+		t.Fatalf("下一页 %d 条, 期望从 %v 之前的 10 条继续", len(next), last.CapturedAt)
+	}
+}
@@ -0,0 +1,278 @@
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"log"
+	"net/http"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// 实时推送默认配置, 可通过环境变量覆盖
+const (
+	defaultStreamClientBuffer = 64 // STREAM_CLIENT_BUFFER: 每个客户端最多缓存的未发送消息数
+	streamKeepAlive           = 15 * time.Second
+	streamRetryMS             = 3000 // 断线后浏览器重连间隔
+)
+
+// streamMetrics 实时推送统计
+type streamMetrics struct {
+	Published    int64 // 已广播的消息数
+	Delivered    int64 // 已写入客户端的消息数
+	SlowDropped  int64 // 缓冲区已满被断开的客户端数
+	TotalClients int64 // 累计连接数
+}
+
+// streamClient 一个实时推送连接, ch 关闭表示连接需要结束
+type streamClient struct {
+	ch chan []byte
+}
+
+// streamHub 实时推送广播中心: 每条消息只序列化一次, 非阻塞地放入各客户端的有界缓冲区,
+// 缓冲区满的客户端会被断开（浏览器会自动重连并重新拉取数据）, 不会拖慢写入协程
+type streamHub struct {
+	mu      sync.Mutex
+	clients map[*streamClient]struct{}
+	buffer  int
+	closed  bool
+	stats   streamMetrics
+}
+
+var hub = newStreamHub()
+
+func newStreamHub() *streamHub {
+	return &streamHub{
+		clients: make(map[*streamClient]struct{}),
+		buffer:  envInt("STREAM_CLIENT_BUFFER", defaultStreamClientBuffer),
+	}
+}
+
+// subscribe 注册客户端, 推送中心已关闭时返回 nil
+func (h *streamHub) subscribe() *streamClient {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	if h.closed {
+		return nil
+	}
+	c := &streamClient{ch: make(chan []byte, h.buffer)}
+	h.clients[c] = struct{}{}
+	atomic.AddInt64(&h.stats.TotalClients, 1)
+	return c
+}
+
+// unsubscribe 注销客户端
+func (h *streamHub) unsubscribe(c *streamClient) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	if _, ok := h.clients[c]; ok {
+		delete(h.clients, c)
+		close(c.ch)
+	}
+}
+
+// broadcast 将一条 SSE 消息发给所有客户端
+func (h *streamHub) broadcast(event string, payload any) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	if len(h.clients) == 0 {
+		return
+	}
+
+	data, err := json.Marshal(payload)
+	if err != nil {
+		log.Printf("推送消息序列化失败: %v\n", err)
+		return
+	}
+	msg := []byte(fmt.Sprintf("event: %s\ndata: %s\n\n", event, data))
+
+	atomic.AddInt64(&h.stats.Published, 1)
+	for c := range h.clients {
+		select {
+		case c.ch <- msg:
+		default:
+			// 客户端跟不上, 断开后由浏览器重连
+			delete(h.clients, c)
+			close(c.ch)
+			atomic.AddInt64(&h.stats.SlowDropped, 1)
+		}
+	}
+}
+
+// Close 断开所有客户端, 之后不再接受新连接（服务停止时调用）
+func (h *streamHub) Close() {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	h.closed = true
+	for c := range h.clients {
+		delete(h.clients, c)
+		close(c.ch)
+	}
+}
+
+// Metrics 获取实时推送统计
+func (h *streamHub) Metrics() map[string]any {
+	h.mu.Lock()
+	clients := len(h.clients)
+	h.mu.Unlock()
+	return map[string]any{
+		"clients":       clients,
+		"client_buffer": h.buffer,
+		"published":     atomic.LoadInt64(&h.stats.Published),
+		"delivered":     atomic.LoadInt64(&h.stats.Delivered),
+		"slow_dropped":  atomic.LoadInt64(&h.stats.SlowDropped),
+		"total_clients": atomic.LoadInt64(&h.stats.TotalClients),
+	}
+}
+
+// streamRollup 一个分钟桶内本批新数据的聚合（增量, 需与已有数据合并）
+type streamRollup struct {
+	Bucket time.Time          `json:"bucket"`
+	Count  int64              `json:"count"`
+	Mean   map[string]float64 `json:"mean"`
+	Min    map[string]float64 `json:"min"`
+	Max    map[string]float64 `json:"max"`
+}
+
+// metricMap 将按指标下标排列的值转换为以指标名为键的 map
+func metricMap(values *[metricCount]float64) map[string]float64 {
+	m := make(map[string]float64, metricCount)
+	for i, name := range rollupMetrics {
+		m[name] = values[i]
+	}
+	return m
+}
+
+// idle 没有客户端连接
+func (h *streamHub) idle() bool {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	return len(h.clients) == 0
+}
+
+// rollupEvents 按 keys 顺序生成分钟聚合增量事件
+func rollupEvents(keys []int64, minutes map[int64]*rollupAgg) []streamRollup {
+	deltas := make([]streamRollup, 0, len(keys))
+	for _, bucket := range keys {
+		agg := minutes[bucket]
+		deltas = append(deltas, streamRollup{
+			Bucket: time.Unix(bucket, 0),
+			Count:  agg.Count,
+			Mean:   metricMap(&agg.Mean),
+			Min:    metricMap(&agg.Min),
+			Max:    metricMap(&agg.Max),
+		})
+	}
+	return deltas
+}
+
+// publishRecords 推送一批已写入的记录（readings 事件）及其分钟聚合增量（rollup 事件）
+func (h *streamHub) publishRecords(records []SensorData) {
+	if len(records) == 0 || h.idle() {
+		return
+	}
+
+	var keys []int64
+	minutes := make(map[int64]*rollupAgg)
+	for i := range records {
+		ts := records[i].CapturedAt.Unix()
+		bucket := ts - floorMod(ts, rollupLevels[0].seconds)
+		agg, ok := minutes[bucket]
+		if !ok {
+			agg = newRollupAgg(false)
+			minutes[bucket] = agg
+			keys = append(keys, bucket)
+		}
+		v := records[i].metricValues()
+		agg.Add(&v)
+	}
+
+	h.broadcast("readings", records)
+	h.broadcast("rollup", rollupEvents(keys, minutes))
+}
+
+// publishSummaries 推送一批已写入的设备汇总对应的分钟聚合增量（rollup 事件, 汇总没有原始记录）
+func (h *streamHub) publishSummaries(summaries []deviceSummary) {
+	if len(summaries) == 0 || h.idle() {
+		return
+	}
+
+	var keys []int64
+	minutes := make(map[int64]*rollupAgg)
+	for i := range summaries {
+		summaries[i].portions(rollupLevels[0].seconds, func(bucket int64, part *rollupAgg) {
+			agg, ok := minutes[bucket]
+			if !ok {
+				agg = newRollupAgg(false)
+				minutes[bucket] = agg
+				keys = append(keys, bucket)
+			}
+			agg.Merge(part)
+		})
+	}
+	h.broadcast("rollup", rollupEvents(keys, minutes))
+}
+
+// handleStream 实时推送新数据（Server-Sent Events）
+//
+// 事件: readings 新写入的记录数组, rollup 对应的分钟聚合增量（汇总模式的设备只有 rollup 事件）
+func handleStream(w http.ResponseWriter, r *http.Request) {
+	if r.Method != http.MethodGet {
+		http.Error(w, "请求方法不允许", http.StatusMethodNotAllowed)
+		return
+	}
+	flusher, ok := w.(http.Flusher)
+	if !ok {
+		http.Error(w, "不支持实时推送", http.StatusInternalServerError)
+		return
+	}
+
+	c := hub.subscribe()
+	if c == nil {
+		http.Error(w, "服务正在停止", http.StatusServiceUnavailable)
+		return
+	}
+	defer hub.unsubscribe(c)
+
+	w.Header().Set("Content-Type", "text/event-stream")
+	w.Header().Set("Cache-Control", "no-cache")
+	w.Header().Set("X-Accel-Buffering", "no")
+	fmt.Fprintf(w, "retry: %d\n\n", streamRetryMS)
+	flusher.Flush()
+
+	keepAlive := time.NewTicker(streamKeepAlive)
+	defer keepAlive.Stop()
+
+	for {
+		select {
+		case msg, ok := <-c.ch:
+			if !ok {
+				return
+			}
+			if _, err := w.Write(msg); err != nil {
+				return
+			}
+			atomic.AddInt64(&hub.stats.Delivered, 1)
+			// 一次写出已积压的消息, 客户端断开时停止
+			for n := len(c.ch); n > 0; n-- {
+				msg, ok := <-c.ch
+				if !ok {
+					break
+				}
+				if _, err := w.Write(msg); err != nil {
+					return
+				}
+				atomic.AddInt64(&hub.stats.Delivered, 1)
+			}
+			flusher.Flush()
+		case <-keepAlive.C:
+			if _, err := w.Write([]byte(": keep-alive\n\n")); err != nil {
+				return
+			}
+			flusher.Flush()
+		case <-r.Context().Done():
+			return
+		}
+	}
+}
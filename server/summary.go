@@ -0,0 +1,421 @@
+package main
+
+import (
+	"database/sql"
+	"encoding/json"
+	"fmt"
+	"io"
+	"math"
+	"mime"
+	"net/http"
+	"sync/atomic"
+	"time"
+)
+
+// 设备汇总模式: 设备在本地按时间窗口统计, 每个窗口只上报一条汇总, 服务器直接并入聚合表, 不保存原始记录。
+//
+// 汇总台账 sensor_summaries 每个窗口一行, 同一设备、窗口起始时间、首个序号只计入一次（设备重发时跳过）,
+// 并保存汇总内容, 重建聚合表时与原始记录一起重放
+const (
+	summaryCreateSQL = "CREATE TABLE IF NOT EXISTS sensor_summaries (" +
+		"id INTEGER PRIMARY KEY, device_id TEXT NOT NULL, captured_at DATETIME NOT NULL, created_at DATETIME NOT NULL, " +
+		"seq_first INTEGER NOT NULL, seq_last INTEGER NOT NULL, count INTEGER NOT NULL, duration_ms INTEGER NOT NULL, " +
+		"flags INTEGER NOT NULL, payload BLOB NOT NULL)"
+	summaryInsertSQL = "INSERT INTO sensor_summaries (device_id, captured_at, created_at, seq_first, seq_last, count, duration_ms, flags, payload) " +
+		"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?) ON CONFLICT (device_id, captured_at, seq_first) DO NOTHING"
+	summaryScanSQL = "SELECT device_id, captured_at, created_at, payload FROM sensor_summaries INDEXED BY idx_sensor_summaries_captured " +
+		"WHERE captured_at >= ? AND captured_at < ? ORDER BY captured_at ASC"
+)
+
+// maxSummaryDuration 单个汇总窗口的最长时长（与设备端 SUMMARY_WINDOW_MAX_S 一致）
+const maxSummaryDuration = time.Hour
+
+var summaryIndexes = []string{
+	"CREATE UNIQUE INDEX IF NOT EXISTS idx_sensor_summaries_window ON sensor_summaries(device_id, captured_at, seq_first)",
+	"CREATE INDEX IF NOT EXISTS idx_sensor_summaries_captured ON sensor_summaries(captured_at)",
+}
+
+// summaryRequest 设备上报的一个窗口的汇总, 测量值均为 ×100 定点数（与二进制格式一致）:
+// min/max/last/mean 为 ×100, m2/c2 为 ×100²
+type summaryRequest struct {
+	TS         int64                `json:"ts"` // 窗口内第一帧的采集时间(UTC毫秒)
+	Flags      uint8                `json:"flags"`
+	DurationMS int64                `json:"duration_ms"` // 最后一帧与第一帧的采集时间差
+	Count      int64                `json:"count"`
+	SeqFirst   int64                `json:"seq_first"`
+	SeqLast    int64                `json:"seq_last"`
+	Min        [metricCount]float64 `json:"min"`
+	Max        [metricCount]float64 `json:"max"`
+	Last       [metricCount]float64 `json:"last"`
+	Mean       [metricCount]float64 `json:"mean"`
+	M2         [metricCount]float64 `json:"m2"`
+	C2         [pairCount]float64   `json:"c2"`
+}
+
+// deviceSummary 已校验的设备汇总
+type deviceSummary struct {
+	DeviceID   string
+	CapturedAt time.Time // 窗口起始时间（采集时间不可信时按接收时间与窗口时长推算）
+	CreatedAt  time.Time
+	req        summaryRequest
+	agg        *rollupAgg
+}
+
+// rollupAgg 将汇总换算为聚合值
+func (r *summaryRequest) rollupAgg() *rollupAgg {
+	return r.portion(r.Count)
+}
+
+// portion 将汇总中的 n 帧换算为聚合值
+//
+// 计数、均值、离差平方和、最值与协离差和可无损合并; 只取部分帧时均值、最值与整个窗口相同,
+// 离差平方和与协离差和按帧数比例分配, 各部分合并后与整个窗口一致。设备不上报分布,
+// 分位数草图近似为最小值、最大值各一次, 其余各帧均取均值
+func (r *summaryRequest) portion(n int64) *rollupAgg {
+	a := newRollupAgg(true)
+	a.Count = n
+	share := float64(n) / float64(r.Count)
+	const scale2 = binaryValueScale * binaryValueScale
+	for i := 0; i < metricCount; i++ {
+		a.Min[i] = r.Min[i] / binaryValueScale
+		a.Max[i] = r.Max[i] / binaryValueScale
+		// 设备以 10 位有效数字上报, 舍入误差可能使均值略超出最值
+		a.Mean[i] = math.Min(math.Max(r.Mean[i]/binaryValueScale, a.Min[i]), a.Max[i])
+		a.M2[i] = math.Max(r.M2[i], 0) / scale2 * share
+		if n == 1 {
+			a.Sketch[i].Add(a.Mean[i])
+			continue
+		}
+		a.Sketch[i].Add(a.Min[i])
+		a.Sketch[i].Add(a.Max[i])
+		a.Sketch[i].AddN(a.Mean[i], uint64(n-2))
+	}
+	for p := range a.C2 {
+		a.C2[p] = r.C2[p] / scale2 * share
+	}
+	return a
+}
+
+// framesBefore 窗口内采集时间早于 t（Unix 毫秒）的帧数
+//
+// 设备按固定间隔采样, 各帧视为在 [窗口起始, 窗口起始+时长] 上等间隔分布（首末两帧位于两端）
+func (d *deviceSummary) framesBefore(t int64) int64 {
+	elapsed := t - d.CapturedAt.UnixMilli()
+	if elapsed <= 0 {
+		return 0
+	}
+	if elapsed > d.req.DurationMS {
+		return d.req.Count
+	}
+	return min((elapsed*(d.req.Count-1)+d.req.DurationMS-1)/d.req.DurationMS, d.req.Count)
+}
+
+// portions 将汇总按帧的采集时间分到 seconds 粒度的各个桶, fn 对每个分到帧的桶调用一次（bucket 为桶起始 Unix 秒）
+func (d *deviceSummary) portions(seconds int64, fn func(bucket int64, agg *rollupAgg)) {
+	width := seconds * 1000
+	startMS := d.CapturedAt.UnixMilli()
+	endMS := startMS + d.req.DurationMS
+	for b := startMS - floorMod(startMS, width); b <= endMS; b += width {
+		n := d.framesBefore(b+width) - d.framesBefore(b)
+		switch {
+		case n == d.req.Count:
+			fn(b/1000, d.agg)
+		case n > 0:
+			fn(b/1000, d.req.portion(n))
+		}
+	}
+}
+
+// latest 窗口最后一帧作为设备的最新读数（汇总模式的设备没有原始记录）;
+// 标志为窗口内各帧标志的并集, 窗口内有异常帧时视为异常
+func (d *deviceSummary) latest() SensorData {
+	v := d.req.Last
+	for i := range v {
+		v[i] /= binaryValueScale
+	}
+	return SensorData{
+		CreatedAt:   d.CreatedAt,
+		CapturedAt:  d.CapturedAt.Add(time.Duration(d.req.DurationMS) * time.Millisecond),
+		Particle:    v[metricParticle],
+		PM25:        v[metricPM25],
+		HCHO:        v[metricHCHO],
+		CO2:         v[metricCO2],
+		Temperature: v[metricTemperature],
+		Humidity:    v[metricHumidity],
+		VOC:         v[metricVOC],
+		SequenceNum: d.req.SeqLast,
+		IsValid:     d.req.Flags&flagInvalidMask == 0,
+		DeviceID:    d.DeviceID,
+		Flags:       d.req.Flags,
+	}
+}
+
+// validate 检查汇总内容是否合理
+func (r *summaryRequest) validate() error {
+	if r.Count <= 0 {
+		return fmt.Errorf("帧数必须大于0")
+	}
+	if r.DurationMS < 0 || r.DurationMS > maxSummaryDuration.Milliseconds() {
+		return fmt.Errorf("窗口时长必须在0到%v之间", maxSummaryDuration)
+	}
+	for i := 0; i < metricCount; i++ {
+		if !(r.Min[i] <= r.Max[i]) {
+			return fmt.Errorf("%s 的最小值大于最大值", rollupMetrics[i])
+		}
+	}
+	return nil
+}
+
+// readSummaries 读取并校验一批汇总, 请求体为 JSON 数组
+func readSummaries(r *http.Request, deviceID string) ([]deviceSummary, int, error) {
+	if contentType := r.Header.Get("Content-Type"); contentType != "" {
+		mediaType, _, err := mime.ParseMediaType(contentType)
+		if err != nil || mediaType != "application/json" {
+			return nil, http.StatusUnsupportedMediaType, fmt.Errorf("汇总只支持 application/json")
+		}
+	}
+
+	body, err := io.ReadAll(r.Body)
+	if err != nil {
+		return nil, http.StatusBadRequest, fmt.Errorf("读取请求体失败")
+	}
+	defer r.Body.Close()
+
+	var reqs []summaryRequest
+	if err := json.Unmarshal(body, &reqs); err != nil {
+		return nil, http.StatusBadRequest, fmt.Errorf("JSON格式错误")
+	}
+	if len(reqs) == 0 {
+		return nil, http.StatusBadRequest, fmt.Errorf("汇总数据为空")
+	}
+	if len(reqs) > maxBatchSize {
+		return nil, http.StatusRequestEntityTooLarge, fmt.Errorf("汇总数据过多, 最多%d条", maxBatchSize)
+	}
+
+	receivedAt := time.Now()
+	summaries := make([]deviceSummary, len(reqs))
+	for i := range reqs {
+		req := &reqs[i]
+		if err := req.validate(); err != nil {
+			return nil, http.StatusBadRequest, fmt.Errorf("第%d条%s", i+1, err.Error())
+		}
+		capturedAt := time.UnixMilli(req.TS)
+		if !trustCaptureTime(req.Flags, capturedAt, receivedAt) {
+			capturedAt = receivedAt.Add(-time.Duration(req.DurationMS) * time.Millisecond)
+			atomic.AddInt64(&ingest.stats.CaptureFallbacks, 1)
+		}
+		summaries[i] = deviceSummary{
+			DeviceID:   deviceID,
+			CapturedAt: capturedAt,
+			CreatedAt:  receivedAt,
+			req:        *req,
+			agg:        req.rollupAgg(),
+		}
+	}
+	return summaries, http.StatusOK, nil
+}
+
+// handleDataSummary 接收汇总模式设备上报的窗口汇总, 请求体为 [{"ts":T,"count":N,...}, ...]
+func handleDataSummary(w http.ResponseWriter, r *http.Request) {
+	if r.Method != http.MethodPost {
+		http.Error(w, "请求方法不允许", http.StatusMethodNotAllowed)
+		return
+	}
+
+	deviceID, err := deviceIDFromRequest(r)
+	if err != nil {
+		http.Error(w, err.Error(), http.StatusBadRequest)
+		return
+	}
+
+	summaries, status, err := readSummaries(r, deviceID)
+	if err != nil {
+		http.Error(w, err.Error(), status)
+		return
+	}
+
+	// 与原始记录一样由写入协程写入, 聚合表的读改写不会并发
+	if !ingest.EnqueueSummaries(summaries) {
+		writeBusy(w)
+		return
+	}
+
+	w.Header().Set("Content-Type", "application/json")
+	w.WriteHeader(http.StatusAccepted)
+	json.NewEncoder(w).Encode(map[string]any{
+		"status": "success",
+		"count":  len(summaries),
+	})
+}
+
+// summaryDeltas 按各粒度累加一批汇总（跨越桶边界的窗口按帧的采集时间分到各个桶, 见 portions）
+func summaryDeltas(summaries []deviceSummary, deltas map[rollupKey]*rollupAgg) {
+	for i := range summaries {
+		for _, l := range rollupLevels {
+			summaries[i].portions(l.seconds, func(bucket int64, part *rollupAgg) {
+				key := rollupKey{l.level, bucket}
+				agg, ok := deltas[key]
+				if !ok {
+					agg = newRollupAgg(true)
+					deltas[key] = agg
+				}
+				agg.Merge(part)
+			})
+		}
+	}
+}
+
+// InsertSummaries 在一个事务中写入汇总台账并合并进聚合表; 已存在的汇总（设备重发）被跳过, 返回实际写入的汇总
+func (s *sensorStore) InsertSummaries(summaries []deviceSummary) ([]deviceSummary, error) {
+	tx, err := s.sqlDB.Begin()
+	if err != nil {
+		return nil, err
+	}
+	defer tx.Rollback()
+
+	insert := tx.Stmt(s.insertSummary)
+	var inserted []deviceSummary
+	for i := range summaries {
+		d := &summaries[i]
+		payload, err := json.Marshal(&d.req)
+		if err != nil {
+			return nil, err
+		}
+		res, err := insert.Exec(d.DeviceID, d.CapturedAt, d.CreatedAt, d.req.SeqFirst, d.req.SeqLast,
+			d.req.Count, d.req.DurationMS, d.req.Flags, payload)
+		if err != nil {
+			return nil, err
+		}
+		if n, err := res.RowsAffected(); err != nil {
+			return nil, err
+		} else if n > 0 {
+			inserted = append(inserted, *d)
+		}
+	}
+
+	deltas := make(map[rollupKey]*rollupAgg)
+	summaryDeltas(inserted, deltas)
+	if err := s.mergeRollups(tx, deltas); err != nil {
+		return nil, err
+	}
+	return inserted, tx.Commit()
+}
+
+// replaySummaries 重建聚合表时按台账顺序分段重放窗口起始时间不早于 from（Unix 秒）的汇总, 返回重放的条数
+func replaySummaries(from int64) (int, error) {
+	var lastID int64
+	total := 0
+	for {
+		rows, err := store.sqlDB.Query("SELECT id, captured_at, payload FROM sensor_summaries WHERE id > ? ORDER BY id ASC LIMIT ?", lastID, rollupBackfillChunk)
+		if err != nil {
+			return total, err
+		}
+		var chunk []deviceSummary
+		scanned := 0
+		for rows.Next() {
+			scanned++
+			var d deviceSummary
+			var payload []byte
+			if err := rows.Scan(&lastID, &d.CapturedAt, &payload); err != nil {
+				rows.Close()
+				return total, err
+			}
+			if d.CapturedAt.Unix() < from {
+				continue
+			}
+			if err := json.Unmarshal(payload, &d.req); err != nil {
+				rows.Close()
+				return total, err
+			}
+			d.agg = d.req.rollupAgg()
+			chunk = append(chunk, d)
+		}
+		rows.Close()
+		if err := rows.Err(); err != nil {
+			return total, err
+		}
+		if scanned == 0 {
+			return total, nil
+		}
+
+		deltas := make(map[rollupKey]*rollupAgg)
+		summaryDeltas(chunk, deltas)
+		tx, err := store.sqlDB.Begin()
+		if err != nil {
+			return total, err
+		}
+		if err := store.mergeRollups(tx, deltas); err != nil {
+			tx.Rollback()
+			return total, err
+		}
+		if err := tx.Commit(); err != nil {
+			return total, err
+		}
+		total += len(chunk)
+	}
+}
+
+// scanSummaryRows 读取台账查询结果（device_id, captured_at, created_at, payload）
+func scanSummaryRows(rows *sql.Rows, fn func(d *deviceSummary)) error {
+	defer rows.Close()
+	for rows.Next() {
+		var d deviceSummary
+		var payload []byte
+		if err := rows.Scan(&d.DeviceID, &d.CapturedAt, &d.CreatedAt, &payload); err != nil {
+			return err
+		}
+		if err := json.Unmarshal(payload, &d.req); err != nil {
+			return err
+		}
+		d.agg = d.req.rollupAgg()
+		fn(&d)
+	}
+	return rows.Err()
+}
+
+// forEachSummaryPart 遍历设备汇总中采集时间在 [start, end) 内的部分（按帧数分摊, 见 framesBefore）,
+// ts 为该部分的起始时间; 用于 WindowAgg 中未对齐到分钟边界、直接遍历原始记录的部分
+func forEachSummaryPart(start, end time.Time, fn func(ts time.Time, agg *rollupAgg)) error {
+	if !start.Before(end) {
+		return nil
+	}
+	rows, err := store.scanSummaries.Query(start.Add(-maxSummaryDuration), end)
+	if err != nil {
+		return err
+	}
+	return scanSummaryRows(rows, func(d *deviceSummary) {
+		n := d.framesBefore(end.UnixMilli()) - d.framesBefore(start.UnixMilli())
+		if n <= 0 {
+			return
+		}
+		agg := d.agg
+		if n < d.req.Count {
+			agg = d.req.portion(n)
+		}
+		fn(maxTime(start, d.CapturedAt), agg)
+	})
+}
+
+// latestSummary 台账中窗口起始时间最晚的汇总
+func latestSummary() (deviceSummary, bool, error) {
+	rows, err := store.sqlDB.Query("SELECT device_id, captured_at, created_at, payload FROM sensor_summaries ORDER BY captured_at DESC LIMIT 1")
+	if err != nil {
+		return deviceSummary{}, false, err
+	}
+	var latest deviceSummary
+	found := false
+	err = scanSummaryRows(rows, func(d *deviceSummary) {
+		latest, found = *d, true
+	})
+	return latest, found, err
+}
+
+// oldestSummary 汇总台账中最早的窗口起始时间
+func oldestSummary() (time.Time, bool, error) {
+	var oldest time.Time
+	err := store.sqlDB.QueryRow("SELECT captured_at FROM sensor_summaries ORDER BY captured_at ASC LIMIT 1").Scan(&oldest)
+	if err == sql.ErrNoRows {
+		return time.Time{}, false, nil
+	}
+	return oldest, err == nil, err
+}
@@ -0,0 +1,84 @@
+package main
+
+import (
+	"math"
+	"testing"
+	"time"
+)
+
+// testSummary 从 start 起每秒一帧、共 n 帧的汇总
+func testSummary(start time.Time, n int64) deviceSummary {
+	req := summaryRequest{TS: start.UnixMilli(), DurationMS: (n - 1) * 1000, Count: n, SeqFirst: 1, SeqLast: n}
+	for i := 0; i < metricCount; i++ {
+		req.Min[i] = 1000
+		req.Max[i] = 3000
+		req.Mean[i] = 2000
+		req.M2[i] = float64(n) * 1e5
+	}
+	return deviceSummary{DeviceID: "dev", CapturedAt: start, req: req, agg: req.rollupAgg()}
+}
+
+func TestSummaryPortionsSpanBuckets(t *testing.T) {
+	// 5 分钟的窗口从 10:59 开始: 帧应分到 10:59 至 11:03 五个分钟桶, 10 点与 11 点各一部分
+	start := time.Date(2024, 1, 1, 10, 59, 0, 0, time.UTC)
+	d := testSummary(start, 300)
+
+	minutes := map[int64]int64{}
+	d.portions(rollupLevels[0].seconds, func(bucket int64, agg *rollupAgg) {
+		minutes[bucket] += agg.Count
+	})
+	if len(minutes) != 5 {
+		t.Fatalf("分钟桶数 = %d, 期望 5: %v", len(minutes), minutes)
+	}
+	for m := int64(0); m < 5; m++ {
+		if got := minutes[start.Unix()+m*60]; got != 60 {
+			t.Errorf("第 %d 分钟 %d 帧, 期望 60", m, got)
+		}
+	}
+
+	total := newRollupAgg(true)
+	hours := map[int64]int64{}
+	d.portions(rollupLevels[1].seconds, func(bucket int64, agg *rollupAgg) {
+		hours[bucket] += agg.Count
+		total.Merge(agg)
+	})
+	hour := start.Truncate(time.Hour).Unix()
+	if hours[hour] != 60 || hours[hour+3600] != 240 {
+		t.Fatalf("小时桶帧数 = %v, 期望 60/240", hours)
+	}
+	// 各部分合并后与整个窗口一致
+	if total.Count != d.agg.Count || math.Abs(total.Mean[0]-d.agg.Mean[0]) > 1e-9 || math.Abs(total.M2[0]-d.agg.M2[0]) > 1e-6 {
+		t.Fatalf("合并结果 count=%d mean=%v m2=%v, 期望 %d %v %v", total.Count, total.Mean[0], total.M2[0], d.agg.Count, d.agg.Mean[0], d.agg.M2[0])
+	}
+}
+
+func TestSummaryPortionsSingleBucket(t *testing.T) {
+	start := time.Date(2024, 1, 1, 10, 30, 0, 0, time.UTC)
+	d := testSummary(start, 30)
+	calls := 0
+	d.portions(rollupLevels[0].seconds, func(bucket int64, agg *rollupAgg) {
+		calls++
+		if bucket != start.Unix() || agg != d.agg {
+			t.Fatalf("窗口在一个桶内时应整体计入: bucket=%d", bucket)
+		}
+	})
+	if calls != 1 {
+		t.Fatalf("回调 %d 次, 期望 1", calls)
+	}
+}
+
+func TestSummaryLatest(t *testing.T) {
+	start := time.Date(2024, 1, 1, 10, 30, 0, 0, time.UTC)
+	d := testSummary(start, 30)
+	d.req.Last[metricPM25] = 3550
+	d.req.Flags = flagSeqTracked | flagSummary
+
+	latest := d.latest()
+	if !latest.CapturedAt.Equal(start.Add(29*time.Second)) || latest.PM25 != 35.5 || latest.SequenceNum != 30 || !latest.IsValid {
+		t.Fatalf("最新读数错误: %+v", latest)
+	}
+	d.req.Flags |= flagOutOfRange
+	if d.latest().IsValid {
+		t.Fatal("窗口内有超量程帧时最新读数应为异常")
+	}
+}
@@ -2,7 +2,8 @@ import { onMounted, onUnmounted, ref } from 'vue'
 
 export interface SensorData {
   id: number
-  created_at: string
+  created_at: string // 服务器接收时间
+  captured_at: string // 采集时间（图表横轴）
   particle: number
   pm25: number
   hcho: number
@@ -49,6 +50,7 @@ export interface StatsResponse {
 export interface AnalysisResponse {
   hours: number
   correlations: Record<string, number>
+  correlation_matrix: Record<string, number>
   hourly_trend: Array<{
     hour: number
     pm25: number
@@ -82,8 +84,17 @@ export interface AnalysisResponse {
 export interface HistoryResponse {
   count: number
   data: SensorData[]
+  next_cursor: string | null
+  bucket_seconds?: number
 }
 
+// 历史曲线的点数（服务器按时间桶取最小/最大值降采样）
+const HISTORY_POINTS = 1000
+// 历史曲线的时间范围（小时）
+const HISTORY_HOURS = 24
+// 实时推送的新数据逐条追加到曲线, 定期重新拉取降采样数据以控制点数
+const HISTORY_RESYNC_MS = 10 * 60 * 1000
+
 export function useSensor() {
   const latestData = ref<SensorData | null>(null)
   const historyData = ref<SensorData[]>([])
@@ -93,6 +104,8 @@ export function useSensor() {
   const error = ref<string | null>(null)
 
   let refreshInterval: ReturnType<typeof setInterval> | null = null
+  let resyncInterval: ReturnType<typeof setInterval> | null = null
+  let stream: EventSource | null = null
 
   // 获取最新状态
   async function fetchStatus() {
@@ -110,7 +123,7 @@ export function useSensor() {
   // 获取历史数据
   async function fetchHistory(hours = 24) {
     try {
-      const res = await fetch(`/api/history?hours=${hours}`)
+      const res = await fetch(`/api/history?hours=${hours}&points=${HISTORY_POINTS}`)
       if (res.ok) {
         const data: HistoryResponse = await res.json()
         historyData.value = data.data.reverse() // 按时间正序
@@ -162,12 +175,50 @@ export function useSensor() {
     }
   }
 
-  // 开始自动刷新
-  function startAutoRefresh(intervalMs = 5000) {
+  // 追加实时推送的新数据（推送的记录按时间正序）
+  function appendReadings(records: SensorData[]) {
+    if (records.length === 0) {
+      return
+    }
+    latestData.value = records[records.length - 1]!
+    // 补传的离线数据采集时间可能早于时间窗口, 同样过滤
+    const since = Date.now() - HISTORY_HOURS * 3600 * 1000
+    const inWindow = (d: SensorData) => new Date(d.captured_at).getTime() >= since
+    historyData.value = historyData.value.filter(inWindow).concat(records.filter(inWindow))
+  }
+
+  // 订阅实时推送, 断线后浏览器自动重连, 重连后重新拉取数据补齐断线期间的缺口
+  function connectStream() {
+    stream = new EventSource('/api/stream')
+    let connected = false
+    stream.addEventListener('open', () => {
+      if (connected) {
+        refreshAll()
+      }
+      connected = true
+    })
+    stream.addEventListener('readings', (e) => {
+      appendReadings(JSON.parse((e as MessageEvent).data))
+    })
+  }
+
+  // 开始自动刷新: 新数据由实时推送送达, 统计与分析按较长间隔刷新;
+  // 浏览器不支持 EventSource 时退回轮询状态
+  function startAutoRefresh(intervalMs = 60000) {
     stopAutoRefresh()
+    if (typeof EventSource === 'undefined') {
+      intervalMs = 5000
+    }
+    else {
+      connectStream()
+      resyncInterval = setInterval(() => fetchHistory(HISTORY_HOURS), HISTORY_RESYNC_MS)
+    }
     refreshInterval = setInterval(() => {
-      fetchStatus()
-      fetchStats(24)
+      if (!stream) {
+        fetchStatus()
+      }
+      fetchStats(HISTORY_HOURS)
+      fetchAnalysis(HISTORY_HOURS)
     }, intervalMs)
   }
 
@@ -177,6 +228,14 @@ export function useSensor() {
       clearInterval(refreshInterval)
       refreshInterval = null
     }
+    if (resyncInterval) {
+      clearInterval(resyncInterval)
+      resyncInterval = null
+    }
+    if (stream) {
+      stream.close()
+      stream = null
+    }
   }
 
   onMounted(() => {